@@ -6,9 +6,12 @@
 #include "D3DApp.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "MeshCache.h"
 #include "MathHelper.h"
 #include "DDSTextureLoader.h"
-#include "Waves.h"
+#include "WaveSolver.h"
+#include "WaveSolverThread.h"
+#include "WaveChunks.h"
 
 #define MaxLights 16
 
@@ -80,6 +83,9 @@ struct FrameResource {
 	std::unique_ptr<UploadBuffer<ObjectConstant>> ObjectCB;
 	std::unique_ptr<UploadBuffer<MaterialConstant>> MaterialCB;
 	std::unique_ptr<UploadBuffer<Vertex>> WavesVB;
+	// Waves chunk versions last written into WavesVB, so only visible chunks that
+	// changed are re-uploaded.
+	std::vector<std::uint64_t> WavesChunkVersions;
 
 
 	UINT Fence;
@@ -195,6 +201,13 @@ private:
 	PassConstant mMainPassCB;
 
 	std::unique_ptr<Waves> mWaves;
+	std::unique_ptr<WavesThread> mWavesThread;
+
+	// Render chunks of the water, the ones in view this frame, and the
+	// camera frustum in view space to cull them with.
+	std::unique_ptr<WaveChunkGrid> mWaterChunks;
+	std::vector<int> mVisibleWaterChunks;
+	DirectX::BoundingFrustum mCamFrustum;
 
 	int AnimateIdx = 0;
 	double animateGone = 0.0f;
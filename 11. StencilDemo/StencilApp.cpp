@@ -1,4 +1,5 @@
 #include "StencilApp.h"
+#include <stdexcept>
 
 using namespace DirectX;
 using namespace d3dUtil;
@@ -906,7 +907,7 @@ void StencilApp::BuildSkullGeometry()
 	fin >> ignore;
 	fin >> ignore;
 
-	std::vector<std::int32_t> indices(3 * tcount);
+	std::vector<std::uint32_t> indices(3 * tcount);
 	for (UINT i = 0; i < tcount; ++i)
 	{
 		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
@@ -914,13 +915,71 @@ void StencilApp::BuildSkullGeometry()
 
 	fin.close();
 
+	// Reorder for the vertex cache, overdraw and vertex fetch.
+	MeshOptimizeReport report = OptimizeMesh(vertices, indices, &Vertex::Pos);
+
+	wchar_t reportText[128];
+	swprintf_s(reportText, L"skull.txt: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		report.Before.ACMR, report.After.ACMR, report.Before.ATVR, report.After.ATVR);
+	::OutputDebugString(reportText);
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Nothing draws meshlets yet, so they are only built in debug builds,
+	// to check and report how well the skull clusters.
+	MeshletData meshlets;
+	BuildMeshlets(indices.data(), indices.size(), &vertices[0].Pos, sizeof(Vertex), (UINT)vertices.size(), meshlets);
+
+	std::string meshletError;
+	if (!ValidateMeshlets(meshlets, indices.data(), indices.size(), &vertices[0].Pos, sizeof(Vertex),
+		(UINT)vertices.size(), meshletError))
+	{
+		::OutputDebugStringA(("skull.txt meshlets: " + meshletError + "\n").c_str());
+	}
+
+	MeshletStats meshletStats = AnalyzeMeshlets(meshlets);
+	swprintf_s(reportText, L"skull.txt: %zu meshlets, vertex fill %.2f, triangle fill %.2f, duplication %.2f\n",
+		meshletStats.MeshletCount, meshletStats.VertexFill, meshletStats.TriangleFill, meshletStats.VertexDuplication);
+	::OutputDebugString(reportText);
+#endif
+
+	// Simplify to halving triangle counts; every level indexes the same vertices.
+	std::vector<std::uint32_t> lodIndices;
+	BuildLodChain(indices.data(), indices.size(), &vertices[0].Pos, sizeof(Vertex), (UINT)vertices.size(),
+		{ 1.0f, 0.5f, 0.25f, 0.125f, 0.0625f }, lodIndices, mSkullLods);
+
 	//
-	// Pack the indices of all the meshes into one index buffer.
+	// Pack the indices of all the levels into one index buffer, 16-bit when
+	// they fit.  The skull's 31076 vertices do, so each level stays one draw.
 	//
 
+	std::vector<IndexRange> lodRanges(mSkullLods.size());
+	for (size_t i = 0; i < mSkullLods.size(); ++i)
+	{
+		lodRanges[i].StartIndex = mSkullLods[i].StartIndex;
+		lodRanges[i].IndexCount = mSkullLods[i].IndexCount;
+	}
+
+	PackedIndices packedIndices;
+	IndexPackingReport packingReport = PackIndices(lodIndices.data(), lodRanges, packedIndices);
+
+	swprintf_s(reportText, L"skull.txt: %u-bit indices, %zu -> %zu bytes\n",
+		packedIndices.IndexSize * 8, packingReport.BytesBefore, packingReport.BytesAfter);
+	::OutputDebugString(reportText);
+
+	// A level is drawn as one range with no base vertex, which holds while
+	// the skull's vertices fit in 16 bits and nothing is split or rebased.
+	// A larger model would draw only part of each level; refuse it instead.
+	for (size_t i = 0; i < mSkullLods.size(); ++i)
+	{
+		const IndexRange& part = packedIndices.Parts[packedIndices.FirstPart[i]];
+		if (packedIndices.FirstPart[i + 1] - packedIndices.FirstPart[i] != 1 || part.BaseVertex != 0)
+			throw std::runtime_error("BuildSkullGeometry: a skull level packed into several draws or with a base vertex.");
+		mSkullLods[i].StartIndex = part.StartIndex;
+	}
+
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::int32_t);
+	const UINT ibByteSize = (UINT)packedIndices.ByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "skullGeo";
@@ -929,7 +988,7 @@ void StencilApp::BuildSkullGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), packedIndices.Data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(mD3DDevice.Get(),
 		mCommandList.Get(), geo->VertexBufferCPU.Get(), geo->VertexUploadBuffer);
@@ -939,12 +998,13 @@ void StencilApp::BuildSkullGeometry()
 
 	geo->VertexStride = sizeof(Vertex);
 	geo->VertexBufferSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
+	geo->IndexFormat = packedIndices.IndexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferSize = ibByteSize;
 
+	// "skull" is the full-detail level; OnKeyboardInput switches between levels.
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
+	submesh.IndexCount = mSkullLods[0].IndexCount;
+	submesh.StartIndexLocation = mSkullLods[0].StartIndex;
 	submesh.BaseVertexLocation = 0;
 
 	geo->DrawArgs["skull"] = submesh;
@@ -974,7 +1034,8 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 
 	// Update the new world matrix.
 	XMMATRIX skullRotate = XMMatrixRotationY(0.5f * MathHelper::Pi);
-	XMMATRIX skullScale = XMMatrixScaling(0.45f, 0.45f, 0.45f);
+	const float skullSize = 0.45f;
+	XMMATRIX skullScale = XMMatrixScaling(skullSize, skullSize, skullSize);
 	XMMATRIX skullOffset = XMMatrixTranslation(skullTranslation.x, skullTranslation.y, skullTranslation.z);
 	XMMATRIX skullWorld = skullRotate * skullScale * skullOffset;
 	XMStoreFloat4x4(&mSkullRitem->World, skullWorld);
@@ -991,6 +1052,16 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 	XMMATRIX shadowOffsetY = XMMatrixTranslation(0.0f, 0.001f, 0.0f);
 	XMStoreFloat4x4(&mShadowedSkullRitem->World, skullWorld * S * shadowOffsetY);
 
+	// Pick the coarsest skull level that stays within a pixel of the full one.
+	// The reflection and shadow are no closer than the skull, so they share it.
+	float skullDistance = XMVectorGetX(XMVector3Length(skullOffset.r[3] - XMLoadFloat3(&mEyePos)));
+	float pixelsPerUnit = skullSize * mClientHeight / (2.0f * tanf(0.125f * MathHelper::Pi));
+	const MeshLod& skullLod = mSkullLods[SelectLod(mSkullLods, skullDistance, pixelsPerUnit)];
+	for (RenderItem* ri : { mSkullRitem, mReflectedSkullRitem, mShadowedSkullRitem }) {
+		ri->IndexCount = skullLod.IndexCount;
+		ri->StartIndexLocation = skullLod.StartIndex;
+	}
+
 	mSkullRitem->NumFramesDirty = gFrameResourcesCount;
 	mReflectedSkullRitem->NumFramesDirty = gFrameResourcesCount;
 	mShadowedSkullRitem->NumFramesDirty = gFrameResourcesCount;
@@ -7,6 +7,10 @@
 #include "D3DApp.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "IndexPacking.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 #include "MathHelper.h"
 #include "DDSTextureLoader.h"
 
@@ -199,4 +203,6 @@ private:
 	RenderItem* mSkullRitem;
 	RenderItem* mReflectedSkullRitem;
 	RenderItem* mShadowedSkullRitem;
+
+	std::vector<MeshLod> mSkullLods;
 };
@@ -334,40 +334,40 @@ void IcosahedronApp::BuildShadersAndInputLayout()
 	mInputLayout =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 2, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 	};
 }
 
 void IcosahedronApp::BuildGeometry()
 {
+	// Only the attributes the shaders read, each in its own stream.
 	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData icosa = geoGen.CreateGeosphere(1.0f, 1);
+	GeometryGenerator::MeshStreams icosa = geoGen.CreateGeosphereStreams(1.0f, 1,
+		GeometryGenerator::AttributePosition | GeometryGenerator::AttributeNormal | GeometryGenerator::AttributeTexC);
 
-	std::vector<Vertex> vertices(icosa.Vertices.size());
+	// 16-bit indices when they fit, which the geosphere's few vertices do.
+	PackedIndices indices;
+	PackIndices(icosa.Indices32, indices);
 
-	UINT k = 0;
-	for (size_t i = 0; i < icosa.Vertices.size(); ++i, ++k)
-	{
-		vertices[k].Pos = icosa.Vertices[i].Position;
-		vertices[k].Normal = icosa.Vertices[i].Normal;
-		vertices[k].TexC = icosa.Vertices[i].TexC;
-	}
-
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(icosa.GetIndices16()), std::end(icosa.GetIndices16()));
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	// The streams go back to back into the vertex buffer, for input slots 0 to 2.
+	const UINT positionByteSize = icosa.VertexCount * sizeof(XMFLOAT3);
+	const UINT normalByteSize = icosa.VertexCount * sizeof(XMFLOAT3);
+	const UINT texCByteSize = icosa.VertexCount * sizeof(XMFLOAT2);
+	const UINT vbByteSize = positionByteSize + normalByteSize + texCByteSize;
+	const UINT ibByteSize = (UINT)indices.ByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	BYTE* vb = (BYTE*)geo->VertexBufferCPU->GetBufferPointer();
+	CopyMemory(vb, icosa.Positions.data(), positionByteSize);
+	CopyMemory(vb + positionByteSize, icosa.Normals.data(), normalByteSize);
+	CopyMemory(vb + positionByteSize + normalByteSize, icosa.TexCs.data(), texCByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.Data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(mD3DDevice.Get(),
 		mCommandList.Get(), geo->VertexBufferCPU.Get(), geo->VertexUploadBuffer);
@@ -375,15 +375,19 @@ void IcosahedronApp::BuildGeometry()
 	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(mD3DDevice.Get(),
 		mCommandList.Get(), geo->IndexBufferCPU.Get(), geo->IndexUploadBuffer);
 
-	geo->VertexStride = sizeof(Vertex);
+	geo->VertexStride = 0;
+	geo->VertexStreams = {
+		{ 0, sizeof(XMFLOAT3) },
+		{ positionByteSize, sizeof(XMFLOAT3) },
+		{ positionByteSize + normalByteSize, sizeof(XMFLOAT2) } };
 	geo->VertexBufferSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.IndexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferSize = ibByteSize;
 
 	SubmeshGeometry boxSubmesh;
-	boxSubmesh.BaseVertexLocation = 0;
-	boxSubmesh.IndexCount = indices.size();
-	boxSubmesh.StartIndexLocation = 0;
+	boxSubmesh.BaseVertexLocation = indices.Parts[0].BaseVertex;
+	boxSubmesh.IndexCount = indices.Parts[0].IndexCount;
+	boxSubmesh.StartIndexLocation = indices.Parts[0].StartIndex;
 
 	geo->DrawArgs["icosa"] = boxSubmesh;
 
@@ -436,9 +440,10 @@ void IcosahedronApp::DrawRenderItems(const vector<RenderItem*>& ritems)
 	auto objCBSize = d3dUtil::CalcConstantBufferSize(sizeof ObjectConstant);
 
 	for (const auto& e : ritems) {
-		auto vbv = e->Geo->VertexBufferView();
+		D3D12_VERTEX_BUFFER_VIEW vbvs[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+		UINT vbvCount = e->Geo->VertexBufferViews(vbvs);
 		auto ibv = e->Geo->IndexBufferView();
-		mCommandList->IASetVertexBuffers(0, 1, &vbv);
+		mCommandList->IASetVertexBuffers(0, vbvCount, vbvs);
 		mCommandList->IASetIndexBuffer(&ibv);
 		mCommandList->IASetPrimitiveTopology(e->PrimitiveType);
 
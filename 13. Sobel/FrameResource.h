@@ -201,6 +201,10 @@ public:
     // the commands that reference it.  So each frame needs their own.
     std::unique_ptr<UploadBuffer<Vertex>> WavesVB = nullptr;
 
+    // Waves chunk versions last written into WavesVB, so only visible chunks that
+    // changed are re-uploaded.
+    std::vector<std::uint64_t> WavesChunkVersions;
+
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
     UINT64 Fence = 0;
@@ -6,9 +6,12 @@
 #include "MathHelper.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "MeshCache.h"
 #include "DDSTextureLoader.h"
 #include "FrameResource.h"
-#include "Waves.h"
+#include "WaveSolver.h"
+#include "WaveSolverThread.h"
+#include "WaveChunks.h"
 #include "SobelFilter.h"
 #include <array>
 
@@ -133,6 +136,13 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 
 	std::unique_ptr<Waves> mWaves;
+	std::unique_ptr<WavesThread> mWavesThread;
+
+	// Render chunks of the water, the ones in view this frame, and the
+	// camera frustum in view space to cull them with.
+	std::unique_ptr<WaveChunkGrid> mWaterChunks;
+	std::vector<int> mVisibleWaterChunks;
+	BoundingFrustum mCamFrustum;
 
 	std::unique_ptr<SobelFilter> mBlurFilter;
 
@@ -196,6 +206,10 @@ bool BlurApp::Initialize()
     mCbvSrvDescriptorSize = mD3DDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
     mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
+    mWaves->SetComputeTangentX(false); // Default.hlsl has no normal mapping.
+    mWaves->SetComputeNormals(false); // Derived only for the visible chunks.
+    mWaves->UseLargestStableStep(); // As few steps per frame as stay stable.
+    mWavesThread = std::make_unique<WavesThread>(*mWaves);
 
 	mBlurFilter = std::make_unique<SobelFilter>(mD3DDevice.Get(), mClientWidth, mClientHeight);
  
@@ -230,6 +244,8 @@ void BlurApp::OnResize()
     XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
     XMStoreFloat4x4(&mProj, P);
 
+    BoundingFrustum::CreateFromMatrix(mCamFrustum, P);
+
 	if (mBlurFilter)
 		mBlurFilter->OnResize(mClientWidth, mClientHeight);
 }
@@ -521,28 +537,36 @@ void BlurApp::UpdateWaves(const GameTimer& gt)
 
 		float r = MathHelper::RandF(0.2f, 0.5f);
 
-		mWaves->Disturb(i, j, r);
+		mWavesThread->Disturb(i, j, r);
 	}
 
-	// Update the wave simulation.
-	mWaves->Update(gt.DeltaTime());
-
-	// Update the wave vertex buffer with the new solution.
+	// Cull the water chunks.  The water's world matrix is the identity, so
+	// the camera frustum only needs taking from view space to world space.
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMVECTOR detView = XMMatrixDeterminant(view);
+	BoundingFrustum localFrustum;
+	mCamFrustum.Transform(localFrustum, XMMatrixInverse(&detView, view));
+	mWaterChunks->Cull(localFrustum, mVisibleWaterChunks);
+
+	// Upload the newest solution the simulation thread has finished.  Only the
+	// visible chunks that changed since this frame resource was last filled
+	// need writing; their normals are derived as they are written straight
+	// into the mapped upload buffer.
+	static_assert(sizeof(Vertex) == sizeof(WaveVertex), "Vertex must match the WaveVertex layout.");
+	const WavesFrame& waves = mWavesThread->Latest();
 	auto currWavesVB = mCurrFrameResource->WavesVB.get();
-	for(int i = 0; i < mWaves->VertexCount(); ++i)
-	{
-		Vertex v;
+	mWaterChunks->WriteVisibleVertices(waves, mVisibleWaterChunks, mCurrFrameResource->WavesChunkVersions,
+		reinterpret_cast<WaveVertex*>(currWavesVB->MappedData()));
 
-		v.Pos = mWaves->Position(i);
-		v.Normal = mWaves->Normal(i);
-		
-		// Derive tex-coords from position by 
-		// mapping [-w/2,w/2] --> [0,1]
-		v.TexC.x = 0.5f + v.Pos.x / mWaves->Width();
-		v.TexC.y = 0.5f - v.Pos.z / mWaves->Depth();
+	// Show what the simulation did for this frame next to the frame rate.
+	const WaveStats& stats = waves.Stats();
+	wchar_t caption[128];
+	swprintf_s(caption, L"Learn DX12      waves: %d step(s) of %.0f ms, Courant %.2f, max height %.2f",
+		stats.Steps, 1000.0f*stats.TimeStep, stats.Courant, stats.MaxAmplitude);
+	mWndCaptain = caption;
 
-		currWavesVB->CopyData(i, v);
-	}
+	// Let the simulation thread step the next frame while this one is recorded.
+	mWavesThread->Submit(gt.DeltaTime());
 
 	// Set the dynamic VB of the wave renderitem to the current frame VB.
 	mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
@@ -692,8 +716,8 @@ void BlurApp::BuildShadersAndInputLayout()
 
 void BlurApp::BuildLandGeometry()
 {
-    GeometryGenerator geoGen;
-    GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
+    MeshCache meshCache;
+    MeshCache::Mesh grid = meshCache.CreateGrid(160.0f, 160.0f, 50, 50);
 
     //
     // Extract the vertex elements we are interested and apply the height function to
@@ -748,30 +772,14 @@ void BlurApp::BuildLandGeometry()
 
 void BlurApp::BuildWavesGeometry()
 {
-    std::vector<std::uint16_t> indices(3 * mWaves->TriangleCount()); // 3 indices per face
-	assert(mWaves->VertexCount() < 0x0000ffff);
-
-    // Iterate over each quad.
-    int m = mWaves->RowCount();
-    int n = mWaves->ColumnCount();
-    int k = 0;
-    for(int i = 0; i < m - 1; ++i)
-    {
-        for(int j = 0; j < n - 1; ++j)
-        {
-            indices[k] = i*n + j;
-            indices[k + 1] = i*n + j + 1;
-            indices[k + 2] = (i + 1)*n + j;
-
-            indices[k + 3] = (i + 1)*n + j;
-            indices[k + 4] = i*n + j + 1;
-            indices[k + 5] = (i + 1)*n + j + 1;
-
-            k += 6; // next quad
-        }
-    }
-
-	UINT vbByteSize = mWaves->VertexCount()*sizeof(Vertex);
+    // The water is drawn in chunks, each with its own 16-bit indices and
+    // bounds, so the grid may grow past 65536 vertices and only the chunks
+    // in view are uploaded and drawn.  The heights stay well within 4 units.
+    mWaterChunks = std::make_unique<WaveChunkGrid>(mWaves->RowCount(), mWaves->ColumnCount(),
+        mWaves->SpatialStep(), 4.0f);
+    const std::vector<std::uint16_t>& indices = mWaterChunks->Indices();
+
+	UINT vbByteSize = mWaterChunks->VertexCount()*sizeof(Vertex);
 	UINT ibByteSize = (UINT)indices.size()*sizeof(std::uint16_t);
 
 	auto geo = std::make_unique<MeshGeometry>();
@@ -804,8 +812,8 @@ void BlurApp::BuildWavesGeometry()
 
 void BlurApp::BuildBoxGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(8.0f, 8.0f, 8.0f, 3);
+	MeshCache meshCache;
+	MeshCache::Mesh box = meshCache.CreateBox(8.0f, 8.0f, 8.0f, 3);
 
 	std::vector<Vertex> vertices(box.Vertices.size());
 	for (size_t i = 0; i < box.Vertices.size(); ++i)
@@ -923,7 +931,7 @@ void BlurApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(mD3DDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaves->VertexCount()));
+            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size(), mWaterChunks->VertexCount()));
     }
 }
 
@@ -1034,7 +1042,19 @@ void BlurApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vec
         cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
         cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
 
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+        // The water submits only its visible chunks.
+        if(ri == mWavesRitem)
+        {
+            for(int c : mVisibleWaterChunks)
+            {
+                const WaveChunk& chunk = mWaterChunks->Chunk(c);
+                cmdList->DrawIndexedInstanced(chunk.IndexCount, 1, chunk.StartIndex, chunk.BaseVertex, 0);
+            }
+        }
+        else
+        {
+            cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+        }
     }
 }
 
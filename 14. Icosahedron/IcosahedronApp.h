@@ -6,6 +6,7 @@
 #include "D3DApp.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "IndexPacking.h"
 #include "MathHelper.h"
 #include "DDSTextureLoader.h"
 
@@ -52,13 +53,6 @@ struct MaterialConstant {
 	DirectX::XMFLOAT4X4 MatTransform = MathHelper::Identity4x4();
 };
 
-struct Vertex
-{
-	DirectX::XMFLOAT3 Pos;
-	DirectX::XMFLOAT3 Normal;
-	DirectX::XMFLOAT2 TexC;
-};
-
 const INT gFrameResourcesCount = 3;
 
 struct FrameResource {
@@ -6,6 +6,8 @@
 #include "D3DApp.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "MeshCache.h"
+#include "IndexPacking.h"
 #include "MathHelper.h"
 
 struct ObjectConstant {
@@ -1,4 +1,5 @@
 #include "LitShapesApp.h"
+#include <stdexcept>
 
 using namespace DirectX;
 using namespace d3dUtil;
@@ -396,11 +397,11 @@ void LitShapesApp::BuildShadersAndInputLayout()
 
 void LitShapesApp::BuildGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3);
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
-	GeometryGenerator::MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-	GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+	MeshCache meshCache;
+	MeshCache::Mesh box = meshCache.CreateBox(1.5f, 0.5f, 1.5f, 3);
+	MeshCache::Mesh grid = meshCache.CreateGrid(20.0f, 30.0f, 60, 40);
+	MeshCache::Mesh sphere = meshCache.CreateSphere(0.5f, 20, 20);
+	MeshCache::Mesh cylinder = meshCache.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
 
 
 	// cache the vertex offsets to each object in the concatenated vertex buffer
@@ -468,14 +469,41 @@ void LitShapesApp::BuildGeometry()
 		vertices[k].Normal = cylinder.Vertices[i].Normal;
 	}
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
+	std::vector<std::uint32_t> indices32;
+	for (const MeshCache::Mesh* mesh : { &box, &grid, &sphere, &cylinder })
+		indices32.insert(indices32.end(), mesh->Indices32.begin(), mesh->Indices32.end());
+
+	// 16-bit indices when every shape fits, which these small ones do; the
+	// buffer stays 32-bit rather than lose any.
+	SubmeshGeometry* submeshes[] = { &boxSubmesh, &gridSubmesh, &sphereSubmesh, &cylinderSubmesh };
+	std::vector<IndexRange> ranges;
+	for (const SubmeshGeometry* submesh : submeshes)
+	{
+		IndexRange range;
+		range.StartIndex = submesh->StartIndexLocation;
+		range.IndexCount = submesh->IndexCount;
+		range.BaseVertex = submesh->BaseVertexLocation;
+		ranges.push_back(range);
+	}
+
+	PackedIndices indices;
+	PackIndices(indices32.data(), ranges, indices);
+
+	// Each shape has far fewer than 65536 vertices, so it stays one draw.
+	// A render item draws one range, so a shape split into several would lose
+	// triangles; refuse it rather than draw part of it.
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		if (indices.FirstPart[i + 1] - indices.FirstPart[i] != 1)
+			throw std::runtime_error("BuildGeometry: a shape spans more than 65536 vertices and packed into several draws.");
+		const IndexRange& part = indices.Parts[indices.FirstPart[i]];
+		submeshes[i]->StartIndexLocation = part.StartIndex;
+		submeshes[i]->IndexCount = part.IndexCount;
+		submeshes[i]->BaseVertexLocation = part.BaseVertex;
+	}
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = (UINT)indices.ByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "shapeGeo";
@@ -484,7 +512,7 @@ void LitShapesApp::BuildGeometry()
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.Data(), ibByteSize);
 
 	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(mD3DDevice.Get(),
 		mCommandList.Get(), geo->VertexBufferCPU.Get(), geo->VertexUploadBuffer);
@@ -494,7 +522,7 @@ void LitShapesApp::BuildGeometry()
 
 	geo->VertexStride = sizeof(Vertex);
 	geo->VertexBufferSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indices.IndexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferSize = ibByteSize;
 
 	geo->DrawArgs["box"] = boxSubmesh;
@@ -398,8 +398,8 @@ void TexBoxApp::BuildShadersAndInputLayout()
 
 void TexBoxApp::BuildGeometry()
 {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(2.0f, 2.0f, 2.0f, 3);
+	MeshCache meshCache;
+	MeshCache::Mesh box = meshCache.CreateBox(2.0f, 2.0f, 2.0f, 3);
 
 	std::vector<Vertex> vertices(box.Vertices.size());
 
@@ -411,8 +411,7 @@ void TexBoxApp::BuildGeometry()
 		vertices[k].TexC = box.Vertices[i].TexC;
 	}
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
+	std::vector<std::uint16_t> indices = box.GetIndices16();
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
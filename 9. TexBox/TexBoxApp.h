@@ -6,6 +6,7 @@
 #include "D3DApp.h"
 #include "UploadBuffer.h"
 #include "GeometryGenerator.h"
+#include "MeshCache.h"
 #include "MathHelper.h"
 #include "DDSTextureLoader.h"
 
@@ -0,0 +1,77 @@
+//***************************************************************************************
+// AdvanceBenchmark.cpp
+//
+// WaveSolver::Advance(steps), which takes bands of rows several steps forward
+// while they stay in L2, against calling Update once per step, which streams
+// the whole grid through memory every step.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "WaveSolver.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace
+{
+	std::unique_ptr<Waves> MakeWaves(int size, bool computeNormals)
+	{
+		auto waves = std::make_unique<Waves>(size, size, 1.0f, 0.03f, 4.0f, 0.2f);
+		waves->SetSleepThreshold(-1.0f);
+		waves->SetComputeTangentX(false);
+		waves->SetComputeNormals(computeNormals);
+		for(int k = 1; k <= 4; ++k)
+			waves->Disturb(size*k/5, size*(5 - k)/5, 0.5f*k);
+		return waves;
+	}
+}
+
+bool RunAdvanceBenchmark()
+{
+	const int repeats = 3;
+	const int steps = 32;
+	bool passed = true;
+
+	std::printf("ms for %d steps; loop = Update() per step, advance = Advance(%d)\n", steps, steps);
+	std::printf("%6s | %-26s | %-26s\n", "", "heights only", "heights + normals");
+	std::printf("%6s | %8s %8s %8s | %8s %8s %8s\n",
+		"size", "loop", "advance", "speedup", "loop", "advance", "speedup");
+
+	for(int size = 256; size <= 2048; size *= 2)
+	{
+		double loop[2], advance[2];
+		for(int normals = 0; normals < 2; ++normals)
+		{
+			std::unique_ptr<Waves> stepped = MakeWaves(size, normals != 0);
+			loop[normals] = BestTime(repeats, [&]
+			{
+				for(int s = 0; s < steps; ++s)
+					stepped->Update(stepped->TimeStep());
+			});
+
+			std::unique_ptr<Waves> advanced = MakeWaves(size, normals != 0);
+			advance[normals] = BestTime(repeats, [&] { advanced->Advance(steps); });
+
+			// Both ran repeats*steps steps from the same start.
+			for(int i = 0; i < stepped->VertexCount(); ++i)
+			{
+				float a = stepped->Height(i);
+				float b = advanced->Height(i);
+				DirectX::XMFLOAT3 na = stepped->Normal(i);
+				DirectX::XMFLOAT3 nb = advanced->Normal(i);
+				if(std::memcmp(&a, &b, sizeof(a)) != 0 || std::memcmp(&na, &nb, sizeof(na)) != 0)
+				{
+					std::printf("  MISMATCH: Advance differs from stepping at %dx%d, vertex %d\n", size, size, i);
+					passed = false;
+					break;
+				}
+			}
+		}
+
+		std::printf("%6d | %8.1f %8.1f %7.2fx | %8.1f %8.1f %7.2fx\n", size,
+			loop[0]*1e3, advance[0]*1e3, loop[0]/advance[0],
+			loop[1]*1e3, advance[1]*1e3, loop[1]/advance[1]);
+	}
+
+	return passed;
+}
@@ -0,0 +1,55 @@
+//***************************************************************************************
+// Benchmark.h
+//
+// Console benchmarks of the Common library's CPU paths.  Each one prints a
+// table and checks that the paths it compares produce the same results.
+//***************************************************************************************
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Runs f repeats times and returns the fastest run, in seconds.  The fastest
+// run is the one least disturbed by the rest of the system.
+template<class F>
+double BestTime(int repeats, F f)
+{
+	double best = 1e30;
+	for(int r = 0; r < repeats; ++r)
+	{
+		auto start = std::chrono::steady_clock::now();
+		f();
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if(elapsed.count() < best)
+			best = elapsed.count();
+	}
+
+	return best;
+}
+
+// Stand-in for a mapped upload buffer: write-combined memory on Windows, as
+// an upload heap is, ordinary cached memory elsewhere.
+class MappedBuffer
+{
+public:
+	explicit MappedBuffer(std::size_t byteSize);
+	MappedBuffer(const MappedBuffer& rhs) = delete;
+	MappedBuffer& operator=(const MappedBuffer& rhs) = delete;
+	~MappedBuffer();
+
+	std::uint8_t* Data()const { return static_cast<std::uint8_t*>(mData); }
+
+private:
+	void* mData = nullptr;
+};
+
+// Each returns false if the paths it compares disagree.
+bool RunStencilBenchmark();
+bool RunUploadBenchmark();
+bool RunShallowWaterBenchmark();
+bool RunAdvanceBenchmark();
+bool RunLayoutBenchmark();
+bool RunMeshCacheBenchmark();
+bool RunVertexPackingBenchmark();
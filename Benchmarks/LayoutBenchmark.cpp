@@ -0,0 +1,180 @@
+//***************************************************************************************
+// LayoutBenchmark.cpp
+//
+// WaveSolver steps with row-major heights against heights in Z-ordered 8x8
+// bricks (MortonLayout), per grid cell.  Where the CPU's counters can be
+// read (perf events on Linux) it also counts last-level cache read misses
+// per cell; elsewhere those columns show n/a.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "WaveSolver.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Last-level cache read misses of this thread and the threads it starts
+	// from now on, or unavailable if the platform does not expose them.
+	class CacheMissCounter
+	{
+	public:
+		CacheMissCounter()
+		{
+#if defined(__linux__)
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_LL |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attr.disabled = 1;
+			attr.inherit = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			mFd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+
+		CacheMissCounter(const CacheMissCounter& rhs) = delete;
+		CacheMissCounter& operator=(const CacheMissCounter& rhs) = delete;
+
+		~CacheMissCounter()
+		{
+#if defined(__linux__)
+			if(mFd >= 0)
+				close(mFd);
+#endif
+		}
+
+		bool Available()const { return mFd >= 0; }
+
+		// Misses while f runs.
+		template<class F>
+		std::uint64_t Count(F f)
+		{
+#if defined(__linux__)
+			if(mFd >= 0)
+			{
+				ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+				f();
+				ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+
+				std::uint64_t count = 0;
+				if(read(mFd, &count, sizeof(count)) == sizeof(count))
+					return count;
+				return 0;
+			}
+#endif
+			f();
+			return 0;
+		}
+
+	private:
+		int mFd = -1;
+	};
+
+	template<class Solver>
+	std::unique_ptr<Solver> MakeSolver(int size, bool computeNormals)
+	{
+		auto solver = std::make_unique<Solver>(size, size, 1.0f, 0.03f, 4.0f, 0.2f);
+		solver->SetSleepThreshold(-1.0f);
+		solver->SetComputeTangentX(false);
+		solver->SetComputeNormals(computeNormals);
+		for(int k = 1; k <= 4; ++k)
+			solver->Disturb(size*k/5, size*(5 - k)/5, 0.5f*k);
+		return solver;
+	}
+
+	struct LayoutResult
+	{
+		double Seconds = 0.0;
+		std::uint64_t Misses = 0;
+	};
+
+	// Times steps steps, repeats times, then counts the misses of one more
+	// run of them.
+	template<class Solver>
+	LayoutResult TimeLayout(Solver& solver, int steps, int repeats, CacheMissCounter& counter)
+	{
+		auto run = [&]
+		{
+			for(int s = 0; s < steps; ++s)
+				solver.Update(solver.TimeStep());
+		};
+
+		LayoutResult result;
+		result.Seconds = BestTime(repeats, run);
+		result.Misses = counter.Count(run);
+		return result;
+	}
+
+	using MortonWaves = WaveSolver<float, ClampedBoundary, MortonLayout>;
+}
+
+bool RunLayoutBenchmark()
+{
+	const int repeats = 3;
+	bool passed = true;
+	CacheMissCounter counter;
+
+	std::printf("ns and LLC read misses per cell per step; row = RowMajorLayout, brick = MortonLayout\n");
+	std::printf("%6s %6s %-8s | %7s %7s %7s | %8s %8s\n",
+		"size", "steps", "normals", "row", "brick", "speedup", "row miss", "brk miss");
+
+	for(int size = 256; size <= 4096; size *= 2)
+	{
+		const double cells = (double)size*size;
+		int steps = (int)((1 << 25) / cells);
+		if(steps < 4)
+			steps = 4;
+
+		for(int normals = 0; normals < 2; ++normals)
+		{
+			// One grid at a time, so the largest size fits in memory.
+			LayoutResult row, brick;
+			std::vector<float> heights((size_t)size*size);
+			{
+				std::unique_ptr<Waves> solver = MakeSolver<Waves>(size, normals != 0);
+				row = TimeLayout(*solver, steps, repeats, counter);
+				for(int i = 0; i < solver->VertexCount(); ++i)
+					heights[i] = solver->Height(i);
+			}
+			{
+				std::unique_ptr<MortonWaves> solver = MakeSolver<MortonWaves>(size, normals != 0);
+				brick = TimeLayout(*solver, steps, repeats, counter);
+				for(int i = 0; i < solver->VertexCount() && passed; ++i)
+				{
+					float h = solver->Height(i);
+					if(std::memcmp(&h, &heights[i], sizeof(h)) != 0)
+					{
+						std::printf("  MISMATCH: the layouts' heights differ at %dx%d\n", size, size);
+						passed = false;
+					}
+				}
+			}
+
+			const double scale = 1e9 / (cells*steps);
+			std::printf("%6d %6d %-8s | %7.2f %7.2f %6.2fx | ", size, steps, normals ? "yes" : "no",
+				row.Seconds*scale, brick.Seconds*scale, row.Seconds/brick.Seconds);
+			if(counter.Available())
+				std::printf("%8.3f %8.3f\n", row.Misses / (cells*steps), brick.Misses / (cells*steps));
+			else
+				std::printf("%8s %8s\n", "n/a", "n/a");
+		}
+	}
+
+	return passed;
+}
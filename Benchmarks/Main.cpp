@@ -0,0 +1,65 @@
+//***************************************************************************************
+// Main.cpp
+//
+// Runs every benchmark, or only those named on the command line.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	struct Benchmark
+	{
+		const char* Name;
+		bool (*Run)();
+	};
+
+	const Benchmark Benchmarks[] =
+	{
+		{ "stencil", RunStencilBenchmark },
+		{ "upload", RunUploadBenchmark },
+		{ "shallowwater", RunShallowWaterBenchmark },
+		{ "advance", RunAdvanceBenchmark },
+		{ "layout", RunLayoutBenchmark },
+		{ "meshcache", RunMeshCacheBenchmark },
+		{ "vertexpacking", RunVertexPackingBenchmark },
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	for(int a = 1; a < argc; ++a)
+	{
+		bool known = false;
+		for(const Benchmark& b : Benchmarks)
+			known = known || std::strcmp(argv[a], b.Name) == 0;
+
+		if(!known)
+		{
+			std::printf("Unknown benchmark '%s'.  Benchmarks:", argv[a]);
+			for(const Benchmark& b : Benchmarks)
+				std::printf(" %s", b.Name);
+			std::printf("\n");
+			return 1;
+		}
+	}
+
+	bool passed = true;
+	for(const Benchmark& b : Benchmarks)
+	{
+		bool selected = argc == 1;
+		for(int a = 1; a < argc; ++a)
+			selected = selected || std::strcmp(argv[a], b.Name) == 0;
+
+		if(selected)
+		{
+			std::printf("== %s ==\n", b.Name);
+			passed = b.Run() && passed;
+			std::printf("\n");
+		}
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+//***************************************************************************************
+// MappedBuffer.cpp
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+MappedBuffer::MappedBuffer(std::size_t byteSize)
+{
+#if defined(_WIN32)
+	mData = VirtualAlloc(nullptr, byteSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE | PAGE_WRITECOMBINE);
+#else
+	mData = std::malloc(byteSize);
+#endif
+	// Touch every page up front, so the timings leave out page faults.
+	std::memset(mData, 0, byteSize);
+}
+
+MappedBuffer::~MappedBuffer()
+{
+#if defined(_WIN32)
+	VirtualFree(mData, 0, MEM_RELEASE);
+#else
+	std::free(mData);
+#endif
+}
@@ -0,0 +1,158 @@
+//***************************************************************************************
+// MeshCacheBenchmark.cpp
+//
+// Time to get a mesh and read every vertex of it, as a demo does at startup
+// when it fills its vertex buffer: straight from GeometryGenerator, from a
+// cold MeshCache (a miss, so the mesh is generated and stored), and from a
+// warm one (a hit, viewed in the mapped file).  The warm entries were just
+// written, so they are still in the OS file cache; a first run after a
+// reboot also pays for reading them off the disk.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "MeshCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct MeshCase
+	{
+		const char* Name;
+		std::function<std::vector<GeometryGenerator::MeshData>(GeometryGenerator&)> Generate;
+		std::function<std::vector<MeshCache::Mesh>(MeshCache&)> Lookup;
+	};
+
+	// What the demo's vertex fill reads.
+	template<class Vertices>
+	float ReadVertices(const Vertices& vertices)
+	{
+		float sum = 0.0f;
+		for(const GeometryGenerator::Vertex& v : vertices)
+			sum += v.Position.x + v.Normal.y + v.TexC.x;
+		return sum;
+	}
+
+	// The meshes, moved into a vector; an initializer list would copy them.
+	template<class Mesh, class... Meshes>
+	std::vector<Mesh> MeshList(Mesh&& first, Meshes&&... rest)
+	{
+		std::vector<Mesh> list;
+		list.reserve(1 + sizeof...(rest));
+		list.push_back(std::move(first));
+		int expand[] = { 0, (list.push_back(std::move(rest)), 0)... };
+		(void)expand;
+		return list;
+	}
+
+	double Seconds(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	bool SameMesh(const GeometryGenerator::MeshData& a, const MeshCache::Mesh& b)
+	{
+		return a.Vertices.size() == b.Vertices.size() &&
+			a.Indices32.size() == b.Indices32.size() &&
+			std::memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size()*sizeof(GeometryGenerator::Vertex)) == 0 &&
+			std::memcmp(a.Indices32.data(), b.Indices32.data(), a.Indices32.size()*sizeof(std::uint32_t)) == 0;
+	}
+}
+
+bool RunMeshCacheBenchmark()
+{
+	const int repeats = 5;
+	bool passed = true;
+
+	const MeshCase cases[] =
+	{
+		{
+			"shapes demo",
+			[](GeometryGenerator& g) { return MeshList(
+				g.CreateBox(1.5f, 0.5f, 1.5f, 3), g.CreateGrid(20.0f, 30.0f, 60, 40),
+				g.CreateSphere(0.5f, 20, 20), g.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20)); },
+			[](MeshCache& c) { return MeshList(
+				c.CreateBox(1.5f, 0.5f, 1.5f, 3), c.CreateGrid(20.0f, 30.0f, 60, 40),
+				c.CreateSphere(0.5f, 20, 20), c.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20)); },
+		},
+		{
+			"geosphere 6",
+			[](GeometryGenerator& g) { return MeshList(g.CreateGeosphere(1.0f, 6)); },
+			[](MeshCache& c) { return MeshList(c.CreateGeosphere(1.0f, 6)); },
+		},
+		{
+			"sphere 512",
+			[](GeometryGenerator& g) { return MeshList(g.CreateSphere(1.0f, 512, 512)); },
+			[](MeshCache& c) { return MeshList(c.CreateSphere(1.0f, 512, 512)); },
+		},
+		{
+			"grid 1024",
+			[](GeometryGenerator& g) { return MeshList(g.CreateGrid(160.0f, 160.0f, 1024, 1024)); },
+			[](MeshCache& c) { return MeshList(c.CreateGrid(160.0f, 160.0f, 1024, 1024)); },
+		},
+	};
+
+	GeometryGenerator generator;
+	MeshCache cache(MeshCache::ExecutableDirectory() + L"\\MeshCacheBenchmark");
+	float sink = 0.0f;
+
+	std::printf("ms to get the meshes and read their vertices; cold = miss (generate + store), warm = mapped hit\n");
+	std::printf("%-12s %9s | %9s %9s %9s | %8s\n", "meshes", "vertices", "generate", "cold", "warm", "speedup");
+
+	for(const MeshCase& c : cases)
+	{
+		const double generate = BestTime(repeats, [&]
+		{
+			for(const GeometryGenerator::MeshData& mesh : c.Generate(generator))
+				sink += ReadVertices(mesh.Vertices);
+		});
+
+		// Each cold run starts from an empty cache; the clearing is not timed.
+		double cold = 1e30;
+		for(int r = 0; r < repeats; ++r)
+		{
+			cache.Clear();
+			auto start = std::chrono::steady_clock::now();
+			for(const MeshCache::Mesh& mesh : c.Lookup(cache))
+				sink += ReadVertices(mesh.Vertices);
+			double seconds = Seconds(start);
+			if(seconds < cold)
+				cold = seconds;
+		}
+
+		const double warm = BestTime(repeats, [&]
+		{
+			for(const MeshCache::Mesh& mesh : c.Lookup(cache))
+				sink += ReadVertices(mesh.Vertices);
+		});
+
+		std::size_t vertexCount = 0;
+		std::vector<GeometryGenerator::MeshData> reference = c.Generate(generator);
+		std::vector<MeshCache::Mesh> cached = c.Lookup(cache);
+		for(std::size_t m = 0; m < reference.size(); ++m)
+		{
+			vertexCount += reference[m].Vertices.size();
+			if(!SameMesh(reference[m], cached[m]))
+			{
+				std::printf("  MISMATCH: the cached %s differs from the generated one\n", c.Name);
+				passed = false;
+			}
+		}
+
+		std::printf("%-12s %9zu | %9.3f %9.3f %9.3f | %7.2fx\n", c.Name, vertexCount,
+			generate*1e3, cold*1e3, warm*1e3, generate/warm);
+	}
+
+	cache.Clear();
+
+	// Keeps the reads from being optimized away.
+	if(sink == 1e30f)
+		std::printf("%f\n", sink);
+
+	return passed;
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// ShallowWaterBenchmark.cpp
+//
+// Throughput of ShallowWaterSolver against the WaveSolver the demos use, per
+// grid cell and step, with and without writing the vertices out.  The shallow
+// water derives its normals when the vertices are written, while WaveSolver
+// keeps them up to date every step, so only the second pair of columns
+// compares like with like.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "ShallowWaterSolver.h"
+#include "WaveSolver.h"
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	const float SpatialStep = 1.0f;
+	const float TimeStep = 0.02f;
+
+	// Runs steps fixed steps, each followed by a full vertex write if
+	// vertices is not null.
+	template<class Solver>
+	void Run(Solver& solver, int steps, WaveVertex* vertices)
+	{
+		for(int s = 0; s < steps; ++s)
+		{
+			solver.Update(TimeStep);
+			if(vertices)
+				solver.WriteVertices(0, solver.RowCount(), vertices);
+		}
+	}
+}
+
+bool RunShallowWaterBenchmark()
+{
+	const int repeats = 3;
+
+	std::printf("ns per cell per step; waves = WaveSolver, shallow = ShallowWaterSolver\n");
+	std::printf("%6s %6s | %-24s | %-24s\n", "", "", "step", "step + WriteVertices");
+	std::printf("%6s %6s | %7s %8s %7s | %7s %8s %7s\n",
+		"size", "steps", "waves", "shallow", "ratio", "waves", "shallow", "ratio");
+
+	for(int size = 256; size <= 2048; size *= 2)
+	{
+		const double cells = (double)size*size;
+		int steps = (int)((1 << 24) / cells);
+		if(steps < 4)
+			steps = 4;
+
+		std::vector<WaveVertex> vertices((size_t)size*size);
+		WaveImpulse impulses[4];
+		for(int k = 0; k < 4; ++k)
+			impulses[k] = { size*(k - 1.5f)*0.2f, size*(1.5f - k)*0.2f, 8.0f, 0.5f };
+
+		// Water everywhere, two units deep over a flat bed, so every cell of
+		// both solvers does the same work.
+		double waves, wavesWrite, shallow, shallowWrite;
+		{
+			Waves solver(size, size, SpatialStep, TimeStep, 4.0f, 0.2f);
+			solver.SetSleepThreshold(-1.0f);
+			solver.SetTimeStep(TimeStep);
+			solver.DisturbBatch(impulses, 4);
+			waves = BestTime(repeats, [&] { Run(solver, steps, nullptr); });
+			wavesWrite = BestTime(repeats, [&] { Run(solver, steps, vertices.data()); });
+		}
+		{
+			ShallowWaterSolver solver(size, size, SpatialStep, TimeStep, 0.1f);
+			solver.Flood(2.0f);
+			solver.DisturbBatch(impulses, 4);
+			shallow = BestTime(repeats, [&] { Run(solver, steps, nullptr); });
+			shallowWrite = BestTime(repeats, [&] { Run(solver, steps, vertices.data()); });
+		}
+
+		const double scale = 1e9 / (cells*steps);
+		std::printf("%6d %6d | %7.2f %8.2f %6.2fx | %7.2f %8.2f %6.2fx\n", size, steps,
+			waves*scale, shallow*scale, shallow/waves,
+			wavesWrite*scale, shallowWrite*scale, shallowWrite/wavesWrite);
+	}
+
+	return true;
+}
@@ -0,0 +1,225 @@
+//***************************************************************************************
+// StencilBenchmark.cpp
+//
+// Time per grid cell of one wave step, from 256x256 to 4096x4096, for the
+// original array-of-structures Waves update and for WaveSolver.  The small
+// grids fit in cache; the large ones stream from memory every step.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "WaveSolver.h"
+#include <DirectXMath.h>
+#include <ppl.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The demos' wave parameters.
+	const float SpatialStep = 1.0f;
+	const float TimeStep = 0.03f;
+	const float Speed = 4.0f;
+	const float Damping = 0.2f;
+
+	// The update every demo shipped with before WaveSolver: whole vertices
+	// (x, y, z) per solution, heights read through the y member, and normals
+	// and tangents recomputed over the whole grid after every step.
+	class ReferenceWaves
+	{
+	public:
+		ReferenceWaves(int m, int n, float dx, float dt, float speed, float damping) :
+			mNumRows(m), mNumCols(n), mSpatialStep(dx)
+		{
+			float d = damping*dt + 2.0f;
+			float e = (speed*speed)*(dt*dt) / (dx*dx);
+			mK1 = (damping*dt - 2.0f) / d;
+			mK2 = (4.0f - 8.0f*e) / d;
+			mK3 = (2.0f*e) / d;
+
+			mPrevSolution.resize(m*n);
+			mCurrSolution.resize(m*n);
+			mNormals.resize(m*n);
+			mTangentX.resize(m*n);
+
+			float halfWidth = (n - 1)*dx*0.5f;
+			float halfDepth = (m - 1)*dx*0.5f;
+			for(int i = 0; i < m; ++i)
+			{
+				float z = halfDepth - i*dx;
+				for(int j = 0; j < n; ++j)
+				{
+					float x = -halfWidth + j*dx;
+
+					mPrevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
+					mCurrSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
+					mNormals[i*n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+					mTangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				}
+			}
+		}
+
+		float Height(int i)const { return mCurrSolution[i].y; }
+
+		void Step(bool computeNormals)
+		{
+			const int n = mNumCols;
+
+			concurrency::parallel_for(1, mNumRows - 1, [this, n](int i)
+			{
+				for(int j = 1; j < n-1; ++j)
+				{
+					mPrevSolution[i*n+j].y =
+						mK1*mPrevSolution[i*n+j].y +
+						mK2*mCurrSolution[i*n+j].y +
+						mK3*(mCurrSolution[(i+1)*n+j].y +
+						     mCurrSolution[(i-1)*n+j].y +
+						     mCurrSolution[i*n+j+1].y +
+						     mCurrSolution[i*n+j-1].y);
+				}
+			});
+
+			std::swap(mPrevSolution, mCurrSolution);
+
+			if(!computeNormals)
+				return;
+
+			concurrency::parallel_for(1, mNumRows - 1, [this, n](int i)
+			{
+				for(int j = 1; j < n-1; ++j)
+				{
+					float l = mCurrSolution[i*n+j-1].y;
+					float r = mCurrSolution[i*n+j+1].y;
+					float t = mCurrSolution[(i-1)*n+j].y;
+					float b = mCurrSolution[(i+1)*n+j].y;
+					mNormals[i*n+j].x = -r+l;
+					mNormals[i*n+j].y = 2.0f*mSpatialStep;
+					mNormals[i*n+j].z = b-t;
+
+					XMVECTOR N = XMVector3Normalize(XMLoadFloat3(&mNormals[i*n+j]));
+					XMStoreFloat3(&mNormals[i*n+j], N);
+
+					mTangentX[i*n+j] = XMFLOAT3(2.0f*mSpatialStep, r-l, 0.0f);
+					XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&mTangentX[i*n+j]));
+					XMStoreFloat3(&mTangentX[i*n+j], T);
+				}
+			});
+		}
+
+		void Disturb(int i, int j, float magnitude)
+		{
+			float halfMag = 0.5f*magnitude;
+
+			mCurrSolution[i*mNumCols+j].y     += magnitude;
+			mCurrSolution[i*mNumCols+j+1].y   += halfMag;
+			mCurrSolution[i*mNumCols+j-1].y   += halfMag;
+			mCurrSolution[(i+1)*mNumCols+j].y += halfMag;
+			mCurrSolution[(i-1)*mNumCols+j].y += halfMag;
+		}
+
+	private:
+		int mNumRows;
+		int mNumCols;
+		float mSpatialStep;
+		float mK1, mK2, mK3;
+
+		std::vector<XMFLOAT3> mPrevSolution;
+		std::vector<XMFLOAT3> mCurrSolution;
+		std::vector<XMFLOAT3> mNormals;
+		std::vector<XMFLOAT3> mTangentX;
+	};
+
+	// The same handful of drops on either grid, so both evolve alike.
+	template<class W>
+	void DropRipples(W& waves, int size)
+	{
+		for(int k = 1; k <= 4; ++k)
+			waves.Disturb(size*k/5, size*(5 - k)/5, 0.5f*k);
+	}
+
+	struct StencilTimes
+	{
+		double Reference = 0.0;
+		double Solver = 0.0;
+		bool Match = true;
+	};
+
+	// Times steps steps of both, repeats times each, and compares the heights
+	// they end with.  Only one grid is alive at a time, so the largest size
+	// fits in memory.
+	StencilTimes TimeSteps(int size, int steps, int repeats, bool computeNormals)
+	{
+		StencilTimes times;
+		std::vector<float> referenceHeights;
+
+		{
+			ReferenceWaves reference(size, size, SpatialStep, TimeStep, Speed, Damping);
+			DropRipples(reference, size);
+			times.Reference = BestTime(repeats, [&]
+			{
+				for(int s = 0; s < steps; ++s)
+					reference.Step(computeNormals);
+			});
+
+			referenceHeights.resize((size_t)size*size);
+			for(int i = 0; i < size*size; ++i)
+				referenceHeights[i] = reference.Height(i);
+		}
+
+		Waves solver(size, size, SpatialStep, TimeStep, Speed, Damping);
+		solver.SetComputeNormals(computeNormals);
+		solver.SetSleepThreshold(-1.0f);
+		DropRipples(solver, size);
+		times.Solver = BestTime(repeats, [&]
+		{
+			for(int s = 0; s < steps; ++s)
+				solver.Update(solver.TimeStep());
+		});
+
+		for(int i = 0; i < size*size && times.Match; ++i)
+		{
+			float h = solver.Height(i);
+			times.Match = std::memcmp(&h, &referenceHeights[i], sizeof(float)) == 0;
+		}
+
+		return times;
+	}
+}
+
+bool RunStencilBenchmark()
+{
+	const int repeats = 3;
+	bool passed = true;
+
+	std::printf("ns per cell per step; reference = original AoS Waves, solver = WaveSolver\n");
+	std::printf("%6s %6s | %-28s | %-28s\n", "", "", "heights only", "heights + normals + tangents");
+	std::printf("%6s %6s | %9s %9s %8s | %9s %9s %8s\n",
+		"size", "steps", "reference", "solver", "speedup", "reference", "solver", "speedup");
+
+	for(int size = 256; size <= 4096; size *= 2)
+	{
+		// About 2^26 cell updates per timed run, whatever the size.
+		const double cells = (double)size*size;
+		int steps = (int)((1 << 26) / cells);
+		if(steps < 4)
+			steps = 4;
+
+		StencilTimes heights = TimeSteps(size, steps, repeats, false);
+		StencilTimes full = TimeSteps(size, steps, repeats, true);
+
+		const double scale = 1e9 / (cells*steps);
+		std::printf("%6d %6d | %9.2f %9.2f %7.2fx | %9.2f %9.2f %7.2fx\n", size, steps,
+			heights.Reference*scale, heights.Solver*scale, heights.Reference/heights.Solver,
+			full.Reference*scale, full.Solver*scale, full.Reference/full.Solver);
+
+		if(!heights.Match || !full.Match)
+		{
+			std::printf("  MISMATCH: WaveSolver heights differ from the reference at %dx%d\n", size, size);
+			passed = false;
+		}
+	}
+
+	return passed;
+}
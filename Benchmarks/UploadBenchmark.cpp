@@ -0,0 +1,93 @@
+//***************************************************************************************
+// UploadBenchmark.cpp
+//
+// Bytes per second written into a vertex upload buffer by the demos' old
+// per-vertex UpdateWaves loop and by WaveSolver::WriteVertices.  On Windows
+// the destination is write-combined memory, as an upload heap is.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "WaveSolver.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The loop every water demo ran before WriteVertices: a vertex built per
+	// grid point, two divisions for its tex-coords, and one memcpy per
+	// element into the buffer, as UploadBuffer::CopyData does.
+	void CopyVerticesPerElement(const Waves& waves, std::uint8_t* mappedData)
+	{
+		for(int i = 0; i < waves.VertexCount(); ++i)
+		{
+			WaveVertex v;
+
+			v.Pos = waves.Position(i);
+			v.Normal = waves.Normal(i);
+
+			v.TexC.x = 0.5f + v.Pos.x / waves.Width();
+			v.TexC.y = 0.5f - v.Pos.z / waves.Depth();
+
+			std::memcpy(&mappedData[i*sizeof(WaveVertex)], &v, sizeof(WaveVertex));
+		}
+	}
+}
+
+bool RunUploadBenchmark()
+{
+	const int repeats = 5;
+	bool passed = true;
+
+	std::printf("GB/s of vertices written to %s memory\n",
+#if defined(_WIN32)
+		"write-combined"
+#else
+		"ordinary cached"
+#endif
+		);
+	std::printf("%6s %10s | %12s %14s %8s\n", "size", "MB/frame", "per-element", "WriteVertices", "speedup");
+
+	for(int size = 128; size <= 2048; size *= 4)
+	{
+		Waves waves(size, size, 1.0f, 0.03f, 4.0f, 0.2f);
+		for(int k = 1; k <= 4; ++k)
+			waves.Disturb(size*k/5, size*(5 - k)/5, 0.5f*k);
+		for(int s = 0; s < 20; ++s)
+			waves.Update(waves.TimeStep());
+
+		const size_t byteSize = (size_t)waves.VertexCount()*sizeof(WaveVertex);
+		MappedBuffer oldBuffer(byteSize);
+		MappedBuffer newBuffer(byteSize);
+
+		// Around 256 MB written per timed run.
+		const int frames = (int)((256u << 20) / byteSize) + 1;
+
+		double perElement = BestTime(repeats, [&]
+		{
+			for(int f = 0; f < frames; ++f)
+				CopyVerticesPerElement(waves, oldBuffer.Data());
+		});
+
+		double bulk = BestTime(repeats, [&]
+		{
+			for(int f = 0; f < frames; ++f)
+				waves.WriteVertices(0, waves.RowCount(), reinterpret_cast<WaveVertex*>(newBuffer.Data()));
+		});
+
+		const double bytes = (double)byteSize*frames;
+		std::printf("%6d %10.2f | %12.2f %14.2f %7.2fx\n", size, byteSize / double(1 << 20),
+			bytes / perElement * 1e-9, bytes / bulk * 1e-9, perElement / bulk);
+
+		// Reading write-combined memory back is slow, but only done once.
+		if(std::memcmp(oldBuffer.Data(), newBuffer.Data(), byteSize) != 0)
+		{
+			std::printf("  MISMATCH: WriteVertices wrote different vertices at %dx%d\n", size, size);
+			passed = false;
+		}
+	}
+
+	return passed;
+}
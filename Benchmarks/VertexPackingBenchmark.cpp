@@ -0,0 +1,127 @@
+//***************************************************************************************
+// VertexPackingBenchmark.cpp
+//
+// Packs the skull and the shapes demo's meshes with PackMesh, prints the error
+// each picked up and the bytes it saved, and times copying both vertex sizes
+// into an upload buffer, as a demo does when it fills its vertex buffer.
+//***************************************************************************************
+
+#include "Benchmark.h"
+#include "VertexPacking.h"
+#include "../Tests/TestMeshes.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	struct PackingCase
+	{
+		const char* Name;
+		GeometryGenerator::MeshData Mesh;
+	};
+
+	bool FiniteReport(const PackingReport& report)
+	{
+		return std::isfinite(report.MaxPositionError) && std::isfinite(report.MaxNormalErrorDegrees) &&
+			std::isfinite(report.MaxTangentErrorDegrees) && std::isfinite(report.MaxTexCError);
+	}
+
+	// Copies byteSize bytes into buffer enough times to write around 256 MB,
+	// and returns the best time of repeats runs.
+	double TimeUpload(int repeats, const void* data, std::size_t byteSize, MappedBuffer& buffer, int& copies)
+	{
+		copies = (int)((256u << 20) / byteSize) + 1;
+		const int n = copies;
+		return BestTime(repeats, [&]
+		{
+			for(int c = 0; c < n; ++c)
+				std::memcpy(buffer.Data(), data, byteSize);
+		});
+	}
+}
+
+bool RunVertexPackingBenchmark()
+{
+	const int repeats = 5;
+	bool passed = true;
+
+	GeometryGenerator generator;
+	std::vector<PackingCase> cases;
+	cases.push_back({ "box", generator.CreateBox(1.5f, 0.5f, 1.5f, 3) });
+	cases.push_back({ "grid", generator.CreateGrid(20.0f, 30.0f, 60, 40) });
+	cases.push_back({ "sphere", generator.CreateSphere(0.5f, 20, 20) });
+	cases.push_back({ "geosphere", generator.CreateGeosphere(0.5f, 3) });
+	cases.push_back({ "cylinder", generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20) });
+
+	PackingCase skull = { "skull", GeometryGenerator::MeshData() };
+	if(LoadSkull(skull.Mesh))
+		cases.insert(cases.begin(), skull);
+	else
+	{
+		std::printf("  FAILED: could not read ../Models/skull.txt\n");
+		passed = false;
+	}
+
+	std::printf("largest packing error per mesh: position in mesh units, directions in degrees\n");
+	std::printf("%-10s %8s | %10s %8s %8s %10s | %9s %9s\n", "mesh", "vertices",
+		"position", "normal", "tangent", "texc", "bytes", "packed");
+
+	std::vector<PackedMesh> packed(cases.size());
+	for(std::size_t m = 0; m < cases.size(); ++m)
+	{
+		const PackingReport report = PackMesh(cases[m].Mesh, packed[m]);
+		std::printf("%-10s %8zu | %10.2e %8.4f %8.4f %10.2e | %9zu %9zu\n", cases[m].Name,
+			cases[m].Mesh.Vertices.size(), report.MaxPositionError, report.MaxNormalErrorDegrees,
+			report.MaxTangentErrorDegrees, report.MaxTexCError, report.VertexBytesBefore, report.VertexBytesAfter);
+
+		if(!FiniteReport(report))
+		{
+			std::printf("  MISMATCH: %s has a non-finite packing error\n", cases[m].Name);
+			passed = false;
+		}
+	}
+
+	std::printf("\nms to copy each mesh's vertices into %s memory, around 256 MB per run\n",
+#if defined(_WIN32)
+		"write-combined"
+#else
+		"ordinary cached"
+#endif
+		);
+	std::printf("%-10s | %9s %9s | %9s %9s | %8s\n", "mesh", "full ms", "GB/s", "packed ms", "GB/s", "speedup");
+
+	for(std::size_t m = 0; m < cases.size(); ++m)
+	{
+		const std::vector<GeometryGenerator::Vertex>& vertices = cases[m].Mesh.Vertices;
+		const std::size_t fullBytes = vertices.size()*sizeof(GeometryGenerator::Vertex);
+		const std::size_t packedBytes = packed[m].Vertices.size()*sizeof(PackedVertex);
+		if(fullBytes == 0)
+			continue;
+
+		MappedBuffer fullBuffer(fullBytes);
+		MappedBuffer packedBuffer(packedBytes);
+
+		int fullCopies = 0;
+		int packedCopies = 0;
+		const double full = TimeUpload(repeats, vertices.data(), fullBytes, fullBuffer, fullCopies);
+		const double small = TimeUpload(repeats, packed[m].Vertices.data(), packedBytes, packedBuffer, packedCopies);
+
+		if(std::memcmp(fullBuffer.Data(), vertices.data(), fullBytes) != 0 ||
+		   std::memcmp(packedBuffer.Data(), packed[m].Vertices.data(), packedBytes) != 0)
+		{
+			std::printf("  MISMATCH: the copied %s vertices differ from the source\n", cases[m].Name);
+			passed = false;
+		}
+
+		// Per copy of the mesh, so the two columns compare directly.
+		const double fullPerCopy = full/fullCopies;
+		const double packedPerCopy = small/packedCopies;
+		std::printf("%-10s | %9.4f %9.2f | %9.4f %9.2f | %7.2fx\n", cases[m].Name,
+			fullPerCopy*1e3, fullBytes/fullPerCopy/1e9,
+			packedPerCopy*1e3, packedBytes/packedPerCopy/1e9, fullPerCopy/packedPerCopy);
+	}
+
+	return passed;
+}
@@ -3,6 +3,7 @@
 #include <d3d12.h>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
 #include <iomanip>
 #include "d3dx12.h"
 #include "DxException.h"
@@ -40,6 +41,16 @@ namespace d3dUtil
 		DXGI_FORMAT IndexFormat;
 		UINT IndexBufferSize;
 
+		// A vertex buffer can instead hold one tightly packed stream per
+		// attribute, back to back, each bound to its own input slot.  Streams
+		// are listed in slot order; VertexStride is unused then.
+		struct VertexStream
+		{
+			UINT Offset = 0;
+			UINT Stride = 0;
+		};
+		std::vector<VertexStream> VertexStreams;
+
 		std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
 
 		D3D12_VERTEX_BUFFER_VIEW VertexBufferView()
@@ -52,6 +63,26 @@ namespace d3dUtil
 			return vbv;
 		}
 
+		// Writes the views for slots 0 to n-1, one per stream or the single
+		// interleaved view, and returns n.
+		UINT VertexBufferViews(D3D12_VERTEX_BUFFER_VIEW* views)
+		{
+			if(VertexStreams.empty())
+			{
+				views[0] = VertexBufferView();
+				return 1;
+			}
+
+			for(size_t i = 0; i < VertexStreams.size(); ++i)
+			{
+				UINT end = i + 1 < VertexStreams.size() ? VertexStreams[i + 1].Offset : VertexBufferSize;
+				views[i].BufferLocation = VertexBufferGPU->GetGPUVirtualAddress() + VertexStreams[i].Offset;
+				views[i].SizeInBytes = end - VertexStreams[i].Offset;
+				views[i].StrideInBytes = VertexStreams[i].Stride;
+			}
+			return (UINT)VertexStreams.size();
+		}
+
 		D3D12_INDEX_BUFFER_VIEW IndexBufferView()
 		{
 			D3D12_INDEX_BUFFER_VIEW ibv;
@@ -3,10 +3,578 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include <ppl.h>
 #include <algorithm>
+#include <cassert>
+#include <unordered_map>
 
 using namespace DirectX;
 
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+
+	// One attribute of every vertex a generator writes: a member of a Vertex
+	// array, or a packed stream.
+	template<class T>
+	struct AttributeOutput
+	{
+		std::uint8_t* Data = nullptr;
+		std::size_t Stride = 0;
+
+		explicit operator bool()const { return Data != nullptr; }
+		T& operator[](std::size_t i)const { return *reinterpret_cast<T*>(Data + i*Stride); }
+	};
+
+	// Where a generator writes its vertices.  The generators skip the work for
+	// an attribute with nowhere to go.
+	struct VertexOutput
+	{
+		AttributeOutput<XMFLOAT3> Position;
+		AttributeOutput<XMFLOAT3> Normal;
+		AttributeOutput<XMFLOAT3> TangentU;
+		AttributeOutput<XMFLOAT2> TexC;
+
+		void Write(std::size_t i, const Vertex& v)const
+		{
+			if(Position) Position[i] = v.Position;
+			if(Normal) Normal[i] = v.Normal;
+			if(TangentU) TangentU[i] = v.TangentU;
+			if(TexC) TexC[i] = v.TexC;
+		}
+	};
+
+	template<class T>
+	AttributeOutput<T> AttributeOf(T* first, std::size_t stride)
+	{
+		AttributeOutput<T> attribute;
+		attribute.Data = reinterpret_cast<std::uint8_t*>(first);
+		attribute.Stride = stride;
+		return attribute;
+	}
+
+	// Every attribute of vertices, which must already be sized.
+	VertexOutput OutputTo(std::vector<Vertex>& vertices)
+	{
+		VertexOutput out;
+		if(!vertices.empty())
+		{
+			out.Position = AttributeOf(&vertices[0].Position, sizeof(Vertex));
+			out.Normal = AttributeOf(&vertices[0].Normal, sizeof(Vertex));
+			out.TangentU = AttributeOf(&vertices[0].TangentU, sizeof(Vertex));
+			out.TexC = AttributeOf(&vertices[0].TexC, sizeof(Vertex));
+		}
+		return out;
+	}
+
+	// Sizes the streams of the requested attributes and points at them.
+	VertexOutput OutputTo(GeometryGenerator::MeshStreams& mesh, uint32 attributes, uint32 vertexCount)
+	{
+		mesh.Attributes = attributes;
+		mesh.VertexCount = vertexCount;
+
+		VertexOutput out;
+		if(vertexCount == 0)
+			return out;
+
+		if(attributes & GeometryGenerator::AttributePosition)
+		{
+			mesh.Positions.resize(vertexCount);
+			out.Position = AttributeOf(mesh.Positions.data(), sizeof(XMFLOAT3));
+		}
+		if(attributes & GeometryGenerator::AttributeNormal)
+		{
+			mesh.Normals.resize(vertexCount);
+			out.Normal = AttributeOf(mesh.Normals.data(), sizeof(XMFLOAT3));
+		}
+		if(attributes & GeometryGenerator::AttributeTangentU)
+		{
+			mesh.TangentUs.resize(vertexCount);
+			out.TangentU = AttributeOf(mesh.TangentUs.data(), sizeof(XMFLOAT3));
+		}
+		if(attributes & GeometryGenerator::AttributeTexC)
+		{
+			mesh.TexCs.resize(vertexCount);
+			out.TexC = AttributeOf(mesh.TexCs.data(), sizeof(XMFLOAT2));
+		}
+		return out;
+	}
+
+	// The requested attributes of an already built mesh, for the generators
+	// too small to be worth writing streams for directly.
+	GeometryGenerator::MeshStreams SplitStreams(const GeometryGenerator::MeshData& meshData, uint32 attributes)
+	{
+		GeometryGenerator::MeshStreams mesh;
+		VertexOutput out = OutputTo(mesh, attributes, (uint32)meshData.Vertices.size());
+		for(std::size_t i = 0; i < meshData.Vertices.size(); ++i)
+			out.Write(i, meshData.Vertices[i]);
+		mesh.Indices32 = meshData.Indices32;
+		return mesh;
+	}
+
+	// Below about this many vertices a parallel task costs more than it saves.
+	const uint32 MinTaskVertices = 16*1024;
+
+	// Calls build(firstRow, lastRow) over bands covering rows [0, rowCount),
+	// in parallel when there is more than one band.
+	template<class Build>
+	void ForEachRowBand(uint32 rowCount, uint32 rowVertices, const Build& build)
+	{
+		const uint32 bandRows = std::max<uint32>(1, MinTaskVertices / std::max<uint32>(1, rowVertices));
+		const int bandCount = (int)((rowCount + bandRows - 1) / bandRows);
+		if(bandCount <= 1)
+		{
+			if(rowCount > 0)
+				build(0u, rowCount);
+			return;
+		}
+
+		concurrency::parallel_for(0, bandCount, [&](int band)
+		{
+			const uint32 firstRow = band*bandRows;
+			build(firstRow, std::min(firstRow + bandRows, rowCount));
+		});
+	}
+
+	// Spacing of an m x n grid centered at the origin.
+	struct GridLayout
+	{
+		uint32 N;
+		float HalfWidth;
+		float HalfDepth;
+		float Dx;
+		float Dz;
+		float Du;
+		float Dv;
+	};
+
+	GridLayout MakeGridLayout(float width, float depth, uint32 m, uint32 n)
+	{
+		GridLayout grid;
+		grid.N = n;
+		grid.HalfWidth = 0.5f*width;
+		grid.HalfDepth = 0.5f*depth;
+		grid.Dx = width / (n-1);
+		grid.Dz = depth / (m-1);
+		grid.Du = 1.0f / (n-1);
+		grid.Dv = 1.0f / (m-1);
+		return grid;
+	}
+
+	// Vertex rows [firstRow, lastRow) of the grid, counting output rows from
+	// baseRow.
+	void WriteGridVertices(const GridLayout& grid, uint32 firstRow, uint32 lastRow, uint32 baseRow, const VertexOutput& out)
+	{
+		for(uint32 i = firstRow; i < lastRow; ++i)
+		{
+			float z = grid.HalfDepth - i*grid.Dz;
+			std::size_t v = (std::size_t)(i - baseRow)*grid.N;
+			for(uint32 j = 0; j < grid.N; ++j, ++v)
+			{
+				float x = -grid.HalfWidth + j*grid.Dx;
+
+				if(out.Position) out.Position[v] = XMFLOAT3(x, 0.0f, z);
+				if(out.Normal)   out.Normal[v]   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				if(out.TangentU) out.TangentU[v] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				// Stretch texture over grid.
+				if(out.TexC) out.TexC[v] = XMFLOAT2(j*grid.Du, i*grid.Dv);
+			}
+		}
+	}
+
+	// Indices of quad rows [firstRow, lastRow) of an n column grid, counting
+	// vertex rows from baseRow.
+	void WriteGridIndices(uint32 n, uint32 firstRow, uint32 lastRow, uint32 baseRow, uint32* indices)
+	{
+		for(uint32 i = firstRow - baseRow; i < lastRow - baseRow; ++i)
+		{
+			for(uint32 j = 0; j < n-1; ++j)
+			{
+				indices[0] = i*n+j;
+				indices[1] = i*n+j+1;
+				indices[2] = (i+1)*n+j;
+
+				indices[3] = (i+1)*n+j;
+				indices[4] = i*n+j+1;
+				indices[5] = (i+1)*n+j+1;
+
+				indices += 6; // next quad
+			}
+		}
+	}
+
+	// cos and sin of each of the sliceCount+1 angles around a ring, shared by
+	// every ring of a mesh.
+	struct RingTable
+	{
+		std::vector<float> Cos;
+		std::vector<float> Sin;
+	};
+
+	void BuildRingTable(uint32 sliceCount, RingTable& ring)
+	{
+		float dTheta = 2.0f*XM_PI/sliceCount;
+
+		ring.Cos.resize(sliceCount + 1);
+		ring.Sin.resize(sliceCount + 1);
+		for(uint32 j = 0; j <= sliceCount; ++j)
+		{
+			ring.Cos[j] = cosf(j*dTheta);
+			ring.Sin[j] = sinf(j*dTheta);
+		}
+	}
+
+	uint32 SphereVertexCount(uint32 sliceCount, uint32 stackCount)
+	{
+		// Poles plus the rings between them.
+		return 2 + (stackCount - 1)*(sliceCount + 1);
+	}
+
+	uint32 SphereIndexCount(uint32 sliceCount, uint32 stackCount)
+	{
+		// Two triangles per quad except in the stacks touching the poles.
+		return 6*sliceCount*(stackCount - 1);
+	}
+
+	void WriteSphere(float radius, uint32 sliceCount, uint32 stackCount, const VertexOutput& out, uint32* indices)
+	{
+		// Add one because we duplicate the first and last vertex per ring
+		// since the texture coordinates are different.
+		uint32 ringVertexCount = sliceCount + 1;
+		uint32 ringCount = stackCount - 1;
+		uint32 vertexCount = SphereVertexCount(sliceCount, stackCount);
+
+		//
+		// Compute the vertices stating at the top pole and moving down the stacks.
+		//
+
+		// Poles: note that there will be texture coordinate distortion as there is
+		// not a unique point on the texture map to assign to the pole when mapping
+		// a rectangular texture onto a sphere.
+		Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+		Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+		out.Write(0, topVertex);
+		out.Write(vertexCount - 1, bottomVertex);
+
+		float phiStep   = XM_PI/stackCount;
+		float thetaStep = 2.0f*XM_PI/sliceCount;
+
+		RingTable ring;
+		BuildRingTable(sliceCount, ring);
+
+		// Compute vertices for each stack ring (do not count the poles as rings).
+		ForEachRowBand(ringCount, ringVertexCount, [&](uint32 firstRing, uint32 lastRing)
+		{
+			for(uint32 i = firstRing + 1; i <= lastRing; ++i)
+			{
+				float phi = i*phiStep;
+				float sinPhi = sinf(phi);
+				float cosPhi = cosf(phi);
+
+				// Vertices of ring.
+				std::size_t v = 1 + (std::size_t)(i - 1)*ringVertexCount;
+				for(uint32 j = 0; j <= sliceCount; ++j, ++v)
+				{
+					// spherical to cartesian
+					XMFLOAT3 position(radius*sinPhi*ring.Cos[j], radius*cosPhi, radius*sinPhi*ring.Sin[j]);
+
+					if(out.Position)
+						out.Position[v] = position;
+
+					if(out.Normal)
+						XMStoreFloat3(&out.Normal[v], XMVector3Normalize(XMLoadFloat3(&position)));
+
+					if(out.TangentU)
+					{
+						// Partial derivative of P with respect to theta
+						XMFLOAT3 tangent(-radius*sinPhi*ring.Sin[j], 0.0f, +radius*sinPhi*ring.Cos[j]);
+						XMStoreFloat3(&out.TangentU[v], XMVector3Normalize(XMLoadFloat3(&tangent)));
+					}
+
+					if(out.TexC)
+					{
+						float theta = j*thetaStep;
+						out.TexC[v] = XMFLOAT2(theta / XM_2PI, phi / XM_PI);
+					}
+				}
+			}
+		});
+
+		//
+		// Compute indices for top stack.  The top stack was written first to the vertex buffer
+		// and connects the top pole to the first ring.
+		//
+
+		uint32* k = indices;
+		for(uint32 i = 1; i <= sliceCount; ++i)
+		{
+			*k++ = 0;
+			*k++ = i+1;
+			*k++ = i;
+		}
+
+		//
+		// Compute indices for inner stacks (not connected to poles).
+		//
+
+		// Offset the indices to the index of the first vertex in the first ring.
+		// This is just skipping the top pole vertex.
+		uint32 baseIndex = 1;
+		ForEachRowBand(stackCount - 2, ringVertexCount, [&](uint32 firstStack, uint32 lastStack)
+		{
+			uint32* quad = &indices[3*sliceCount + 6*sliceCount*firstStack];
+			for(uint32 i = firstStack; i < lastStack; ++i)
+			{
+				for(uint32 j = 0; j < sliceCount; ++j)
+				{
+					quad[0] = baseIndex + i*ringVertexCount + j;
+					quad[1] = baseIndex + i*ringVertexCount + j+1;
+					quad[2] = baseIndex + (i+1)*ringVertexCount + j;
+
+					quad[3] = baseIndex + (i+1)*ringVertexCount + j;
+					quad[4] = baseIndex + i*ringVertexCount + j+1;
+					quad[5] = baseIndex + (i+1)*ringVertexCount + j+1;
+
+					quad += 6; // next quad
+				}
+			}
+		});
+
+		//
+		// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
+		// and connects the bottom pole to the bottom ring.
+		//
+
+		// South pole vertex was added last.
+		uint32 southPoleIndex = vertexCount - 1;
+
+		// Offset the indices to the index of the first vertex in the last ring.
+		baseIndex = southPoleIndex - ringVertexCount;
+
+		k = &indices[SphereIndexCount(sliceCount, stackCount) - 3*sliceCount];
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			*k++ = southPoleIndex;
+			*k++ = baseIndex+i;
+			*k++ = baseIndex+i+1;
+		}
+	}
+
+	// Projects the vertices of a geosphere level onto the sphere.  Only the
+	// positions of level are used.
+	void WriteGeosphere(const GeometryGenerator::MeshData& level, float radius, const VertexOutput& out)
+	{
+		for(uint32 i = 0; i < level.Vertices.size(); ++i)
+		{
+			// Project onto unit sphere.
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&level.Vertices[i].Position));
+
+			// Project onto sphere.
+			XMVECTOR p = radius*n;
+
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, p);
+
+			if(out.Position)
+				out.Position[i] = position;
+
+			if(out.Normal)
+				XMStoreFloat3(&out.Normal[i], n);
+
+			// The spherical coordinates are only needed for these.
+			if(!out.TexC && !out.TangentU)
+				continue;
+
+			// Derive texture coordinates from spherical coordinates.
+			float theta = atan2f(position.z, position.x);
+
+			// Put in [0, 2pi].
+			if(theta < 0.0f)
+				theta += XM_2PI;
+
+			float phi = acosf(position.y / radius);
+
+			if(out.TexC)
+				out.TexC[i] = XMFLOAT2(theta/XM_2PI, phi/XM_PI);
+
+			if(out.TangentU)
+			{
+				// Partial derivative of P with respect to theta
+				XMFLOAT3 tangent(-radius*sinf(phi)*sinf(theta), 0.0f, +radius*sinf(phi)*cosf(theta));
+				XMStoreFloat3(&out.TangentU[i], XMVector3Normalize(XMLoadFloat3(&tangent)));
+			}
+		}
+	}
+
+	uint32 CylinderVertexCount(uint32 sliceCount, uint32 stackCount, uint32 capCount)
+	{
+		// Each cap adds a ring and a center vertex.
+		return (stackCount + 1)*(sliceCount + 1) + capCount*(sliceCount + 2);
+	}
+
+	uint32 CylinderIndexCount(uint32 sliceCount, uint32 stackCount, uint32 capCount)
+	{
+		// Each cap adds a triangle per slice.
+		return 6*sliceCount*stackCount + capCount*3*sliceCount;
+	}
+
+	// A cap ring at height y with its normal along normalY, starting at vertex
+	// baseIndex, and a triangle per slice facing the same way.
+	void WriteCylinderCap(float radius, float y, float normalY, float height, uint32 sliceCount,
+		const RingTable& ring, const VertexOutput& out, uint32 baseIndex, uint32* indices)
+	{
+		// Duplicate cap ring vertices because the texture coordinates and normals differ.
+		for(uint32 i = 0; i <= sliceCount; ++i)
+		{
+			float x = radius*ring.Cos[i];
+			float z = radius*ring.Sin[i];
+
+			// Scale down by the height to try and make top cap texture coord area
+			// proportional to base.
+			float u = x/height + 0.5f;
+			float v = z/height + 0.5f;
+
+			out.Write(baseIndex + i, Vertex(x, y, z, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+		}
+
+		// Cap center vertex.
+		uint32 centerIndex = baseIndex + sliceCount + 1;
+		out.Write(centerIndex, Vertex(0.0f, y, 0.0f, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			*indices++ = centerIndex;
+			if(normalY > 0.0f)
+			{
+				*indices++ = baseIndex + i+1;
+				*indices++ = baseIndex + i;
+			}
+			else
+			{
+				*indices++ = baseIndex + i;
+				*indices++ = baseIndex + i+1;
+			}
+		}
+	}
+
+	void WriteCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+		bool hasTop, bool hasBottom, const VertexOutput& out, uint32* indices)
+	{
+		//
+		// Build Stacks.
+		// 
+
+		float stackHeight = height / stackCount;
+
+		// Amount to increment radius as we move up each stack level from bottom to top.
+		float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+		uint32 ringCount = stackCount+1;
+
+		// Add one because we duplicate the first and last vertex per ring
+		// since the texture coordinates are different.
+		uint32 ringVertexCount = sliceCount+1;
+
+		RingTable ring;
+		BuildRingTable(sliceCount, ring);
+
+		// Compute vertices for each stack ring starting at the bottom and moving up.
+		ForEachRowBand(ringCount, ringVertexCount, [&](uint32 firstRing, uint32 lastRing)
+		{
+			for(uint32 i = firstRing; i < lastRing; ++i)
+			{
+				float y = -0.5f*height + i*stackHeight;
+				float r = bottomRadius + i*radiusStep;
+
+				// vertices of ring
+				std::size_t vertex = (std::size_t)i*ringVertexCount;
+				for(uint32 j = 0; j <= sliceCount; ++j, ++vertex)
+				{
+					float c = ring.Cos[j];
+					float s = ring.Sin[j];
+
+					if(out.Position)
+						out.Position[vertex] = XMFLOAT3(r*c, y, r*s);
+
+					if(out.TexC)
+						out.TexC[vertex] = XMFLOAT2((float)j/sliceCount, 1.0f - (float)i/stackCount);
+
+					// Cylinder can be parameterized as follows, where we introduce v
+					// parameter that goes in the same direction as the v tex-coord
+					// so that the bitangent goes in the same direction as the v tex-coord.
+					//   Let r0 be the bottom radius and let r1 be the top radius.
+					//   y(v) = h - hv for v in [0,1].
+					//   r(v) = r1 + (r0-r1)v
+					//
+					//   x(t, v) = r(v)*cos(t)
+					//   y(t, v) = h - hv
+					//   z(t, v) = r(v)*sin(t)
+					// 
+					//  dx/dt = -r(v)*sin(t)
+					//  dy/dt = 0
+					//  dz/dt = +r(v)*cos(t)
+					//
+					//  dx/dv = (r0-r1)*cos(t)
+					//  dy/dv = -h
+					//  dz/dv = (r0-r1)*sin(t)
+
+					// This is unit length.
+					XMFLOAT3 tangent(-s, 0.0f, c);
+					if(out.TangentU)
+						out.TangentU[vertex] = tangent;
+
+					if(out.Normal)
+					{
+						float dr = bottomRadius-topRadius;
+						XMFLOAT3 bitangent(dr*c, -height, dr*s);
+
+						XMVECTOR T = XMLoadFloat3(&tangent);
+						XMVECTOR B = XMLoadFloat3(&bitangent);
+						XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+						XMStoreFloat3(&out.Normal[vertex], N);
+					}
+				}
+			}
+		});
+
+		// Compute indices for each stack.
+		ForEachRowBand(stackCount, ringVertexCount, [&](uint32 firstStack, uint32 lastStack)
+		{
+			uint32* k = &indices[6*sliceCount*firstStack];
+			for(uint32 i = firstStack; i < lastStack; ++i)
+			{
+				for(uint32 j = 0; j < sliceCount; ++j)
+				{
+					k[0] = i*ringVertexCount + j;
+					k[1] = (i+1)*ringVertexCount + j;
+					k[2] = (i+1)*ringVertexCount + j+1;
+
+					k[3] = i*ringVertexCount + j;
+					k[4] = (i+1)*ringVertexCount + j+1;
+					k[5] = i*ringVertexCount + j+1;
+
+					k += 6; // next quad
+				}
+			}
+		});
+
+		// The caps follow the stacks, top first.
+		uint32 baseIndex = ringCount*ringVertexCount;
+		indices += 6*sliceCount*stackCount;
+		if(hasTop)
+		{
+			WriteCylinderCap(topRadius, 0.5f*height, 1.0f, height, sliceCount, ring, out, baseIndex, indices);
+			baseIndex += sliceCount + 2;
+			indices += 3*sliceCount;
+		}
+		if(hasBottom)
+			WriteCylinderCap(bottomRadius, -0.5f*height, -1.0f, height, sliceCount, ring, out, baseIndex, indices);
+	}
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -100,125 +668,40 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
     return meshData;
 }
 
+GeometryGenerator::MeshStreams GeometryGenerator::CreateBoxStreams(float width, float height, float depth, uint32 numSubdivisions, uint32 attributes)
+{
+	// At most 24*4^6 vertices, so building every attribute costs little.
+	return SplitStreams(CreateBox(width, height, depth, numSubdivisions), attributes);
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
 {
     MeshData meshData;
 
-	//
-	// Compute the vertices stating at the top pole and moving down the stacks.
-	//
-
-	// Poles: note that there will be texture coordinate distortion as there is
-	// not a unique point on the texture map to assign to the pole when mapping
-	// a rectangular texture onto a sphere.
-	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-
-	meshData.Vertices.push_back( topVertex );
-
-	float phiStep   = XM_PI/stackCount;
-	float thetaStep = 2.0f*XM_PI/sliceCount;
-
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for(uint32 i = 1; i <= stackCount-1; ++i)
-	{
-		float phi = i*phiStep;
-
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			float theta = j*thetaStep;
-
-			Vertex v;
-
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
-
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
-
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
-
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
-
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
-
-			meshData.Vertices.push_back( v );
-		}
-	}
+	meshData.Vertices.resize(SphereVertexCount(sliceCount, stackCount));
+	meshData.Indices32.resize(SphereIndexCount(sliceCount, stackCount));
+	WriteSphere(radius, sliceCount, stackCount, OutputTo(meshData.Vertices), meshData.Indices32.data());
 
-	meshData.Vertices.push_back( bottomVertex );
-
-	//
-	// Compute indices for top stack.  The top stack was written first to the vertex buffer
-	// and connects the top pole to the first ring.
-	//
-
-    for(uint32 i = 1; i <= sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
-	}
-	
-	//
-	// Compute indices for inner stacks (not connected to poles).
-	//
-
-	// Offset the indices to the index of the first vertex in the first ring.
-	// This is just skipping the top pole vertex.
-    uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-	for(uint32 i = 0; i < stackCount-2; ++i)
-	{
-		for(uint32 j = 0; j < sliceCount; ++j)
-		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
-		}
-	}
-
-	//
-	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
-	// and connects the bottom pole to the bottom ring.
-	//
+    return meshData;
+}
 
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+GeometryGenerator::MeshStreams GeometryGenerator::CreateSphereStreams(float radius, uint32 sliceCount, uint32 stackCount, uint32 attributes)
+{
+	MeshStreams mesh;
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
-	
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
-	}
+	VertexOutput out = OutputTo(mesh, attributes, SphereVertexCount(sliceCount, stackCount));
+	mesh.Indices32.resize(SphereIndexCount(sliceCount, stackCount));
+	WriteSphere(radius, sliceCount, stackCount, out, mesh.Indices32.data());
 
-    return meshData;
+	return mesh;
 }
  
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
+	// The input triangles are replaced; the input vertices are kept and the
+	// edge midpoints are appended after them.
+	std::vector<uint32> inputIndices;
+	inputIndices.swap(meshData.Indices32);
 
 	//       v1
 	//       *
@@ -230,47 +713,49 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
+	uint32 numTris = (uint32)inputIndices.size()/3;
+
+	// Triangles sharing an edge share its midpoint.  A closed mesh has 3/2
+	// edges per triangle, so that is one new vertex per edge rather than
+	// three per triangle.
+	std::unordered_map<std::uint64_t, uint32> midpoints;
+	midpoints.reserve(numTris*3/2);
+	meshData.Vertices.reserve(meshData.Vertices.size() + numTris*3/2);
+	meshData.Indices32.resize(numTris*12);
+
+	auto midpoint = [&](uint32 a, uint32 b)
+	{
+		std::uint64_t edge = a < b ? (std::uint64_t)a << 32 | b : (std::uint64_t)b << 32 | a;
+		auto slot = midpoints.emplace(edge, (uint32)meshData.Vertices.size());
+		if(slot.second)
+			meshData.Vertices.push_back(MidPoint(meshData.Vertices[a], meshData.Vertices[b]));
+		return slot.first->second;
+	};
+
+	uint32* k = meshData.Indices32.data();
 	for(uint32 i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
+		uint32 v0 = inputIndices[i*3+0];
+		uint32 v1 = inputIndices[i*3+1];
+		uint32 v2 = inputIndices[i*3+2];
 
 		//
 		// Generate the midpoints.
 		//
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+		uint32 m0 = midpoint(v0, v1);
+		uint32 m1 = midpoint(v1, v2);
+		uint32 m2 = midpoint(v0, v2);
 
 		//
 		// Add new geometry.
 		//
 
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
+		k[0] = v0; k[1]  = m0; k[2]  = m2;
+		k[3] = m0; k[4]  = m1; k[5]  = m2;
+		k[6] = m2; k[7]  = m1; k[8]  = v2;
+		k[9] = m0; k[10] = v1; k[11] = m1;
+		k += 12;
 	}
 }
 
@@ -304,249 +789,109 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
     return v;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+const GeometryGenerator::MeshData& GeometryGenerator::GeosphereLevel(uint32 numSubdivisions)
 {
-    MeshData meshData;
-
-	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
-
-	// Approximate a sphere by tessellating an icosahedron.
-
-	const float X = 0.525731f; 
-	const float Z = 0.850651f;
-
-	XMFLOAT3 pos[12] = 
-	{
-		XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),  
-		XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),    
-		XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X), 
-		XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),    
-		XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f), 
-		XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
-	};
-
-    uint32 k[60] =
+	if(mGeosphereLevels.empty())
 	{
-		1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,    
-		1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,    
-		3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0, 
-		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
-	};
-
-    meshData.Vertices.resize(12);
-    meshData.Indices32.assign(&k[0], &k[60]);
+		// Approximate a sphere by tessellating an icosahedron.
 
-	for(uint32 i = 0; i < 12; ++i)
-		meshData.Vertices[i].Position = pos[i];
+		const float X = 0.525731f; 
+		const float Z = 0.850651f;
 
-	for(uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
-
-	// Project vertices onto sphere and scale.
-	for(uint32 i = 0; i < meshData.Vertices.size(); ++i)
-	{
-		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
-
-		// Project onto sphere.
-		XMVECTOR p = radius*n;
-
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
-
-		// Derive texture coordinates from spherical coordinates.
-        float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
-
-        // Put in [0, 2pi].
-        if(theta < 0.0f)
-            theta += XM_2PI;
-
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+		XMFLOAT3 pos[12] = 
+		{
+			XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),  
+			XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),    
+			XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X), 
+			XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),    
+			XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f), 
+			XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+		};
+
+		uint32 k[60] =
+		{
+			1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,    
+			1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,    
+			3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0, 
+			10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
+		};
 
-		meshData.Vertices[i].TexC.x = theta/XM_2PI;
-		meshData.Vertices[i].TexC.y = phi/XM_PI;
+		MeshData icosahedron;
+		icosahedron.Vertices.resize(12);
+		icosahedron.Indices32.assign(&k[0], &k[60]);
 
-		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
+		for(uint32 i = 0; i < 12; ++i)
+			icosahedron.Vertices[i].Position = pos[i];
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+		mGeosphereLevels.push_back(std::move(icosahedron));
 	}
 
-    return meshData;
-}
-
-GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
-	bool hasTop, bool hasBottom)
-{
-    MeshData meshData;
-
-	//
-	// Build Stacks.
-	// 
-
-	float stackHeight = height / stackCount;
-
-	// Amount to increment radius as we move up each stack level from bottom to top.
-	float radiusStep = (topRadius - bottomRadius) / stackCount;
-
-	uint32 ringCount = stackCount+1;
-
-	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for(uint32 i = 0; i < ringCount; ++i)
+	// Each level is the one before subdivided once.  With shared midpoints
+	// level L has 10*4^L + 2 vertices, the count Euler's formula gives.
+	while(mGeosphereLevels.size() <= numSubdivisions)
 	{
-		float y = -0.5f*height + i*stackHeight;
-		float r = bottomRadius + i*radiusStep;
-
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI/sliceCount;
-		for(uint32 j = 0; j <= sliceCount; ++j)
-		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j/sliceCount;
-			vertex.TexC.y = 1.0f - (float)i/stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius-topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
+		MeshData level = mGeosphereLevels.back();
+		Subdivide(level);
+		mGeosphereLevels.push_back(std::move(level));
 	}
 
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount+1;
+	return mGeosphereLevels[numSubdivisions];
+}
 
-	// Compute indices for each stack.
-	for(uint32 i = 0; i < stackCount; ++i)
-	{
-		for(uint32 j = 0; j < sliceCount; ++j)
-		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+{
+	// Put a cap on the number of subdivisions.
+    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
 
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i+1)*ringVertexCount + j+1);
-			meshData.Indices32.push_back(i*ringVertexCount + j+1);
-		}
-	}
+	const MeshData& level = GeosphereLevel(numSubdivisions);
 
-	if (hasTop) BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	if (hasBottom) BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+	MeshData meshData;
+	meshData.Vertices.resize(level.Vertices.size());
+	meshData.Indices32 = level.Indices32;
+	WriteGeosphere(level, radius, OutputTo(meshData.Vertices));
 
     return meshData;
 }
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-											uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+GeometryGenerator::MeshStreams GeometryGenerator::CreateGeosphereStreams(float radius, uint32 numSubdivisions, uint32 attributes)
 {
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-
-	float y = 0.5f*height;
-	float dTheta = 2.0f*XM_PI/sliceCount;
-
-	// Duplicate cap ring vertices because the texture coordinates and normals differ.
-	for(uint32 i = 0; i <= sliceCount; ++i)
-	{
-		float x = topRadius*cosf(i*dTheta);
-		float z = topRadius*sinf(i*dTheta);
-
-		// Scale down by the height to try and make top cap texture coord area
-		// proportional to base.
-		float u = x/height + 0.5f;
-		float v = z/height + 0.5f;
-
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
-	}
+    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
 
-	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
+	const MeshData& level = GeosphereLevel(numSubdivisions);
 
-	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+	MeshStreams mesh;
+	VertexOutput out = OutputTo(mesh, attributes, (uint32)level.Vertices.size());
+	mesh.Indices32 = level.Indices32;
+	WriteGeosphere(level, radius, out);
 
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i+1);
-		meshData.Indices32.push_back(baseIndex + i);
-	}
+	return mesh;
 }
 
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-											   uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+	bool hasTop, bool hasBottom)
 {
-	// 
-	// Build bottom cap.
-	//
-
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-	float y = -0.5f*height;
-
-	// vertices of ring
-	float dTheta = 2.0f*XM_PI/sliceCount;
-	for(uint32 i = 0; i <= sliceCount; ++i)
-	{
-		float x = bottomRadius*cosf(i*dTheta);
-		float z = bottomRadius*sinf(i*dTheta);
+    MeshData meshData;
 
-		// Scale down by the height to try and make top cap texture coord area
-		// proportional to base.
-		float u = x/height + 0.5f;
-		float v = z/height + 0.5f;
+	uint32 capCount = (hasTop ? 1 : 0) + (hasBottom ? 1 : 0);
+	meshData.Vertices.resize(CylinderVertexCount(sliceCount, stackCount, capCount));
+	meshData.Indices32.resize(CylinderIndexCount(sliceCount, stackCount, capCount));
+	WriteCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, hasTop, hasBottom,
+		OutputTo(meshData.Vertices), meshData.Indices32.data());
 
-		meshData.Vertices.push_back( Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v) );
-	}
+    return meshData;
+}
 
-	// Cap center vertex.
-	meshData.Vertices.push_back( Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f) );
+GeometryGenerator::MeshStreams GeometryGenerator::CreateCylinderStreams(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+	uint32 attributes, bool hasTop, bool hasBottom)
+{
+	MeshStreams mesh;
 
-	// Cache the index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+	uint32 capCount = (hasTop ? 1 : 0) + (hasBottom ? 1 : 0);
+	VertexOutput out = OutputTo(mesh, attributes, CylinderVertexCount(sliceCount, stackCount, capCount));
+	mesh.Indices32.resize(CylinderIndexCount(sliceCount, stackCount, capCount));
+	WriteCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, hasTop, hasBottom, out, mesh.Indices32.data());
 
-	for(uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i+1);
-	}
+	return mesh;
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
@@ -556,62 +901,82 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	uint32 vertexCount = m*n;
 	uint32 faceCount   = (m-1)*(n-1)*2;
 
+	GridLayout grid = MakeGridLayout(width, depth, m, n);
+
 	//
 	// Create the vertices.
 	//
 
-	float halfWidth = 0.5f*width;
-	float halfDepth = 0.5f*depth;
-
-	float dx = width / (n-1);
-	float dz = depth / (m-1);
-
-	float du = 1.0f / (n-1);
-	float dv = 1.0f / (m-1);
-
 	meshData.Vertices.resize(vertexCount);
-	for(uint32 i = 0; i < m; ++i)
+	VertexOutput out = OutputTo(meshData.Vertices);
+	ForEachRowBand(m, n, [&](uint32 firstRow, uint32 lastRow)
 	{
-		float z = halfDepth - i*dz;
-		for(uint32 j = 0; j < n; ++j)
-		{
-			float x = -halfWidth + j*dx;
-
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
-		}
-	}
+		WriteGridVertices(grid, firstRow, lastRow, 0, out);
+	});
  
     //
 	// Create the indices.
 	//
 
 	meshData.Indices32.resize(faceCount*3); // 3 indices per face
+	ForEachRowBand(m-1, n, [&](uint32 firstRow, uint32 lastRow)
+	{
+		WriteGridIndices(n, firstRow, lastRow, 0, &meshData.Indices32[6*firstRow*(n-1)]);
+	});
+
+    return meshData;
+}
+
+GeometryGenerator::MeshStreams GeometryGenerator::CreateGridStreams(float width, float depth, uint32 m, uint32 n, uint32 attributes)
+{
+	MeshStreams mesh;
+
+	GridLayout grid = MakeGridLayout(width, depth, m, n);
 
-	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for(uint32 i = 0; i < m-1; ++i)
+	VertexOutput out = OutputTo(mesh, attributes, m*n);
+	ForEachRowBand(m, n, [&](uint32 firstRow, uint32 lastRow)
 	{
-		for(uint32 j = 0; j < n-1; ++j)
+		WriteGridVertices(grid, firstRow, lastRow, 0, out);
+	});
+
+	mesh.Indices32.resize((m-1)*(n-1)*6);
+	ForEachRowBand(m-1, n, [&](uint32 firstRow, uint32 lastRow)
+	{
+		WriteGridIndices(n, firstRow, lastRow, 0, &mesh.Indices32[6*firstRow*(n-1)]);
+	});
+
+	return mesh;
+}
+
+void GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n, uint32 rowsPerChunk,
+	const std::function<void(uint32 firstRow, const MeshData& chunk)>& onChunk)
+{
+	assert(rowsPerChunk > 0);
+
+	GridLayout grid = MakeGridLayout(width, depth, m, n);
+
+	// Every chunk but the last is the same size, so the buffers are only ever
+	// allocated for the first.
+	MeshData chunk;
+	for(uint32 firstRow = 0; firstRow < m-1; firstRow += rowsPerChunk)
+	{
+		uint32 quadRows = std::min(rowsPerChunk, m-1 - firstRow);
+
+		chunk.Vertices.resize((quadRows + 1)*n);
+		VertexOutput out = OutputTo(chunk.Vertices);
+		ForEachRowBand(quadRows + 1, n, [&](uint32 first, uint32 last)
 		{
-			meshData.Indices32[k]   = i*n+j;
-			meshData.Indices32[k+1] = i*n+j+1;
-			meshData.Indices32[k+2] = (i+1)*n+j;
+			WriteGridVertices(grid, firstRow + first, firstRow + last, firstRow, out);
+		});
 
-			meshData.Indices32[k+3] = (i+1)*n+j;
-			meshData.Indices32[k+4] = i*n+j+1;
-			meshData.Indices32[k+5] = (i+1)*n+j+1;
+		chunk.Indices32.resize(6*quadRows*(n-1));
+		ForEachRowBand(quadRows, n, [&](uint32 first, uint32 last)
+		{
+			WriteGridIndices(n, firstRow + first, firstRow + last, firstRow, &chunk.Indices32[6*first*(n-1)]);
+		});
 
-			k += 6; // next quad
-		}
+		onChunk(firstRow, chunk);
 	}
-
-    return meshData;
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
@@ -16,6 +16,8 @@
 
 #include <cstdint>
 #include <DirectXMath.h>
+#include <functional>
+#include <stdexcept>
 #include <vector>
 
 class GeometryGenerator
@@ -58,20 +60,48 @@ public:
 		std::vector<Vertex> Vertices;
         std::vector<uint32> Indices32;
 
-        std::vector<uint16>& GetIndices16()
+		// The indices as 16 bits.  Throws std::out_of_range if one needs more:
+		// truncating it would draw the wrong vertex, and dropping the list
+		// would shift every submesh appended after it.  PackIndices splits
+		// such meshes.
+        std::vector<uint16> GetIndices16()const
         {
-			if(mIndices16.empty())
+			std::vector<uint16> indices16(Indices32.size());
+			for(size_t i = 0; i < Indices32.size(); ++i)
 			{
-				mIndices16.resize(Indices32.size());
-				for(size_t i = 0; i < Indices32.size(); ++i)
-					mIndices16[i] = static_cast<uint16>(Indices32[i]);
+				if(Indices32[i] > 0xFFFF)
+					throw std::out_of_range("GetIndices16: index does not fit in 16 bits; use PackIndices.");
+
+				indices16[i] = static_cast<uint16>(Indices32[i]);
 			}
 
-			return mIndices16;
+			return indices16;
         }
+	};
 
-	private:
-		std::vector<uint16> mIndices16;
+	// Vertex attributes a mesh can be generated with, combined with |.
+	enum VertexAttribute : uint32
+	{
+		AttributePosition = 0x1,
+		AttributeNormal   = 0x2,
+		AttributeTangentU = 0x4,
+		AttributeTexC     = 0x8,
+		AttributeAll      = 0xF
+	};
+
+	// A mesh with one tightly packed stream per requested attribute, each ready
+	// to copy as is into a vertex buffer for its own input slot.  The streams
+	// of attributes that were not requested are left empty.
+	struct MeshStreams
+	{
+		uint32 Attributes = 0;
+		uint32 VertexCount = 0;
+
+		std::vector<DirectX::XMFLOAT3> Positions;
+		std::vector<DirectX::XMFLOAT3> Normals;
+		std::vector<DirectX::XMFLOAT3> TangentUs;
+		std::vector<DirectX::XMFLOAT2> TexCs;
+		std::vector<uint32> Indices32;
 	};
 
 	///<summary>
@@ -80,18 +110,36 @@ public:
 	///</summary>
     MeshData CreateBox(float width, float height, float depth, uint32 numSubdivisions);
 
+	///<summary>
+	/// Creates the same box with only the given attributes, as separate streams.
+	///</summary>
+    MeshStreams CreateBoxStreams(float width, float height, float depth, uint32 numSubdivisions, uint32 attributes);
+
 	///<summary>
 	/// Creates a sphere centered at the origin with the given radius.  The
 	/// slices and stacks parameters control the degree of tessellation.
 	///</summary>
     MeshData CreateSphere(float radius, uint32 sliceCount, uint32 stackCount);
 
+	///<summary>
+	/// Creates the same sphere with only the given attributes, as separate
+	/// streams.  Attributes left out are never computed.
+	///</summary>
+    MeshStreams CreateSphereStreams(float radius, uint32 sliceCount, uint32 stackCount, uint32 attributes);
+
 	///<summary>
 	/// Creates a geosphere centered at the origin with the given radius.  The
-	/// depth controls the level of tessellation.
+	/// depth controls the level of tessellation.  Subdivided levels are kept,
+	/// so later geospheres from this generator only project and scale them.
 	///</summary>
     MeshData CreateGeosphere(float radius, uint32 numSubdivisions);
 
+	///<summary>
+	/// Creates the same geosphere with only the given attributes, as separate
+	/// streams.  Attributes left out are never computed.
+	///</summary>
+    MeshStreams CreateGeosphereStreams(float radius, uint32 numSubdivisions, uint32 attributes);
+
 	///<summary>
 	/// Creates a cylinder parallel to the y-axis, and centered about the origin.  
 	/// The bottom and top radius can vary to form various cone shapes rather than true
@@ -99,12 +147,34 @@ public:
 	///</summary>
     MeshData CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, bool hasTop = true, bool hasBottom = true);
 
+	///<summary>
+	/// Creates the same cylinder with only the given attributes, as separate
+	/// streams.  Attributes left out are never computed.
+	///</summary>
+    MeshStreams CreateCylinderStreams(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+        uint32 attributes, bool hasTop = true, bool hasBottom = true);
+
 	///<summary>
 	/// Creates an mxn grid in the xz-plane with m rows and n columns, centered
 	/// at the origin with the specified width and depth.
 	///</summary>
     MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
+	///<summary>
+	/// Creates the same grid with only the given attributes, as separate
+	/// streams.  Attributes left out are never computed.
+	///</summary>
+    MeshStreams CreateGridStreams(float width, float depth, uint32 m, uint32 n, uint32 attributes);
+
+	///<summary>
+	/// Streams the grid CreateGrid would build in bands of at most rowsPerChunk
+	/// quad rows, top to bottom, so the whole mesh is never held at once.  Each
+	/// band is its own mesh with indices local to it, and repeats the edge row it
+	/// shares with the band above.  The chunk is reused between calls.
+	///</summary>
+    void CreateGrid(float width, float depth, uint32 m, uint32 n, uint32 rowsPerChunk,
+        const std::function<void(uint32 firstRow, const MeshData& chunk)>& onChunk);
+
 	///<summary>
 	/// Creates a quad aligned with the screen.  This is useful for postprocessing and screen effects.
 	///</summary>
@@ -113,7 +183,9 @@ public:
 private:
 	void Subdivide(MeshData& meshData);
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-    void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-    void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+	const MeshData& GeosphereLevel(uint32 numSubdivisions);
+
+	// The icosahedron, and each level of subdivision of it computed so far.
+	std::vector<MeshData> mGeosphereLevels;
 };
 
@@ -0,0 +1,154 @@
+//***************************************************************************************
+// IndexPacking.cpp
+//***************************************************************************************
+
+#include "IndexPacking.h"
+#include <algorithm>
+
+namespace
+{
+	// A run of a submesh's indices and the range of vertices it uses.
+	struct Window
+	{
+		std::uint32_t Start = 0;
+		std::uint32_t Count = 0;
+		std::uint32_t Lo = 0;
+		std::uint32_t Hi = 0;
+	};
+
+	// Cuts the triangle list into runs of whole triangles whose indices each
+	// span at most MaxIndex16, starting a run whenever the next triangle would
+	// widen the current one too far.  Fails if one triangle alone spans more.
+	bool SplitTriangles(const std::uint32_t* indices, std::uint32_t indexCount, std::vector<Window>& windows)
+	{
+		Window w;
+		if(indexCount == 0)
+		{
+			windows.push_back(w);
+			return true;
+		}
+
+		// A list that isn't whole triangles can't be cut, so it must fit as one run.
+		const std::uint32_t step = indexCount % 3 == 0 ? 3 : indexCount;
+
+		w.Lo = UINT32_MAX;
+		for(std::uint32_t i = 0; i < indexCount; i += step)
+		{
+			auto range = std::minmax_element(indices + i, indices + i + step);
+			if(*range.second - *range.first > MaxIndex16)
+				return false;
+
+			std::uint32_t lo = std::min(w.Lo, *range.first);
+			std::uint32_t hi = std::max(w.Hi, *range.second);
+			if(hi - lo > MaxIndex16)
+			{
+				windows.push_back(w);
+
+				w.Start = i;
+				w.Count = 0;
+				lo = *range.first;
+				hi = *range.second;
+			}
+
+			w.Count += step;
+			w.Lo = lo;
+			w.Hi = hi;
+		}
+
+		windows.push_back(w);
+		return true;
+	}
+}
+
+bool FitsIndices16(const std::uint32_t* indices, std::size_t indexCount)
+{
+	return std::all_of(indices, indices + indexCount, [](std::uint32_t i) { return i <= MaxIndex16; });
+}
+
+IndexPackingReport PackIndices(const std::uint32_t* indices,
+	const std::vector<IndexRange>& submeshes, PackedIndices& packed)
+{
+	IndexPackingReport report;
+	packed = PackedIndices();
+
+	std::vector<std::vector<Window>> windows(submeshes.size());
+	std::size_t indexCount = 0;
+	for(std::size_t s = 0; s < submeshes.size(); ++s)
+	{
+		const IndexRange& submesh = submeshes[s];
+		indexCount += submesh.IndexCount;
+
+		if(!SplitTriangles(indices + submesh.StartIndex, submesh.IndexCount, windows[s]))
+		{
+			++report.UnsplittableSubmeshes;
+			continue;
+		}
+
+		// Vertices in first-use order need about one run per 65536 vertices
+		// spanned; many more means they are scattered, and so many draws
+		// would cost more than the bytes saved.
+		std::uint32_t lo = UINT32_MAX;
+		std::uint32_t hi = 0;
+		for(const Window& w : windows[s])
+		{
+			lo = std::min(lo, w.Lo);
+			hi = std::max(hi, w.Hi);
+		}
+
+		std::size_t fewestRuns = (hi - lo)/(MaxIndex16 + 1) + 1;
+		if(windows[s].size() > 2*fewestRuns)
+			++report.UnsplittableSubmeshes;
+		else if(windows[s].size() > 1)
+			++report.SplitSubmeshes;
+	}
+
+	const bool use16 = report.UnsplittableSubmeshes == 0;
+	if(!use16)
+		report.SplitSubmeshes = 0;
+
+	packed.IndexSize = use16 ? 2 : 4;
+	if(use16)
+		packed.Indices16.reserve(indexCount);
+	else
+		packed.Indices32.reserve(indexCount);
+
+	for(std::size_t s = 0; s < submeshes.size(); ++s)
+	{
+		const IndexRange& submesh = submeshes[s];
+		const std::uint32_t* first = indices + submesh.StartIndex;
+
+		packed.FirstPart.push_back((std::uint32_t)packed.Parts.size());
+
+		if(!use16)
+		{
+			IndexRange part = submesh;
+			part.StartIndex = (std::uint32_t)packed.Indices32.size();
+			packed.Parts.push_back(part);
+			packed.Indices32.insert(packed.Indices32.end(), first, first + submesh.IndexCount);
+			continue;
+		}
+
+		for(const Window& w : windows[s])
+		{
+			// Only runs 16 bits can't hold as they are move their base vertex,
+			// so small meshes keep their indices.
+			std::uint32_t rebase = w.Hi > MaxIndex16 ? w.Lo : 0;
+
+			IndexRange part;
+			part.StartIndex = (std::uint32_t)packed.Indices16.size();
+			part.IndexCount = w.Count;
+			part.BaseVertex = submesh.BaseVertex + (std::int32_t)rebase;
+			packed.Parts.push_back(part);
+
+			for(std::uint32_t i = w.Start; i < w.Start + w.Count; ++i)
+				packed.Indices16.push_back((std::uint16_t)(first[i] - rebase));
+		}
+	}
+
+	packed.FirstPart.push_back((std::uint32_t)packed.Parts.size());
+
+	report.BytesBefore = indexCount*sizeof(std::uint32_t);
+	report.BytesAfter = packed.ByteSize();
+
+	return report;
+}
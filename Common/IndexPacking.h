@@ -0,0 +1,81 @@
+//***************************************************************************************
+// IndexPacking.h
+//
+// Puts a mesh's indices in the narrowest format that holds them without loss.
+// 16-bit indices halve the index buffer but only reach 65536 vertices past a
+// draw's base vertex, so a submesh spanning more is split into several draws
+// of whole triangles, each rebased onto the window of vertices it uses.  The
+// windows are small when the vertices are in first-use order, as
+// OptimizeVertexFetch leaves them.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Largest index a 16-bit index buffer holds.
+const std::uint32_t MaxIndex16 = 0xFFFF;
+
+// One draw: IndexCount indices from StartIndex, offset by BaseVertex, as in
+// DrawIndexedInstanced.
+struct IndexRange
+{
+	std::uint32_t StartIndex = 0;
+	std::uint32_t IndexCount = 0;
+	std::int32_t BaseVertex = 0;
+};
+
+struct PackedIndices
+{
+	// 2 or 4; only the matching list is filled.
+	std::uint32_t IndexSize = 4;
+	std::vector<std::uint16_t> Indices16;
+	std::vector<std::uint32_t> Indices32;
+
+	// The draws, in submesh order: submesh i is drawn by Parts[FirstPart[i]]
+	// up to Parts[FirstPart[i + 1]].  FirstPart has one entry per submesh plus
+	// one.
+	std::vector<IndexRange> Parts;
+	std::vector<std::uint32_t> FirstPart;
+
+	const void* Data()const
+	{
+		return IndexSize == 2 ? (const void*)Indices16.data() : (const void*)Indices32.data();
+	}
+
+	std::size_t ByteSize()const
+	{
+		return IndexSize == 2 ? Indices16.size()*sizeof(std::uint16_t) : Indices32.size()*sizeof(std::uint32_t);
+	}
+};
+
+struct IndexPackingReport
+{
+	std::size_t BytesBefore = 0;          // as 32-bit indices
+	std::size_t BytesAfter = 0;
+
+	std::uint32_t SplitSubmeshes = 0;     // submeshes drawn in more than one part
+	std::uint32_t UnsplittableSubmeshes = 0; // submeshes that kept the buffer at 32 bits
+};
+
+// True if every index fits in 16 bits as it is.
+bool FitsIndices16(const std::uint32_t* indices, std::size_t indexCount);
+
+// Packs the submeshes, each a range of the triangle list indices, into one
+// index buffer laid out in submesh order.  The buffer is 16-bit unless a
+// submesh has a triangle spanning more than 65536 vertices, or would need over
+// twice as many draws as its vertex span requires (vertices scattered across
+// the buffer); then it is 32-bit, with one draw per submesh, rather than lose
+// indices.
+IndexPackingReport PackIndices(const std::uint32_t* indices,
+	const std::vector<IndexRange>& submeshes, PackedIndices& packed);
+
+// Packs the whole list as one submesh.
+inline IndexPackingReport PackIndices(const std::vector<std::uint32_t>& indices, PackedIndices& packed)
+{
+	IndexRange all;
+	all.IndexCount = (std::uint32_t)indices.size();
+	return PackIndices(indices.data(), { all }, packed);
+}
@@ -0,0 +1,282 @@
+//***************************************************************************************
+// MeshCache.cpp
+//***************************************************************************************
+
+#include "MeshCache.h"
+#include "IndexPacking.h"
+#include <Windows.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	// The generator's name followed by the bytes of its arguments.
+	void AppendKey(std::string&)
+	{
+	}
+
+	template<class Arg, class... Args>
+	void AppendKey(std::string& key, const Arg& arg, const Args&... args)
+	{
+		key.append(reinterpret_cast<const char*>(&arg), sizeof(arg));
+		AppendKey(key, args...);
+	}
+
+	template<class... Args>
+	std::string MakeKey(const char* generator, const Args&... args)
+	{
+		std::string key(generator);
+		key.push_back('\0');
+		AppendKey(key, args...);
+		return key;
+	}
+
+	// 64-bit FNV-1a.
+	std::uint64_t HashKey(const std::string& key)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for(char c : key)
+		{
+			hash ^= (std::uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	std::uint32_t PaddedKeyBytes(std::size_t keyBytes)
+	{
+		return (std::uint32_t)((keyBytes + 3) & ~(std::size_t)3);
+	}
+
+	bool WriteAll(HANDLE file, const void* data, std::size_t bytes)
+	{
+		DWORD written = 0;
+		return WriteFile(file, data, (DWORD)bytes, &written, nullptr) && written == bytes;
+	}
+
+	// A read-only view of a whole file, released when it goes out of scope.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::wstring& filename)
+		{
+			mFile = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+				OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if(mFile == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER fileSize = {};
+			if(!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+				return;
+
+			mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if(mMapping == nullptr)
+				return;
+
+			mView = static_cast<const std::uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+			if(mView != nullptr)
+				mSize = (std::uint64_t)fileSize.QuadPart;
+		}
+
+		MappedFile(const MappedFile& rhs) = delete;
+		MappedFile& operator=(const MappedFile& rhs) = delete;
+
+		~MappedFile()
+		{
+			if(mView != nullptr)
+				UnmapViewOfFile(mView);
+			if(mMapping != nullptr)
+				CloseHandle(mMapping);
+			if(mFile != INVALID_HANDLE_VALUE)
+				CloseHandle(mFile);
+		}
+
+		// Null if the file could not be opened or is empty.
+		const std::uint8_t* Data()const { return mView; }
+		std::uint64_t Size()const { return mSize; }
+
+	private:
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		const std::uint8_t* mView = nullptr;
+		std::uint64_t mSize = 0;
+	};
+}
+
+std::vector<MeshCache::uint16> MeshCache::Mesh::GetIndices16()const
+{
+	if(!FitsIndices16(Indices32.data(), Indices32.size()))
+		throw std::out_of_range("GetIndices16: index does not fit in 16 bits; use PackIndices.");
+
+	std::vector<uint16> indices16(Indices32.size());
+	for(std::size_t i = 0; i < Indices32.size(); ++i)
+		indices16[i] = static_cast<uint16>(Indices32[i]);
+	return indices16;
+}
+
+MeshCache::MeshCache()
+	: MeshCache(ExecutableDirectory() + L"\\MeshCache")
+{
+}
+
+MeshCache::MeshCache(const std::wstring& directory)
+	: mDirectory(directory)
+{
+	// Fails harmlessly if it already exists; if it cannot be made, every
+	// lookup misses and nothing is stored.
+	CreateDirectoryW(mDirectory.c_str(), nullptr);
+}
+
+std::wstring MeshCache::ExecutableDirectory()
+{
+	// Long paths need a bigger buffer than MAX_PATH; keep growing it until
+	// the name is not truncated.
+	std::vector<wchar_t> path(MAX_PATH);
+	for(;;)
+	{
+		const DWORD length = GetModuleFileNameW(nullptr, path.data(), (DWORD)path.size());
+		if(length == 0)
+			return L".";
+		if(length < path.size())
+			break;
+		path.resize(2*path.size());
+	}
+
+	std::wstring directory(path.data());
+	const std::size_t slash = directory.find_last_of(L"\\/");
+	return slash == std::wstring::npos ? L"." : directory.substr(0, slash);
+}
+
+void MeshCache::Clear()
+{
+	WIN32_FIND_DATAW found;
+	HANDLE find = FindFirstFileW((mDirectory + L"\\*.mesh").c_str(), &found);
+	if(find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		DeleteFileW((mDirectory + L"\\" + found.cFileName).c_str());
+	}
+	while(FindNextFileW(find, &found));
+
+	FindClose(find);
+}
+
+MeshCache::Mesh MeshCache::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
+{
+	return GetOrCreate(MakeKey("Box", width, height, depth, numSubdivisions), [&]()
+	{
+		return mGenerator.CreateBox(width, height, depth, numSubdivisions);
+	});
+}
+
+MeshCache::Mesh MeshCache::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	return GetOrCreate(MakeKey("Sphere", radius, sliceCount, stackCount), [&]()
+	{
+		return mGenerator.CreateSphere(radius, sliceCount, stackCount);
+	});
+}
+
+MeshCache::Mesh MeshCache::CreateGeosphere(float radius, uint32 numSubdivisions)
+{
+	return GetOrCreate(MakeKey("Geosphere", radius, numSubdivisions), [&]()
+	{
+		return mGenerator.CreateGeosphere(radius, numSubdivisions);
+	});
+}
+
+MeshCache::Mesh MeshCache::CreateCylinder(float bottomRadius, float topRadius, float height,
+	uint32 sliceCount, uint32 stackCount, bool hasTop, bool hasBottom)
+{
+	return GetOrCreate(MakeKey("Cylinder", bottomRadius, topRadius, height, sliceCount, stackCount, hasTop, hasBottom), [&]()
+	{
+		return mGenerator.CreateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, hasTop, hasBottom);
+	});
+}
+
+MeshCache::Mesh MeshCache::CreateGrid(float width, float depth, uint32 m, uint32 n)
+{
+	return GetOrCreate(MakeKey("Grid", width, depth, m, n), [&]()
+	{
+		return mGenerator.CreateGrid(width, depth, m, n);
+	});
+}
+
+std::wstring MeshCache::EntryPath(const std::string& key)const
+{
+	wchar_t name[32];
+	swprintf_s(name, L"%016llx.mesh", (unsigned long long)HashKey(key));
+	return mDirectory + L"\\" + name;
+}
+
+bool MeshCache::Load(const std::string& key, Mesh& mesh)const
+{
+	auto mapped = std::make_shared<MappedFile>(EntryPath(key));
+	const MappedFile& file = *mapped;
+	if(file.Data() == nullptr || file.Size() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if(header.Magic != MeshCacheHeader::MagicValue ||
+	   header.Version != MeshCacheHeader::CurrentVersion ||
+	   header.VertexBytes != sizeof(GeometryGenerator::Vertex) ||
+	   header.KeyBytes != key.size())
+	{
+		return false;
+	}
+
+	const std::uint64_t keyOffset = sizeof(MeshCacheHeader);
+	const std::uint64_t vertexOffset = keyOffset + PaddedKeyBytes(key.size());
+	const std::uint64_t indexOffset = vertexOffset + (std::uint64_t)header.VertexCount*sizeof(GeometryGenerator::Vertex);
+	const std::uint64_t fileBytes = indexOffset + (std::uint64_t)header.IndexCount*sizeof(uint32);
+	if(file.Size() != fileBytes)
+		return false;
+
+	// A different key with the same hash is a miss, not a wrong mesh.
+	if(std::memcmp(file.Data() + keyOffset, key.data(), key.size()) != 0)
+		return false;
+
+	// Viewed in place; the pages are only read in as the caller touches them.
+	// The key is padded to 4 bytes, which is all the alignment the vertices
+	// and indices need.
+	const auto* vertices = reinterpret_cast<const GeometryGenerator::Vertex*>(file.Data() + vertexOffset);
+	const auto* indices = reinterpret_cast<const uint32*>(file.Data() + indexOffset);
+	mesh.Vertices = MeshSpan<GeometryGenerator::Vertex>(vertices, header.VertexCount);
+	mesh.Indices32 = MeshSpan<uint32>(indices, header.IndexCount);
+	mesh.mStorage = std::move(mapped);
+	return true;
+}
+
+void MeshCache::Store(const std::string& key, const MeshData& mesh)const
+{
+	MeshCacheHeader header;
+	header.KeyBytes = (std::uint32_t)key.size();
+	header.VertexCount = (std::uint32_t)mesh.Vertices.size();
+	header.IndexCount = (std::uint32_t)mesh.Indices32.size();
+
+	// Written under a temporary name and renamed into place, so a reader
+	// never maps a half-written entry.
+	const std::wstring path = EntryPath(key);
+	const std::wstring tempPath = path + L".tmp";
+
+	HANDLE file = CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return;
+
+	std::string paddedKey = key;
+	paddedKey.resize(PaddedKeyBytes(key.size()), '\0');
+
+	const bool written =
+		WriteAll(file, &header, sizeof(header)) &&
+		WriteAll(file, paddedKey.data(), paddedKey.size()) &&
+		WriteAll(file, mesh.Vertices.data(), mesh.Vertices.size()*sizeof(GeometryGenerator::Vertex)) &&
+		WriteAll(file, mesh.Indices32.data(), mesh.Indices32.size()*sizeof(uint32));
+	CloseHandle(file);
+
+	if(!written || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		DeleteFileW(tempPath.c_str());
+}
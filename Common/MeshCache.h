@@ -0,0 +1,136 @@
+//***************************************************************************************
+// MeshCache.h
+//
+// An on-disk cache of GeometryGenerator meshes.  Each mesh is stored in its own
+// file, named by a hash of the generator and its arguments, so a shape built on
+// one run is mapped back from disk on the next instead of being generated again.
+// A cached mesh is read in place from the mapped file: nothing is copied until
+// the caller copies it into its own vertex and index buffers.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "GeometryGenerator.h"
+
+// A cache file is this header, the key padded to 4 bytes, the vertices and then
+// the 32-bit indices.
+struct MeshCacheHeader
+{
+    static const std::uint32_t MagicValue = 0x4853454d; // "MESH"
+
+    // Bump whenever a generator's output changes, so old entries are rebuilt.
+    static const std::uint32_t CurrentVersion = 1;
+
+    std::uint32_t Magic = MagicValue;
+    std::uint32_t Version = CurrentVersion;
+    std::uint32_t VertexBytes = sizeof(GeometryGenerator::Vertex);
+    std::uint32_t KeyBytes = 0;
+    std::uint32_t VertexCount = 0;
+    std::uint32_t IndexCount = 0;
+    std::uint32_t Reserved[2] = {};
+};
+
+static_assert(sizeof(MeshCacheHeader) == 32, "MeshCacheHeader is a file format.");
+
+// Read-only view of an array owned by a MeshCache::Mesh, with the parts of
+// the std::vector interface the demos use.
+template<class T>
+class MeshSpan
+{
+public:
+	MeshSpan() = default;
+	MeshSpan(const T* data, std::size_t size) : mData(data), mSize(size) {}
+
+	const T* data()const { return mData; }
+	std::size_t size()const { return mSize; }
+	bool empty()const { return mSize == 0; }
+	const T& operator[](std::size_t i)const { return mData[i]; }
+	const T* begin()const { return mData; }
+	const T* end()const { return mData + mSize; }
+
+private:
+	const T* mData = nullptr;
+	std::size_t mSize = 0;
+};
+
+class MeshCache
+{
+public:
+    using MeshData = GeometryGenerator::MeshData;
+    using uint16 = GeometryGenerator::uint16;
+    using uint32 = GeometryGenerator::uint32;
+
+	// A mesh handed out by the cache.  An entry that was found is viewed in
+	// place in its mapped file, which stays mapped while any copy of the Mesh
+	// lives; a mesh just generated is held by the Mesh instead.
+	class Mesh
+	{
+	public:
+		MeshSpan<GeometryGenerator::Vertex> Vertices;
+		MeshSpan<uint32> Indices32;
+
+		// Same as MeshData::GetIndices16.
+		std::vector<uint16> GetIndices16()const;
+
+	private:
+		friend class MeshCache;
+		std::shared_ptr<const void> mStorage;
+	};
+
+	// Entries live in the MeshCache directory next to the executable, so the
+	// demos find them whatever directory they are started from.
+	MeshCache();
+
+	// Entries live in directory, which is created if it does not exist.
+	explicit MeshCache(const std::wstring& directory);
+	MeshCache(const MeshCache& rhs) = delete;
+	MeshCache& operator=(const MeshCache& rhs) = delete;
+
+	// Directory holding the running executable, without a trailing separator.
+	static std::wstring ExecutableDirectory();
+
+	// Deletes every entry no Mesh still views, so the next lookups generate
+	// their meshes again.
+	void Clear();
+
+	// The GeometryGenerator shapes, read from the cache when an earlier call
+	// with the same arguments stored them.
+    Mesh CreateBox(float width, float height, float depth, uint32 numSubdivisions);
+    Mesh CreateSphere(float radius, uint32 sliceCount, uint32 stackCount);
+    Mesh CreateGeosphere(float radius, uint32 numSubdivisions);
+    Mesh CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, bool hasTop = true, bool hasBottom = true);
+    Mesh CreateGrid(float width, float depth, uint32 m, uint32 n);
+
+	// Returns the mesh stored under key, or builds it with generate() and
+	// stores it.  The cache only saves work: an entry that cannot be read is
+	// rebuilt, and one that cannot be written is not kept.
+	template<class Generate>
+	Mesh GetOrCreate(const std::string& key, Generate generate)
+	{
+		Mesh mesh;
+		if(!Load(key, mesh))
+		{
+			auto generated = std::make_shared<MeshData>(generate());
+			Store(key, *generated);
+
+			mesh.Vertices = MeshSpan<GeometryGenerator::Vertex>(generated->Vertices.data(), generated->Vertices.size());
+			mesh.Indices32 = MeshSpan<uint32>(generated->Indices32.data(), generated->Indices32.size());
+			mesh.mStorage = std::move(generated);
+		}
+		return mesh;
+	}
+
+private:
+	std::wstring EntryPath(const std::string& key)const;
+	bool Load(const std::string& key, Mesh& mesh)const;
+	void Store(const std::string& key, const MeshData& mesh)const;
+
+private:
+	std::wstring mDirectory;
+	GeometryGenerator mGenerator;
+};
@@ -0,0 +1,342 @@
+//***************************************************************************************
+// MeshOptimizer.cpp
+//***************************************************************************************
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Forsyth's scoring: an LRU cache of 32 vertices, a flat score for the
+	// last triangle's vertices so the next triangle does not just reuse its
+	// edge, and a boost for vertices with few triangles left, so they are
+	// finished off rather than left stranded.
+	const int ScoreCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	float VertexScore(int cachePosition, std::uint32_t trianglesLeft)
+	{
+		if(trianglesLeft == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if(cachePosition >= 0)
+		{
+			if(cachePosition < 3)
+				score = LastTriangleScore;
+			else
+				score = powf(1.0f - (cachePosition - 3)*(1.0f/(ScoreCacheSize - 3)), CacheDecayPower);
+		}
+
+		return score + ValenceBoostScale*powf((float)trianglesLeft, -ValenceBoostPower);
+	}
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount,
+	std::uint32_t vertexCount, std::uint32_t cacheSize)
+{
+	// A vertex is in the cache if fewer than cacheSize misses came after it.
+	std::vector<std::uint64_t> addedAt(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	std::uint64_t misses = 0;
+	std::uint32_t usedCount = 0;
+
+	for(std::size_t i = 0; i < indexCount; ++i)
+	{
+		const std::uint32_t v = indices[i];
+		if(addedAt[v] == 0 || misses - addedAt[v] >= cacheSize)
+		{
+			++misses;
+			addedAt[v] = misses;
+		}
+		if(!used[v])
+		{
+			used[v] = true;
+			++usedCount;
+		}
+	}
+
+	VertexCacheStats stats;
+	if(indexCount >= 3)
+		stats.ACMR = (float)misses / (float)(indexCount/3);
+	if(usedCount > 0)
+		stats.ATVR = (float)misses / (float)usedCount;
+	return stats;
+}
+
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount)
+{
+	const std::size_t triangleCount = indexCount/3;
+	if(triangleCount == 0)
+		return;
+
+	// The triangles of each vertex that have not been emitted yet are
+	// triangles[first[v], first[v] + trianglesLeft[v]).
+	std::vector<std::uint32_t> trianglesLeft(vertexCount, 0);
+	for(std::size_t i = 0; i < indexCount; ++i)
+		++trianglesLeft[indices[i]];
+
+	std::vector<std::uint32_t> first(vertexCount, 0);
+	for(std::uint32_t v = 1; v < vertexCount; ++v)
+		first[v] = first[v - 1] + trianglesLeft[v - 1];
+
+	std::vector<std::uint32_t> triangles(indexCount);
+	{
+		std::vector<std::uint32_t> filled(vertexCount, 0);
+		for(std::size_t i = 0; i < indexCount; ++i)
+		{
+			const std::uint32_t v = indices[i];
+			triangles[first[v] + filled[v]++] = (std::uint32_t)(i/3);
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, trianglesLeft[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for(std::size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[3*t]] + vertexScore[indices[3*t + 1]] + vertexScore[indices[3*t + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> output(indexCount);
+
+	// The emitted triangle's vertices go to the front and push the rest back;
+	// the 3 extra slots hold vertices on their way out.
+	std::uint32_t cache[ScoreCacheSize + 3];
+	std::uint32_t newCache[ScoreCacheSize + 3];
+	int cacheCount = 0;
+
+	std::size_t best = 0;
+	std::size_t nextUnemitted = 0;
+	for(std::size_t out = 0; out < triangleCount; ++out)
+	{
+		// Nothing in the cache has triangles left: take the next triangle in
+		// input order instead of searching them all.
+		if(best == triangleCount)
+		{
+			while(emitted[nextUnemitted])
+				++nextUnemitted;
+			best = nextUnemitted;
+		}
+
+		emitted[best] = true;
+		const std::uint32_t* tri = &indices[3*best];
+		output[3*out + 0] = tri[0];
+		output[3*out + 1] = tri[1];
+		output[3*out + 2] = tri[2];
+
+		int newCount = 0;
+		for(int k = 0; k < 3; ++k)
+		{
+			const std::uint32_t v = tri[k];
+			newCache[newCount++] = v;
+
+			// Take the triangle off the vertex's list.
+			std::uint32_t* list = &triangles[first[v]];
+			const std::uint32_t count = trianglesLeft[v];
+			for(std::uint32_t j = 0; j < count; ++j)
+			{
+				if(list[j] == best)
+				{
+					list[j] = list[count - 1];
+					break;
+				}
+			}
+			--trianglesLeft[v];
+		}
+
+		for(int i = 0; i < cacheCount; ++i)
+		{
+			const std::uint32_t v = cache[i];
+			if(v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore every vertex that was or is in the cache, and find the best
+		// triangle among theirs.
+		for(int i = 0; i < newCount; ++i)
+		{
+			const std::uint32_t v = newCache[i];
+			cachePosition[v] = i < ScoreCacheSize ? i : -1;
+		}
+
+		float bestScore = -1.0f;
+		best = triangleCount;
+		for(int i = 0; i < newCount; ++i)
+		{
+			const std::uint32_t v = newCache[i];
+			const float score = VertexScore(cachePosition[v], trianglesLeft[v]);
+			const float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const std::uint32_t* list = &triangles[first[v]];
+			for(std::uint32_t j = 0; j < trianglesLeft[v]; ++j)
+			{
+				const std::uint32_t t = list[j];
+				triangleScore[t] += delta;
+				if(triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, ScoreCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount)
+{
+	const std::size_t triangleCount = indexCount/3;
+	if(triangleCount == 0)
+		return;
+
+	auto position = [&](std::uint32_t v)
+	{
+		assert(v < vertexCount);
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(
+			reinterpret_cast<const std::uint8_t*>(positions) + v*positionStride));
+	};
+
+	// A run starts wherever a triangle's three vertices all miss a 16 vertex
+	// FIFO cache; moving runs then costs no more transforms than it did.
+	const std::uint32_t cacheSize = 16;
+	std::vector<std::uint64_t> addedAt(vertexCount, 0);
+	std::uint64_t misses = 0;
+	std::vector<std::size_t> runStart;
+	for(std::size_t t = 0; t < triangleCount; ++t)
+	{
+		int triangleMisses = 0;
+		for(int k = 0; k < 3; ++k)
+		{
+			const std::uint32_t v = indices[3*t + k];
+			if(addedAt[v] == 0 || misses - addedAt[v] >= cacheSize)
+			{
+				++misses;
+				addedAt[v] = misses;
+				++triangleMisses;
+			}
+		}
+		if(t == 0 || triangleMisses == 3)
+			runStart.push_back(t);
+	}
+	runStart.push_back(triangleCount);
+
+	const std::size_t runCount = runStart.size() - 1;
+	if(runCount < 2)
+		return;
+
+	// Area weighted centroid and normal of each run, and of the whole mesh.
+	std::vector<XMFLOAT3> runCentroid(runCount);
+	std::vector<XMFLOAT3> runNormal(runCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	for(std::size_t r = 0; r < runCount; ++r)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for(std::size_t t = runStart[r]; t < runStart[r + 1]; ++t)
+		{
+			XMVECTOR p0 = position(indices[3*t + 0]);
+			XMVECTOR p1 = position(indices[3*t + 1]);
+			XMVECTOR p2 = position(indices[3*t + 2]);
+
+			// Clockwise front faces, as in GeometryGenerator.
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			float a = XMVectorGetX(XMVector3Length(n));
+
+			centroid += (a/3.0f)*(p0 + p1 + p2);
+			normal += n;
+			area += a;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		if(area > 0.0f)
+			centroid = centroid/area;
+		XMStoreFloat3(&runCentroid[r], centroid);
+		XMStoreFloat3(&runNormal[r], XMVector3Normalize(normal));
+	}
+	if(meshArea > 0.0f)
+		meshCentroid = meshCentroid/meshArea;
+
+	// Runs facing away from the middle of the mesh are likely in front of the
+	// ones facing in, so they go first.
+	std::vector<float> sortKey(runCount);
+	std::vector<std::size_t> order(runCount);
+	for(std::size_t r = 0; r < runCount; ++r)
+	{
+		XMVECTOR outward = XMLoadFloat3(&runCentroid[r]) - meshCentroid;
+		sortKey[r] = XMVectorGetX(XMVector3Dot(outward, XMLoadFloat3(&runNormal[r])));
+		order[r] = r;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+	{
+		return sortKey[a] > sortKey[b];
+	});
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indexCount);
+	for(std::size_t r : order)
+		output.insert(output.end(), indices + 3*runStart[r], indices + 3*runStart[r + 1]);
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeVertexFetch(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& remap)
+{
+	const std::uint32_t unused = ~0u;
+	remap.assign(vertexCount, unused);
+
+	std::uint32_t next = 0;
+	for(std::size_t i = 0; i < indexCount; ++i)
+	{
+		std::uint32_t& v = indices[i];
+		if(remap[v] == unused)
+			remap[v] = next++;
+		v = remap[v];
+	}
+
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if(remap[v] == unused)
+			remap[v] = next++;
+	}
+}
+
+MeshOptimizeReport OptimizeTriangleOrder(std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount)
+{
+	MeshOptimizeReport report;
+	report.Before = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+	// Meshes exported from modelling tools often arrive already optimized
+	// (skull.txt does); keep their order if the reorder does not beat it.
+	std::vector<std::uint32_t> original(indices, indices + indexCount);
+	OptimizeVertexCache(indices, indexCount, vertexCount);
+	OptimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount);
+
+	report.After = AnalyzeVertexCache(indices, indexCount, vertexCount);
+	if(report.After.ACMR > report.Before.ACMR)
+	{
+		std::copy(original.begin(), original.end(), indices);
+		report.After = report.Before;
+	}
+	return report;
+}
@@ -0,0 +1,91 @@
+//***************************************************************************************
+// MeshOptimizer.h
+//
+// Reorders a mesh's triangles and vertices for the GPU: triangles for reuse in the
+// post-transform vertex cache and for less overdraw, then vertices in the order
+// the triangles fetch them.  The mesh looks the same; only the order changes.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "GeometryGenerator.h"
+
+// Vertex shader invocations of a draw through a FIFO post-transform cache.
+struct VertexCacheStats
+{
+	// Transformed vertices per triangle; 3 with no reuse, about 0.5 at best.
+	float ACMR = 0.0f;
+
+	// Transformed vertices per vertex referenced; 1 is ideal.
+	float ATVR = 0.0f;
+};
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+// Simulates a FIFO cache of cacheSize vertices over the triangle list.
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount,
+	std::uint32_t vertexCount, std::uint32_t cacheSize = 16);
+
+// Reorders the triangles in place for vertex cache reuse (Forsyth's linear-speed
+// algorithm).  The result is good for any cache size, not tuned to one.
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount);
+
+// Reorders runs of a cache-optimized triangle list so outward facing runs on the
+// outside of the mesh draw first, which lets depth testing reject more of the
+// rest.  Runs are split only where the cache already starts over, so the cache
+// reuse is kept.  positions has vertexCount entries, positionStride bytes apart.
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount);
+
+// Renumbers the vertices in the order the triangles first use them and rewrites
+// the indices.  remap[old] is the new position of each vertex; vertices no
+// triangle uses keep their order after the rest.
+void OptimizeVertexFetch(std::uint32_t* indices, std::size_t indexCount, std::uint32_t vertexCount,
+	std::vector<std::uint32_t>& remap);
+
+// Moves each vertex to the position OptimizeVertexFetch gave it.
+template<class Vertex>
+void RemapVertices(std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& remap)
+{
+	std::vector<Vertex> remapped(vertices.size());
+	for(std::size_t i = 0; i < vertices.size(); ++i)
+		remapped[remap[i]] = vertices[i];
+	vertices.swap(remapped);
+}
+
+// OptimizeVertexCache then OptimizeOverdraw, kept only if they lower the ACMR
+// of a 16 vertex cache.  Returns the cache behaviour before and after.
+MeshOptimizeReport OptimizeTriangleOrder(std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount);
+
+// All three passes over a mesh of any vertex type; position is the vertex's
+// position member.
+template<class Vertex>
+MeshOptimizeReport OptimizeMesh(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices,
+	DirectX::XMFLOAT3 Vertex::*position)
+{
+	if(vertices.empty() || indices.empty())
+		return MeshOptimizeReport();
+
+	const std::uint32_t vertexCount = (std::uint32_t)vertices.size();
+	MeshOptimizeReport report = OptimizeTriangleOrder(indices.data(), indices.size(),
+		&(vertices[0].*position), sizeof(Vertex), vertexCount);
+
+	std::vector<std::uint32_t> remap;
+	OptimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+	RemapVertices(vertices, remap);
+	return report;
+}
+
+inline MeshOptimizeReport OptimizeMesh(GeometryGenerator::MeshData& mesh)
+{
+	return OptimizeMesh(mesh.Vertices, mesh.Indices32, &GeometryGenerator::Vertex::Position);
+}
@@ -0,0 +1,593 @@
+//***************************************************************************************
+// MeshSimplifier.cpp
+//***************************************************************************************
+
+#include "MeshSimplifier.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// Collapses that turn a triangle's normal further than this are refused.
+	const float MinNormalCosine = 0.5f;
+
+	float Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorGetX(XMVector3Dot(a, b));
+	}
+
+	// Distance from the end of offset to the line through the origin along
+	// direction.  Subtracting the projection instead loses the answer to
+	// cancellation when the point is close to the line.
+	float LineDistance(FXMVECTOR offset, FXMVECTOR direction)
+	{
+		const float length = XMVectorGetX(XMVector3Length(direction));
+		return XMVectorGetX(XMVector3Length(XMVector3Cross(direction, offset)))/length;
+	}
+
+	// Distance from p to the triangle abc, from the region of the triangle
+	// the closest point lies in (Ericson, Real-Time Collision Detection 5.1.5).
+	float PointTriangleDistance(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		const XMVECTOR ab = b - a, ac = c - a, ap = p - a;
+		const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if(d1 <= 0.0f && d2 <= 0.0f)
+			return XMVectorGetX(XMVector3Length(ap));
+
+		const XMVECTOR bp = p - b;
+		const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if(d3 >= 0.0f && d4 <= d3)
+			return XMVectorGetX(XMVector3Length(bp));
+
+		const float vc = d1*d4 - d3*d2;
+		if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return LineDistance(ap, ab);
+
+		const XMVECTOR cp = p - c;
+		const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if(d6 >= 0.0f && d5 <= d6)
+			return XMVectorGetX(XMVector3Length(cp));
+
+		const float vb = d5*d2 - d1*d6;
+		if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return LineDistance(ap, ac);
+
+		const float va = d3*d6 - d5*d4;
+		if(va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return LineDistance(bp, c - b);
+
+		// Inside: the distance to the plane, for the same reason.
+		const XMVECTOR n = XMVector3Cross(ab, ac);
+		const float area = XMVectorGetX(XMVector3Length(n));
+		if(va + vb + vc <= 0.0f || area <= 0.0f)
+			return XMVectorGetX(XMVector3Length(ap));
+		return fabsf(Dot(ap, n))/area;
+	}
+
+	// Sum of squared distances to a set of planes, as the symmetric 4x4
+	// matrix p p^T of each plane p = (a, b, c, d).
+	struct Quadric
+	{
+		double A2 = 0, AB = 0, AC = 0, AD = 0;
+		double B2 = 0, BC = 0, BD = 0;
+		double C2 = 0, CD = 0;
+		double D2 = 0;
+
+		void AddPlane(double a, double b, double c, double d)
+		{
+			A2 += a*a; AB += a*b; AC += a*c; AD += a*d;
+			B2 += b*b; BC += b*c; BD += b*d;
+			C2 += c*c; CD += c*d;
+			D2 += d*d;
+		}
+
+		void Add(const Quadric& q)
+		{
+			A2 += q.A2; AB += q.AB; AC += q.AC; AD += q.AD;
+			B2 += q.B2; BC += q.BC; BD += q.BD;
+			C2 += q.C2; CD += q.CD;
+			D2 += q.D2;
+		}
+
+		double Evaluate(const XMFLOAT3& p)const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return A2*x*x + 2*AB*x*y + 2*AC*x*z + 2*AD*x
+			     + B2*y*y + 2*BC*y*z + 2*BD*y
+			     + C2*z*z + 2*CD*z
+			     + D2;
+		}
+	};
+
+	// Moving vertex From onto To costs Cost; stale once either vertex has
+	// changed since the collapse was queued.  Ties, common on flat regions,
+	// go to the shorter edge so collapses spread out instead of piling every
+	// neighbour onto one vertex.
+	struct Collapse
+	{
+		double Cost;
+		float LengthSq;
+		std::uint32_t From;
+		std::uint32_t To;
+		std::uint32_t FromVersion;
+		std::uint32_t ToVersion;
+
+		bool operator>(const Collapse& rhs)const
+		{
+			return Cost > rhs.Cost || (Cost == rhs.Cost && LengthSq > rhs.LengthSq);
+		}
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::uint32_t* indices, std::size_t indexCount,
+			const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount);
+
+		float Run(std::size_t targetIndexCount, float maxError, std::vector<std::uint32_t>& result);
+
+	private:
+		const XMFLOAT3& Position(std::uint32_t v)const
+		{
+			return *reinterpret_cast<const XMFLOAT3*>(mPositions + v*mPositionStride);
+		}
+
+		void LockBordersAndSeams();
+		void QueueEdges(std::uint32_t v);
+		void QueueCollapse(std::uint32_t from, std::uint32_t to);
+		bool CanCollapse(std::uint32_t from, std::uint32_t to);
+		void DoCollapse(std::uint32_t from, std::uint32_t to);
+		void CompactTriangles(std::uint32_t v);
+		void GatherNeighbours(std::uint32_t v, std::vector<std::uint32_t>& neighbours)const;
+		float MeasureDeviation();
+
+	private:
+		const std::uint8_t* mPositions;
+		std::size_t mPositionStride;
+		std::uint32_t mVertexCount;
+
+		std::vector<std::uint32_t> mOriginalIndices;
+		std::vector<std::uint32_t> mTriangles;               // 3 vertices each
+		std::vector<bool> mTriangleAlive;
+		std::size_t mAliveTriangles = 0;
+
+		std::vector<std::vector<std::uint32_t>> mVertexTriangles;
+		std::vector<Quadric> mQuadrics;
+		std::vector<std::uint32_t> mVersion;
+		std::vector<bool> mLocked;
+		std::vector<bool> mRemoved;
+		std::vector<std::uint32_t> mMergedInto;              // where a removed vertex went
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mQueue;
+		std::vector<std::uint32_t> mScratchA;
+		std::vector<std::uint32_t> mScratchB;
+	};
+
+	Simplifier::Simplifier(const std::uint32_t* indices, std::size_t indexCount,
+		const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount)
+		: mPositions(reinterpret_cast<const std::uint8_t*>(positions)),
+		  mPositionStride(positionStride),
+		  mVertexCount(vertexCount),
+		  mOriginalIndices(indices, indices + indexCount - indexCount%3),
+		  mTriangles(mOriginalIndices),
+		  mTriangleAlive(indexCount/3, true),
+		  mAliveTriangles(indexCount/3),
+		  mVertexTriangles(vertexCount),
+		  mQuadrics(vertexCount),
+		  mVersion(vertexCount, 0),
+		  mLocked(vertexCount, false),
+		  mRemoved(vertexCount, false),
+		  mMergedInto(vertexCount)
+	{
+		// Each vertex starts with the planes of its triangles.
+		for(std::uint32_t t = 0; t < (std::uint32_t)mTriangleAlive.size(); ++t)
+		{
+			const std::uint32_t* tri = &mTriangles[3*t];
+			XMVECTOR p0 = XMLoadFloat3(&Position(tri[0]));
+			XMVECTOR p1 = XMLoadFloat3(&Position(tri[1]));
+			XMVECTOR p2 = XMLoadFloat3(&Position(tri[2]));
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+
+			Quadric q;
+			if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+			{
+				n = XMVector3Normalize(n);
+				const float d = -XMVectorGetX(XMVector3Dot(n, p0));
+				q.AddPlane(XMVectorGetX(n), XMVectorGetY(n), XMVectorGetZ(n), d);
+			}
+
+			for(int k = 0; k < 3; ++k)
+			{
+				mQuadrics[tri[k]].Add(q);
+				mVertexTriangles[tri[k]].push_back(t);
+			}
+		}
+
+		LockBordersAndSeams();
+
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+			QueueEdges(v);
+	}
+
+	void Simplifier::LockBordersAndSeams()
+	{
+		// An edge used by one triangle is on an open border.  Counting each
+		// edge under its ordered pair leaves a border edge with an odd count.
+		std::unordered_map<std::uint64_t, std::uint32_t> edgeUses;
+		edgeUses.reserve(mTriangles.size());
+		for(std::size_t i = 0; i < mTriangles.size(); i += 3)
+		{
+			for(int k = 0; k < 3; ++k)
+			{
+				std::uint32_t a = mTriangles[i + k];
+				std::uint32_t b = mTriangles[i + (k + 1)%3];
+				if(a > b)
+					std::swap(a, b);
+				++edgeUses[(std::uint64_t)a << 32 | b];
+			}
+		}
+		for(const auto& edge : edgeUses)
+		{
+			if(edge.second == 1)
+			{
+				mLocked[(std::uint32_t)(edge.first >> 32)] = true;
+				mLocked[(std::uint32_t)edge.first] = true;
+			}
+		}
+
+		// A seam duplicates a position for different normals or texture
+		// coordinates; moving one copy would tear the surface.
+		std::unordered_map<std::uint64_t, std::uint32_t> firstAt;
+		firstAt.reserve(mVertexCount);
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+		{
+			const XMFLOAT3& p = Position(v);
+			std::uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			std::uint64_t key = 14695981039346656037ull;
+			for(std::uint32_t b : bits)
+				key = (key ^ b)*1099511628211ull;
+
+			auto slot = firstAt.emplace(key, v);
+			if(!slot.second)
+			{
+				const XMFLOAT3& q = Position(slot.first->second);
+				if(p.x == q.x && p.y == q.y && p.z == q.z)
+				{
+					mLocked[v] = true;
+					mLocked[slot.first->second] = true;
+				}
+			}
+		}
+	}
+
+	void Simplifier::GatherNeighbours(std::uint32_t v, std::vector<std::uint32_t>& neighbours)const
+	{
+		neighbours.clear();
+		for(std::uint32_t t : mVertexTriangles[v])
+		{
+			if(!mTriangleAlive[t])
+				continue;
+			for(int k = 0; k < 3; ++k)
+			{
+				const std::uint32_t w = mTriangles[3*t + k];
+				if(w != v)
+					neighbours.push_back(w);
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+	}
+
+	void Simplifier::QueueEdges(std::uint32_t v)
+	{
+		GatherNeighbours(v, mScratchA);
+		for(std::uint32_t w : mScratchA)
+		{
+			// Queue both directions of each edge once.
+			if(v < w)
+			{
+				QueueCollapse(v, w);
+				QueueCollapse(w, v);
+			}
+		}
+	}
+
+	void Simplifier::QueueCollapse(std::uint32_t from, std::uint32_t to)
+	{
+		if(mLocked[from])
+			return;
+
+		Quadric q = mQuadrics[from];
+		q.Add(mQuadrics[to]);
+
+		Collapse c;
+		c.Cost = std::max(q.Evaluate(Position(to)), 0.0);
+		c.LengthSq = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&Position(to)) - XMLoadFloat3(&Position(from))));
+		c.From = from;
+		c.To = to;
+		c.FromVersion = mVersion[from];
+		c.ToVersion = mVersion[to];
+		mQueue.push(c);
+	}
+
+	bool Simplifier::CanCollapse(std::uint32_t from, std::uint32_t to)
+	{
+		// Link condition: the vertices adjacent to both ends must be exactly
+		// the third vertices of the triangles on the edge, or the collapse
+		// pinches the surface.
+		GatherNeighbours(from, mScratchA);
+		GatherNeighbours(to, mScratchB);
+		std::size_t shared = 0;
+		for(std::size_t i = 0, j = 0; i < mScratchA.size() && j < mScratchB.size();)
+		{
+			if(mScratchA[i] < mScratchB[j])
+				++i;
+			else if(mScratchB[j] < mScratchA[i])
+				++j;
+			else
+			{
+				++shared;
+				++i;
+				++j;
+			}
+		}
+
+		std::size_t edgeTriangles = 0;
+		const XMVECTOR target = XMLoadFloat3(&Position(to));
+		for(std::uint32_t t : mVertexTriangles[from])
+		{
+			if(!mTriangleAlive[t])
+				continue;
+
+			const std::uint32_t* tri = &mTriangles[3*t];
+			if(tri[0] == to || tri[1] == to || tri[2] == to)
+			{
+				++edgeTriangles;
+				continue;
+			}
+
+			// The triangles that stay must not turn too far or collapse.
+			XMVECTOR p[3];
+			XMVECTOR moved[3];
+			for(int k = 0; k < 3; ++k)
+			{
+				p[k] = XMLoadFloat3(&Position(tri[k]));
+				moved[k] = tri[k] == from ? target : p[k];
+			}
+
+			XMVECTOR before = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+			XMVECTOR after = XMVector3Cross(moved[1] - moved[0], moved[2] - moved[0]);
+			const float lengths = sqrtf(XMVectorGetX(XMVector3LengthSq(before))*XMVectorGetX(XMVector3LengthSq(after)));
+			if(lengths <= 0.0f || XMVectorGetX(XMVector3Dot(before, after)) < MinNormalCosine*lengths)
+				return false;
+		}
+
+		return shared == edgeTriangles;
+	}
+
+	void Simplifier::DoCollapse(std::uint32_t from, std::uint32_t to)
+	{
+		for(std::uint32_t t : mVertexTriangles[from])
+		{
+			if(!mTriangleAlive[t])
+				continue;
+
+			std::uint32_t* tri = &mTriangles[3*t];
+			if(tri[0] == to || tri[1] == to || tri[2] == to)
+			{
+				mTriangleAlive[t] = false;
+				--mAliveTriangles;
+				continue;
+			}
+
+			for(int k = 0; k < 3; ++k)
+			{
+				if(tri[k] == from)
+					tri[k] = to;
+			}
+			mVertexTriangles[to].push_back(t);
+		}
+
+		mQuadrics[to].Add(mQuadrics[from]);
+		mVertexTriangles[from].clear();
+		mRemoved[from] = true;
+		mMergedInto[from] = to;
+		++mVersion[from];
+		++mVersion[to];
+
+		CompactTriangles(to);
+
+		// Only the edges around to change cost, with its quadric; the queued
+		// collapses of other edges are checked again when they come up.
+		GatherNeighbours(to, mScratchB);
+		for(std::uint32_t w : mScratchB)
+		{
+			QueueCollapse(to, w);
+			QueueCollapse(w, to);
+		}
+	}
+
+	void Simplifier::CompactTriangles(std::uint32_t v)
+	{
+		auto& triangles = mVertexTriangles[v];
+		triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+			[this](std::uint32_t t) { return !mTriangleAlive[t]; }), triangles.end());
+	}
+
+	float Simplifier::MeasureDeviation()
+	{
+		// Point each removed vertex straight at the vertex it ended up in, and
+		// drop the dead triangles from the fans that are left.
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+		{
+			if(!mRemoved[v])
+			{
+				CompactTriangles(v);
+				continue;
+			}
+
+			std::uint32_t last = mMergedInto[v];
+			while(mRemoved[last])
+				last = mMergedInto[last];
+			for(std::uint32_t w = v; w != last;)
+			{
+				const std::uint32_t next = mMergedInto[w];
+				mMergedInto[w] = last;
+				w = next;
+			}
+		}
+		auto kept = [this](std::uint32_t v) { return mRemoved[v] ? mMergedInto[v] : v; };
+
+		// A removed vertex was merged into a vertex that is still there, as
+		// were its neighbours, so the triangles around those vertices are the
+		// part of the surface that replaced its own triangles.  They are a
+		// subset of the whole surface, so the distance to them bounds the
+		// distance to the surface.  Each (removed, kept) pair is listed once.
+		std::vector<std::uint64_t> pairs;
+		for(std::size_t i = 0; i < mOriginalIndices.size(); i += 3)
+		{
+			const std::uint32_t* tri = &mOriginalIndices[i];
+			for(int k = 0; k < 3; ++k)
+			{
+				if(!mRemoved[tri[k]])
+					continue;
+				for(int n = 0; n < 3; ++n)
+					pairs.push_back((std::uint64_t)tri[k] << 32 | kept(tri[n]));
+			}
+		}
+		std::sort(pairs.begin(), pairs.end());
+		pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+		std::vector<float> nearest(mVertexCount, FLT_MAX);
+		for(std::uint64_t pair : pairs)
+		{
+			const std::uint32_t v = (std::uint32_t)(pair >> 32);
+			const XMVECTOR p = XMLoadFloat3(&Position(v));
+			for(std::uint32_t t : mVertexTriangles[(std::uint32_t)pair])
+			{
+				const std::uint32_t* around = &mTriangles[3*t];
+				nearest[v] = std::min(nearest[v], PointTriangleDistance(p, XMLoadFloat3(&Position(around[0])),
+					XMLoadFloat3(&Position(around[1])), XMLoadFloat3(&Position(around[2]))));
+			}
+		}
+
+		float deviation = 0.0f;
+		for(std::uint32_t v = 0; v < mVertexCount; ++v)
+		{
+			if(!mRemoved[v])
+				continue;
+
+			// Every triangle around those vertices collapsed away; fall back
+			// to the vertex it was merged into.
+			if(nearest[v] == FLT_MAX)
+				nearest[v] = XMVectorGetX(XMVector3Length(XMLoadFloat3(&Position(v)) - XMLoadFloat3(&Position(kept(v)))));
+			deviation = std::max(deviation, nearest[v]);
+		}
+		return deviation;
+	}
+
+	float Simplifier::Run(std::size_t targetIndexCount, float maxError, std::vector<std::uint32_t>& result)
+	{
+		const double maxCost = (double)maxError*maxError;
+
+		while(3*mAliveTriangles > targetIndexCount && !mQueue.empty())
+		{
+			const Collapse c = mQueue.top();
+			mQueue.pop();
+
+			if(mRemoved[c.From] || mRemoved[c.To] ||
+			   c.FromVersion != mVersion[c.From] || c.ToVersion != mVersion[c.To])
+			{
+				continue;
+			}
+
+			if(c.Cost > maxCost)
+				break;
+
+			if(!CanCollapse(c.From, c.To))
+				continue;
+
+			DoCollapse(c.From, c.To);
+		}
+
+		result.clear();
+		result.reserve(3*mAliveTriangles);
+		for(std::size_t t = 0; t < mTriangleAlive.size(); ++t)
+		{
+			if(mTriangleAlive[t])
+				result.insert(result.end(), &mTriangles[3*t], &mTriangles[3*t] + 3);
+		}
+
+		return MeasureDeviation();
+	}
+}
+
+float SimplifyMesh(const std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::size_t targetIndexCount, float maxError, std::vector<std::uint32_t>& result)
+{
+	Simplifier simplifier(indices, indexCount, positions, positionStride, vertexCount);
+	return simplifier.Run(targetIndexCount, maxError, result);
+}
+
+void BuildLodChain(const std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::vector<float>& ratios, std::vector<std::uint32_t>& lodIndices, std::vector<MeshLod>& lods)
+{
+	// Every level starts from the full mesh, so they build independently.
+	const int levelCount = (int)ratios.size();
+	std::vector<std::vector<std::uint32_t>> levels(levelCount);
+	std::vector<float> errors(levelCount, 0.0f);
+	concurrency::parallel_for(0, levelCount, [&](int i)
+	{
+		if(ratios[i] >= 1.0f)
+		{
+			levels[i].assign(indices, indices + indexCount);
+			return;
+		}
+
+		const std::size_t target = 3*(std::size_t)(ratios[i]*(indexCount/3));
+		errors[i] = SimplifyMesh(indices, indexCount, positions, positionStride, vertexCount,
+			target, FLT_MAX, levels[i]);
+	});
+
+	lods.clear();
+	for(int i = 0; i < levelCount; ++i)
+	{
+		// Once simplification stalls, every coarser ratio gives the same
+		// mesh again; those levels would only cost index buffer space.
+		if(!lods.empty() && levels[i].size() >= lods.back().IndexCount)
+			break;
+
+		// A coarser level never reports less error than a finer one, so
+		// SelectLod can stop at the first level that is too coarse.
+		MeshLod lod;
+		lod.StartIndex = (std::uint32_t)lodIndices.size();
+		lod.IndexCount = (std::uint32_t)levels[i].size();
+		lod.Error = lods.empty() ? errors[i] : std::max(errors[i], lods.back().Error);
+		lods.push_back(lod);
+
+		lodIndices.insert(lodIndices.end(), levels[i].begin(), levels[i].end());
+	}
+}
+
+int SelectLod(const std::vector<MeshLod>& lods, float distance, float pixelsPerUnit, float maxPixelError)
+{
+	// Levels coarsen monotonically, so stop at the first one too coarse.
+	int selected = 0;
+	for(int i = 1; i < (int)lods.size(); ++i)
+	{
+		if(lods[i].Error*pixelsPerUnit > maxPixelError*std::max(distance, 0.0f))
+			break;
+		selected = i;
+	}
+	return selected;
+}
@@ -0,0 +1,61 @@
+//***************************************************************************************
+// MeshSimplifier.h
+//
+// Quadric error metric simplification (Garland and Heckbert) by edge collapse,
+// and chains of levels of detail built with it.  Every collapse moves a vertex
+// onto a neighbour, so a simplified mesh is a new index list over the original
+// vertices, with their normals and texture coordinates untouched, and all the
+// levels of a chain can share one vertex buffer.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "GeometryGenerator.h"
+
+// One level of detail in a shared index buffer.
+struct MeshLod
+{
+	std::uint32_t StartIndex = 0;
+	std::uint32_t IndexCount = 0;
+
+	// Farthest any vertex of the original lies from the level's surface, in
+	// mesh units; 0 for the original.  Measured at the vertices only, so the
+	// middle of a large flat triangle over a curved area may stray further.
+	float Error = 0.0f;
+};
+
+// Collapses edges, cheapest first, until at most targetIndexCount indices are
+// left or the next collapse's quadric error (the root of its summed squared
+// distances to the original planes around the edge, in mesh units) would
+// exceed maxError.  Vertices on open borders and on seams (a position shared
+// by several vertices) never move, nor does a collapse that would turn a
+// triangle more than 60 degrees or make the surface non-manifold.  Writes the
+// remaining triangles, in their input order, to result and returns the
+// farthest a removed vertex lies from them, as MeshLod::Error.
+float SimplifyMesh(const std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::size_t targetIndexCount, float maxError, std::vector<std::uint32_t>& result);
+
+// Simplifies the mesh to each ratio of its triangle count in parallel, finest
+// first, and appends the levels to lodIndices.  A ratio of 1 copies the mesh.
+// The chain ends at the first level that has no fewer indices than the one
+// before it, so lods can be shorter than ratios.
+void BuildLodChain(const std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	const std::vector<float>& ratios, std::vector<std::uint32_t>& lodIndices, std::vector<MeshLod>& lods);
+
+inline void BuildLodChain(const GeometryGenerator::MeshData& mesh, const std::vector<float>& ratios,
+	std::vector<std::uint32_t>& lodIndices, std::vector<MeshLod>& lods)
+{
+	BuildLodChain(mesh.Indices32.data(), mesh.Indices32.size(), &mesh.Vertices[0].Position,
+		sizeof(GeometryGenerator::Vertex), (std::uint32_t)mesh.Vertices.size(), ratios, lodIndices, lods);
+}
+
+// The coarsest level whose error projects to at most maxPixelError pixels at
+// distance.  pixelsPerUnit is the size in pixels of one mesh unit at distance 1:
+// the object's scale times viewportHeight / (2 tan(fovY/2)).
+int SelectLod(const std::vector<MeshLod>& lods, float distance, float pixelsPerUnit, float maxPixelError = 1.0f);
@@ -0,0 +1,389 @@
+//***************************************************************************************
+// MeshletBuilder.cpp
+//***************************************************************************************
+
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const std::uint32_t NotInMeshlet = ~0u;
+
+	// Unused triangles, in index order, considered to continue a meshlet
+	// that has run out of neighbours.  Only those within acos(FallbackMinCosine)
+	// of the meshlet's average normal qualify, to keep its cone narrow enough
+	// to cull by.
+	const std::uint32_t FallbackCandidates = 32;
+	const float FallbackMinCosine = 0.9f;
+
+	const XMFLOAT3& PositionAt(const XMFLOAT3* positions, std::size_t stride, std::uint32_t v)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const std::uint8_t*>(positions) + v*stride);
+	}
+
+	// Unit normal of each triangle, or zero for a degenerate one.
+	std::vector<XMFLOAT3> TriangleNormals(const std::uint32_t* indices, std::size_t triangleCount,
+		const XMFLOAT3* positions, std::size_t stride)
+	{
+		std::vector<XMFLOAT3> normals(triangleCount);
+		for(std::size_t t = 0; t < triangleCount; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&PositionAt(positions, stride, indices[3*t + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&PositionAt(positions, stride, indices[3*t + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&PositionAt(positions, stride, indices[3*t + 2]));
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+				n = XMVector3Normalize(n);
+			XMStoreFloat3(&normals[t], n);
+		}
+		return normals;
+	}
+
+	// Bounding sphere of the meshlet's vertices and the cone around its
+	// triangle normals.
+	void ComputeBounds(Meshlet& meshlet, const MeshletData& meshlets, const std::uint32_t* triangles,
+		const std::vector<XMFLOAT3>& normals, const XMFLOAT3* positions, std::size_t stride)
+	{
+		std::array<XMFLOAT3, 256> points;
+		for(std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			points[i] = PositionAt(positions, stride, meshlets.VertexIndices[meshlet.VertexOffset + i]);
+		BoundingSphere::CreateFromPoints(meshlet.Bounds, meshlet.VertexCount, points.data(), sizeof(XMFLOAT3));
+
+		XMVECTOR axis = XMVectorZero();
+		for(std::uint32_t i = 0; i < meshlet.TriangleCount; ++i)
+			axis += XMLoadFloat3(&normals[triangles[i]]);
+
+		meshlet.ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		meshlet.ConeCutoff = 1.0f;
+		if(XMVectorGetX(XMVector3LengthSq(axis)) <= 0.0f)
+			return;
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1.0f;
+		for(std::uint32_t i = 0; i < meshlet.TriangleCount; ++i)
+		{
+			XMVECTOR n = XMLoadFloat3(&normals[triangles[i]]);
+			if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+				minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+		}
+
+		// A cone of 90 degrees or more can never be entirely backfacing.
+		if(minDot <= 0.0f)
+			return;
+
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot*minDot);
+	}
+}
+
+void BuildMeshlets(const std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	MeshletData& meshlets, std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	maxVertices = std::min(std::max(maxVertices, 3u), 256u);
+	maxTriangles = std::max(maxTriangles, 1u);
+
+	const std::uint32_t triangleCount = (std::uint32_t)(indexCount/3);
+	const std::vector<XMFLOAT3> normals = TriangleNormals(indices, triangleCount, positions, positionStride);
+
+	// Triangles around each vertex.
+	std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for(std::size_t i = 0; i < 3*(std::size_t)triangleCount; ++i)
+		++adjacencyOffsets[indices[i] + 1];
+	for(std::uint32_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<std::uint32_t> adjacency(3*(std::size_t)triangleCount);
+	std::vector<std::uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for(std::uint32_t t = 0; t < triangleCount; ++t)
+	{
+		for(int k = 0; k < 3; ++k)
+			adjacency[fill[indices[3*t + k]]++] = t;
+	}
+
+	meshlets.Meshlets.clear();
+	meshlets.VertexIndices.clear();
+	meshlets.TriangleIndices.clear();
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<std::uint32_t> localIndex(vertexCount, NotInMeshlet);
+	std::vector<std::uint32_t> meshletTriangles;
+	meshletTriangles.reserve(maxTriangles);
+
+	std::uint32_t seedCursor = 0;
+	for(;;)
+	{
+		while(seedCursor < triangleCount && used[seedCursor])
+			++seedCursor;
+		if(seedCursor == triangleCount)
+			break;
+
+		Meshlet meshlet;
+		meshlet.VertexOffset = (std::uint32_t)meshlets.VertexIndices.size();
+		meshlet.TriangleOffset = (std::uint32_t)(meshlets.TriangleIndices.size()/3);
+		meshletTriangles.clear();
+		XMVECTOR normalSum = XMVectorZero();
+		XMVECTOR vertexSum = XMVectorZero();
+
+		std::uint32_t next = seedCursor;
+		while(next != NotInMeshlet)
+		{
+			const std::uint32_t* tri = &indices[3*next];
+			for(int k = 0; k < 3; ++k)
+			{
+				if(localIndex[tri[k]] == NotInMeshlet)
+				{
+					localIndex[tri[k]] = meshlet.VertexCount++;
+					meshlets.VertexIndices.push_back(tri[k]);
+					vertexSum += XMLoadFloat3(&PositionAt(positions, positionStride, tri[k]));
+				}
+				meshlets.TriangleIndices.push_back((std::uint8_t)localIndex[tri[k]]);
+			}
+			used[next] = true;
+			meshletTriangles.push_back(next);
+			++meshlet.TriangleCount;
+			normalSum += XMLoadFloat3(&normals[next]);
+
+			if(meshlet.TriangleCount == maxTriangles)
+				break;
+
+			// The unused triangle around the meshlet's vertices that adds the
+			// fewest vertices, and then keeps the normals closest together.
+			next = NotInMeshlet;
+			std::uint32_t bestNewVertices = 4;
+			float bestDot = -2.0f;
+			for(std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			{
+				const std::uint32_t v = meshlets.VertexIndices[meshlet.VertexOffset + i];
+				for(std::uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+				{
+					const std::uint32_t t = adjacency[a];
+					if(used[t])
+						continue;
+
+					const std::uint32_t* candidate = &indices[3*t];
+					std::uint32_t newVertices = 0;
+					for(int k = 0; k < 3; ++k)
+					{
+						if(localIndex[candidate[k]] == NotInMeshlet &&
+						   (k == 0 || candidate[k] != candidate[0]) && (k < 2 || candidate[2] != candidate[1]))
+						{
+							++newVertices;
+						}
+					}
+					if(meshlet.VertexCount + newVertices > maxVertices || newVertices > bestNewVertices)
+						continue;
+
+					const float dot = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[t]), normalSum));
+					if(newVertices < bestNewVertices || dot > bestDot)
+					{
+						next = t;
+						bestNewVertices = newVertices;
+						bestDot = dot;
+					}
+				}
+			}
+
+			// Seams split the surface where vertices are duplicated, so with no
+			// neighbour left, continue with the nearest of the next few unused
+			// triangles that face the same way.
+			if(next == NotInMeshlet && meshlet.VertexCount + 3 <= maxVertices)
+			{
+				const XMVECTOR centroid = vertexSum / (float)meshlet.VertexCount;
+				const XMVECTOR averageNormal = XMVector3Normalize(normalSum);
+				float bestDistance = FLT_MAX;
+				std::uint32_t looked = 0;
+				for(std::uint32_t t = seedCursor; t < triangleCount && looked < FallbackCandidates; ++t)
+				{
+					if(used[t])
+						continue;
+					++looked;
+
+					if(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normals[t]), averageNormal)) < FallbackMinCosine)
+						continue;
+
+					const float distance = XMVectorGetX(XMVector3LengthSq(
+						XMLoadFloat3(&PositionAt(positions, positionStride, indices[3*t])) - centroid));
+					if(distance < bestDistance)
+					{
+						next = t;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+
+		ComputeBounds(meshlet, meshlets, meshletTriangles.data(), normals, positions, positionStride);
+
+		for(std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			localIndex[meshlets.VertexIndices[meshlet.VertexOffset + i]] = NotInMeshlet;
+
+		meshlets.Meshlets.push_back(meshlet);
+	}
+}
+
+bool ValidateMeshlets(const MeshletData& meshlets,
+	const std::uint32_t* indices, std::size_t indexCount,
+	const XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::string& error, std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	// Triangles rotated to start at their smallest index, which keeps the
+	// winding, so the two lists compare equal once sorted.
+	auto canonical = [](std::uint32_t a, std::uint32_t b, std::uint32_t c)
+	{
+		if(b < a && b <= c)
+			return std::array<std::uint32_t, 3>{ b, c, a };
+		if(c < a && c < b)
+			return std::array<std::uint32_t, 3>{ c, a, b };
+		return std::array<std::uint32_t, 3>{ a, b, c };
+	};
+
+	std::vector<std::array<std::uint32_t, 3>> expected;
+	expected.reserve(indexCount/3);
+	for(std::size_t i = 0; i + 2 < indexCount; i += 3)
+		expected.push_back(canonical(indices[i], indices[i + 1], indices[i + 2]));
+
+	std::vector<std::array<std::uint32_t, 3>> found;
+	found.reserve(indexCount/3);
+
+	for(std::size_t m = 0; m < meshlets.Meshlets.size(); ++m)
+	{
+		const Meshlet& meshlet = meshlets.Meshlets[m];
+		const std::string where = "meshlet " + std::to_string(m) + ": ";
+
+		if(meshlet.VertexCount == 0 || meshlet.VertexCount > maxVertices ||
+		   meshlet.TriangleCount == 0 || meshlet.TriangleCount > maxTriangles)
+		{
+			error = where + std::to_string(meshlet.VertexCount) + " vertices and " +
+				std::to_string(meshlet.TriangleCount) + " triangles are outside the limits";
+			return false;
+		}
+		if((std::size_t)meshlet.VertexOffset + meshlet.VertexCount > meshlets.VertexIndices.size() ||
+		   3*((std::size_t)meshlet.TriangleOffset + meshlet.TriangleCount) > meshlets.TriangleIndices.size())
+		{
+			error = where + "ranges run past the end of the index lists";
+			return false;
+		}
+
+		const std::uint32_t* vertices = &meshlets.VertexIndices[meshlet.VertexOffset];
+		const std::uint8_t* triangles = &meshlets.TriangleIndices[3*(std::size_t)meshlet.TriangleOffset];
+
+		// Bounds are single precision, so allow for rounding relative to the
+		// sphere's size and position.
+		const XMVECTOR center = XMLoadFloat3(&meshlet.Bounds.Center);
+		const float slack = 1e-4f*(meshlet.Bounds.Radius + XMVectorGetX(XMVector3Length(center))) + 1e-6f;
+		for(std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			if(vertices[i] >= vertexCount)
+			{
+				error = where + "vertex " + std::to_string(vertices[i]) + " is out of range";
+				return false;
+			}
+
+			XMVECTOR p = XMLoadFloat3(&PositionAt(positions, positionStride, vertices[i]));
+			if(XMVectorGetX(XMVector3Length(p - center)) > meshlet.Bounds.Radius + slack)
+			{
+				error = where + "vertex " + std::to_string(vertices[i]) + " is outside the bounding sphere";
+				return false;
+			}
+		}
+
+		const XMVECTOR axis = XMLoadFloat3(&meshlet.ConeAxis);
+		const float minDot = sqrtf(std::max(1.0f - meshlet.ConeCutoff*meshlet.ConeCutoff, 0.0f));
+		for(std::uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const std::uint8_t* tri = &triangles[3*t];
+			if(tri[0] >= meshlet.VertexCount || tri[1] >= meshlet.VertexCount || tri[2] >= meshlet.VertexCount)
+			{
+				error = where + "triangle " + std::to_string(t) + " uses a vertex past the meshlet's";
+				return false;
+			}
+
+			const std::uint32_t a = vertices[tri[0]], b = vertices[tri[1]], c = vertices[tri[2]];
+			found.push_back(canonical(a, b, c));
+
+			if(meshlet.ConeCutoff < 1.0f)
+			{
+				XMVECTOR p0 = XMLoadFloat3(&PositionAt(positions, positionStride, a));
+				XMVECTOR p1 = XMLoadFloat3(&PositionAt(positions, positionStride, b));
+				XMVECTOR p2 = XMLoadFloat3(&PositionAt(positions, positionStride, c));
+				XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+				if(XMVectorGetX(XMVector3LengthSq(n)) > 0.0f &&
+				   XMVectorGetX(XMVector3Dot(XMVector3Normalize(n), axis)) < minDot - 1e-3f)
+				{
+					error = where + "triangle " + std::to_string(t) + " is outside the normal cone";
+					return false;
+				}
+			}
+		}
+	}
+
+	std::sort(expected.begin(), expected.end());
+	std::sort(found.begin(), found.end());
+	if(expected != found)
+	{
+		error = "the meshlets' triangles differ from the mesh's (" + std::to_string(found.size()) +
+			" against " + std::to_string(expected.size()) + ")";
+		return false;
+	}
+
+	error.clear();
+	return true;
+}
+
+MeshletStats AnalyzeMeshlets(const MeshletData& meshlets, std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	MeshletStats stats;
+	stats.MeshletCount = meshlets.Meshlets.size();
+	if(stats.MeshletCount == 0)
+		return stats;
+
+	std::size_t vertices = 0;
+	std::size_t triangles = 0;
+	for(const Meshlet& meshlet : meshlets.Meshlets)
+	{
+		vertices += meshlet.VertexCount;
+		triangles += meshlet.TriangleCount;
+		if(meshlet.ConeCutoff < 1.0f)
+			++stats.CullableCones;
+	}
+
+	std::vector<std::uint32_t> unique(meshlets.VertexIndices);
+	std::sort(unique.begin(), unique.end());
+	unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+	stats.VertexFill = (float)vertices / (stats.MeshletCount*maxVertices);
+	stats.TriangleFill = (float)triangles / (stats.MeshletCount*maxTriangles);
+	stats.VertexDuplication = (float)vertices / unique.size();
+	return stats;
+}
+
+bool IsMeshletBackfacing(const Meshlet& meshlet, FXMVECTOR eye)
+{
+	if(meshlet.ConeCutoff >= 1.0f)
+		return false;
+
+	// Every direction from eye into the sphere must be within 90 degrees
+	// minus the cone's half angle of the axis; bound the worst one.
+	XMVECTOR toCenter = XMLoadFloat3(&meshlet.Bounds.Center) - eye;
+	const float along = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.ConeAxis)));
+	const float distance = XMVectorGetX(XMVector3Length(toCenter));
+	return along >= meshlet.ConeCutoff*distance + meshlet.Bounds.Radius*(1.0f + meshlet.ConeCutoff);
+}
+
+void CullMeshlets(const MeshletData& meshlets, const BoundingFrustum& frustum,
+	FXMVECTOR eye, std::vector<int>& visible)
+{
+	visible.clear();
+	for(int m = 0; m < (int)meshlets.Meshlets.size(); ++m)
+	{
+		const Meshlet& meshlet = meshlets.Meshlets[m];
+		if(frustum.Intersects(meshlet.Bounds) && !IsMeshletBackfacing(meshlet, eye))
+			visible.push_back(m);
+	}
+}
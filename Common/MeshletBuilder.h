@@ -0,0 +1,105 @@
+//***************************************************************************************
+// MeshletBuilder.h
+//
+// Splits a triangle mesh into meshlets: small clusters of neighbouring triangles
+// with their own vertex list, bounding sphere and normal cone, so whole clusters
+// can be frustum and backface culled before they are submitted.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "GeometryGenerator.h"
+
+// Limits that suit mesh shader output and 8-bit local indices.
+const std::uint32_t MeshletMaxVertices = 64;
+const std::uint32_t MeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+	// Ranges of MeshletData::VertexIndices and, three per triangle, of
+	// MeshletData::TriangleIndices.
+	std::uint32_t VertexOffset = 0;
+	std::uint32_t VertexCount = 0;
+	std::uint32_t TriangleOffset = 0;
+	std::uint32_t TriangleCount = 0;
+
+	// In the mesh's local space.
+	DirectX::BoundingSphere Bounds;
+
+	// Every triangle normal is within asin(ConeCutoff) of ConeAxis.  A cutoff
+	// of 1 means the normals are too spread out to cull by.
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 0.0f };
+	float ConeCutoff = 1.0f;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+
+	// Mesh vertex of each meshlet-local vertex.
+	std::vector<std::uint32_t> VertexIndices;
+
+	// Meshlet-local vertices of each triangle.
+	std::vector<std::uint8_t> TriangleIndices;
+};
+
+struct MeshletStats
+{
+	std::size_t MeshletCount = 0;
+
+	// Average vertices and triangles per meshlet, as a fraction of the limits.
+	float VertexFill = 0.0f;
+	float TriangleFill = 0.0f;
+
+	// Meshlet vertices per vertex used by the mesh; 1 means none is shared
+	// between meshlets.
+	float VertexDuplication = 0.0f;
+
+	// Meshlets whose cone can cull them at all.
+	std::size_t CullableCones = 0;
+};
+
+// Grows each meshlet from a seed triangle by adding the neighbouring triangle
+// that brings in the fewest new vertices and bends the meshlet's normal the
+// least, until a limit is reached.  With no neighbour left, it continues with
+// a nearby unused triangle facing the same way.  The next meshlet is seeded
+// from the first triangle left in index order, so run OptimizeMesh first for
+// spatially coherent meshlets.  Triangles stay whole and keep their winding.
+// maxVertices is at most 256, for the 8-bit local indices.
+void BuildMeshlets(const std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	MeshletData& meshlets,
+	std::uint32_t maxVertices = MeshletMaxVertices, std::uint32_t maxTriangles = MeshletMaxTriangles);
+
+inline void BuildMeshlets(const GeometryGenerator::MeshData& mesh, MeshletData& meshlets)
+{
+	BuildMeshlets(mesh.Indices32.data(), mesh.Indices32.size(), &mesh.Vertices[0].Position,
+		sizeof(GeometryGenerator::Vertex), (std::uint32_t)mesh.Vertices.size(), meshlets);
+}
+
+// Checks that the meshlets respect the limits, reproduce every triangle of the
+// mesh exactly once with its winding, and bound their vertices and normals.
+// On failure returns false and describes the first problem in error.
+bool ValidateMeshlets(const MeshletData& meshlets,
+	const std::uint32_t* indices, std::size_t indexCount,
+	const DirectX::XMFLOAT3* positions, std::size_t positionStride, std::uint32_t vertexCount,
+	std::string& error,
+	std::uint32_t maxVertices = MeshletMaxVertices, std::uint32_t maxTriangles = MeshletMaxTriangles);
+
+MeshletStats AnalyzeMeshlets(const MeshletData& meshlets,
+	std::uint32_t maxVertices = MeshletMaxVertices, std::uint32_t maxTriangles = MeshletMaxTriangles);
+
+// True if every triangle of the meshlet faces away from eye, given in the
+// mesh's local space.
+bool IsMeshletBackfacing(const Meshlet& meshlet, DirectX::FXMVECTOR eye);
+
+// Replaces visible with the meshlets that intersect frustum and are not
+// backfacing from eye, both in the mesh's local space.
+void CullMeshlets(const MeshletData& meshlets, const DirectX::BoundingFrustum& frustum,
+	DirectX::FXMVECTOR eye, std::vector<int>& visible);
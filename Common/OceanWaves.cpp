@@ -0,0 +1,477 @@
+//***************************************************************************************
+// OceanWaves.cpp
+//***************************************************************************************
+
+#include "OceanWaves.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <intrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const float Gravity = 9.81f;
+
+	// Dispersion is quantized to multiples of 2*pi/RepeatPeriod, so the ocean
+	// loops seamlessly after that many seconds and the clock can wrap there,
+	// keeping the phases small enough for float.
+	const float RepeatPeriod = 256.0f;
+
+	// Columns each task transforms: one cache line of real parts and one of
+	// imaginary parts per row.
+	const int FFTStrip = 16;
+
+	// Transforms columns [c0, c1) of the n x n array (re, im) in place, along
+	// the row index.  Every butterfly stage runs across four columns at a time,
+	// each SSE lane being a separate transform with the same twiddle.
+	void InverseFFTColumns(float* re, float* im, int n, int c0, int c1,
+		const float* twiddleRe, const float* twiddleIm, const int* bitReverse)
+	{
+		for(int r = 0; r < n; ++r)
+		{
+			const int s = bitReverse[r];
+			if(r < s)
+			{
+				std::swap_ranges(re + r*n + c0, re + r*n + c1, re + s*n + c0);
+				std::swap_ranges(im + r*n + c0, im + r*n + c1, im + s*n + c0);
+			}
+		}
+
+		for(int half = 1; half < n; half *= 2)
+		{
+			const int twiddleStep = n / (2*half);
+			for(int block = 0; block < n; block += 2*half)
+			{
+				for(int k = 0; k < half; ++k)
+				{
+					const __m128 wr = _mm_set1_ps(twiddleRe[k*twiddleStep]);
+					const __m128 wi = _mm_set1_ps(twiddleIm[k*twiddleStep]);
+
+					float* aRe = re + (block + k)*n;
+					float* aIm = im + (block + k)*n;
+					float* bRe = aRe + half*n;
+					float* bIm = aIm + half*n;
+
+					for(int c = c0; c < c1; c += 4)
+					{
+						const __m128 xr = _mm_loadu_ps(aRe + c);
+						const __m128 xi = _mm_loadu_ps(aIm + c);
+						const __m128 yr = _mm_loadu_ps(bRe + c);
+						const __m128 yi = _mm_loadu_ps(bIm + c);
+
+						// t = w*y
+						const __m128 tr = _mm_sub_ps(_mm_mul_ps(yr, wr), _mm_mul_ps(yi, wi));
+						const __m128 ti = _mm_add_ps(_mm_mul_ps(yr, wi), _mm_mul_ps(yi, wr));
+
+						_mm_storeu_ps(aRe + c, _mm_add_ps(xr, tr));
+						_mm_storeu_ps(aIm + c, _mm_add_ps(xi, ti));
+						_mm_storeu_ps(bRe + c, _mm_sub_ps(xr, tr));
+						_mm_storeu_ps(bIm + c, _mm_sub_ps(xi, ti));
+					}
+				}
+			}
+		}
+	}
+
+	// Writes the transpose of rows [r0, r1) of the n x n src into dst, four
+	// by four.
+	void TransposeRows(float* dst, const float* src, int n, int r0, int r1)
+	{
+		for(int r = r0; r < r1; r += 4)
+		{
+			for(int c = 0; c < n; c += 4)
+			{
+				__m128 row0 = _mm_loadu_ps(src + (r + 0)*n + c);
+				__m128 row1 = _mm_loadu_ps(src + (r + 1)*n + c);
+				__m128 row2 = _mm_loadu_ps(src + (r + 2)*n + c);
+				__m128 row3 = _mm_loadu_ps(src + (r + 3)*n + c);
+				_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+				_mm_storeu_ps(dst + (c + 0)*n + r, row0);
+				_mm_storeu_ps(dst + (c + 1)*n + r, row1);
+				_mm_storeu_ps(dst + (c + 2)*n + r, row2);
+				_mm_storeu_ps(dst + (c + 3)*n + r, row3);
+			}
+		}
+	}
+
+	XMFLOAT3 NormalFromSlopes(float slopeX, float slopeZ)
+	{
+		float invLen = 1.0f / sqrtf(slopeX*slopeX + 1.0f + slopeZ*slopeZ);
+		return XMFLOAT3(-slopeX*invLen, invLen, -slopeZ*invLen);
+	}
+}
+
+OceanFFT::OceanFFT(int n)
+{
+	assert(n >= FFTStrip && (n & (n - 1)) == 0);
+
+	mSize = n;
+	int log2Size = 0;
+	while((1 << log2Size) < n)
+		++log2Size;
+
+	mTwiddleRe.resize(n / 2);
+	mTwiddleIm.resize(n / 2);
+	for(int j = 0; j < n / 2; ++j)
+	{
+		mTwiddleRe[j] = cosf(XM_2PI*j / n);
+		mTwiddleIm[j] = sinf(XM_2PI*j / n);
+	}
+
+	mBitReverse.resize(n);
+	for(int j = 0; j < n; ++j)
+	{
+		int reversed = 0;
+		for(int b = 0; b < log2Size; ++b)
+			reversed |= ((j >> b) & 1) << (log2Size - 1 - b);
+		mBitReverse[j] = reversed;
+	}
+}
+
+void OceanFFT::Inverse(int fieldCount, std::vector<float>* spectrumRe, std::vector<float>* spectrumIm,
+	std::vector<float>* surfaceRe, std::vector<float>* surfaceIm)const
+{
+	const int n = mSize;
+	const int strips = n / FFTStrip;
+	const int tasks = fieldCount*strips;
+
+	// Along kx, in place.
+	concurrency::parallel_for(0, tasks, [=](int task)
+	{
+		const int f = task / strips;
+		const int c0 = (task % strips)*FFTStrip;
+		InverseFFTColumns(spectrumRe[f].data(), spectrumIm[f].data(), n, c0, c0 + FFTStrip,
+			mTwiddleRe.data(), mTwiddleIm.data(), mBitReverse.data());
+	});
+
+	// Bring kz down the columns.
+	concurrency::parallel_for(0, tasks, [=](int task)
+	{
+		const int f = task / strips;
+		const int r0 = (task % strips)*FFTStrip;
+		TransposeRows(surfaceRe[f].data(), spectrumRe[f].data(), n, r0, r0 + FFTStrip);
+		TransposeRows(surfaceIm[f].data(), spectrumIm[f].data(), n, r0, r0 + FFTStrip);
+	});
+
+	// Along kz, leaving the surface row-major.
+	concurrency::parallel_for(0, tasks, [=](int task)
+	{
+		const int f = task / strips;
+		const int c0 = (task % strips)*FFTStrip;
+		InverseFFTColumns(surfaceRe[f].data(), surfaceIm[f].data(), n, c0, c0 + FFTStrip,
+			mTwiddleRe.data(), mTwiddleIm.data(), mBitReverse.data());
+	});
+}
+
+OceanWaves::OceanWaves(int n, float patchSize, float windSpeed, XMFLOAT2 windDirection,
+	float amplitude, float choppiness, std::uint32_t seed)
+	: mFFT(n)
+{
+	mSize = n;
+
+	mPatchSize = patchSize;
+	mSpatialStep = patchSize / n;
+	mHalfWidth = 0.5f*patchSize;
+	mChoppiness = choppiness;
+	mFieldCount = choppiness != 0.0f ? 3 : 2;
+
+	// Derive tex-coords from position by mapping [-w/2,w/2] --> [0,1].
+	mCoords.X.resize(n + 1);
+	mCoords.U.resize(n + 1);
+	mCoords.Z.resize(n + 1);
+	mCoords.V.resize(n + 1);
+	for(int j = 0; j <= n; ++j)
+	{
+		mCoords.X[j] = -mHalfWidth + j*mSpatialStep;
+		mCoords.U[j] = 0.5f + mCoords.X[j] / Width();
+		mCoords.Z[j] = mHalfWidth - j*mSpatialStep;
+		mCoords.V[j] = 0.5f - mCoords.Z[j] / Depth();
+	}
+
+	// Phillips spectrum: P(k) = A exp(-1/(kL)^2) / k^4 |k.w|^2, with very short
+	// waves faded out.  Each frequency stands for a dk x dk cell of it, so the
+	// sea state does not change with the patch size or resolution.
+	// A zero wind direction would make every term NaN; blow along +x instead.
+	const float windLength = sqrtf(windDirection.x*windDirection.x + windDirection.y*windDirection.y);
+	const float windX = windLength > 0.0f ? windDirection.x / windLength : 1.0f;
+	const float windZ = windLength > 0.0f ? windDirection.y / windLength : 0.0f;
+	const float largestWave = windSpeed*windSpeed / Gravity;
+	const float smallestWave = 0.001f*largestWave;
+	const float omega0 = XM_2PI / RepeatPeriod;
+	const float dk = XM_2PI / patchSize;
+
+	const int count = n*n;
+	mH0Re.assign(count, 0.0f);
+	mH0Im.assign(count, 0.0f);
+	mH0MinusRe.assign(count, 0.0f);
+	mH0MinusIm.assign(count, 0.0f);
+	mOmega.assign(count, 0.0f);
+	mKx.assign(count, 0.0f);
+	mKz.assign(count, 0.0f);
+	mInvK.assign(count, 0.0f);
+
+	// Frequencies are laid out in FFT order, with x along the rows of the
+	// transposed spectrum.  The grid rows run towards -z, so kz is negated to
+	// make the z slopes and displacements come out in world space.
+	auto frequency = [n](int index) { return index < n / 2 ? index : index - n; };
+
+	std::mt19937 rng(seed);
+	std::normal_distribution<float> gaussian;
+	std::vector<float> xiRe(count);
+	std::vector<float> xiIm(count);
+	for(int k = 0; k < count; ++k)
+	{
+		xiRe[k] = gaussian(rng);
+		xiIm[k] = gaussian(rng);
+	}
+
+	for(int r = 0; r < n; ++r)
+	{
+		for(int c = 0; c < n; ++c)
+		{
+			const int k = r*n + c;
+			const float kx = XM_2PI*frequency(r) / patchSize;
+			const float kz = -XM_2PI*frequency(c) / patchSize;
+			const float kLength = sqrtf(kx*kx + kz*kz);
+
+			mKx[k] = kx;
+			mKz[k] = kz;
+			mInvK[k] = kLength > 0.0f ? 1.0f / kLength : 0.0f;
+			mOmega[k] = floorf(sqrtf(Gravity*kLength) / omega0)*omega0;
+		}
+	}
+
+	auto phillips = [&](int k)
+	{
+		const float kLength2 = mKx[k]*mKx[k] + mKz[k]*mKz[k];
+		if(kLength2 == 0.0f)
+			return 0.0f;
+
+		const float kDotW = (mKx[k]*windX + mKz[k]*windZ)*mInvK[k];
+		return amplitude*dk*dk*expf(-1.0f / (kLength2*largestWave*largestWave)) / (kLength2*kLength2) *
+			kDotW*kDotW * expf(-kLength2*smallestWave*smallestWave);
+	};
+
+	for(int r = 0; r < n; ++r)
+	{
+		for(int c = 0; c < n; ++c)
+		{
+			// The Nyquist row and column have no partner at -k, so they are
+			// left empty to keep every field real.
+			if(r == n / 2 || c == n / 2)
+				continue;
+
+			const int k = r*n + c;
+			const int minusK = ((n - r) & (n - 1))*n + ((n - c) & (n - 1));
+
+			const float scale = sqrtf(0.5f*phillips(k));
+			mH0Re[k] = xiRe[k]*scale;
+			mH0Im[k] = xiIm[k]*scale;
+
+			const float minusScale = sqrtf(0.5f*phillips(minusK));
+			mH0MinusRe[k] = xiRe[minusK]*minusScale;
+			mH0MinusIm[k] = -xiIm[minusK]*minusScale;
+		}
+	}
+
+	for(int f = 0; f < mFieldCount; ++f)
+	{
+		mSpectrumRe[f].resize(count);
+		mSpectrumIm[f].resize(count);
+		mSurfaceRe[f].resize(count);
+		mSurfaceIm[f].resize(count);
+	}
+
+	BuildSpectrum();
+	mFFT.Inverse(mFieldCount, mSpectrumRe, mSpectrumIm, mSurfaceRe, mSurfaceIm);
+}
+
+OceanWaves::~OceanWaves()
+{
+}
+
+int OceanWaves::RowCount()const
+{
+	return mSize + 1;
+}
+
+int OceanWaves::ColumnCount()const
+{
+	return mSize + 1;
+}
+
+int OceanWaves::VertexCount()const
+{
+	return (mSize + 1)*(mSize + 1);
+}
+
+int OceanWaves::TriangleCount()const
+{
+	return mSize*mSize*2;
+}
+
+float OceanWaves::Width()const
+{
+	return mPatchSize;
+}
+
+float OceanWaves::Depth()const
+{
+	return mPatchSize;
+}
+
+XMFLOAT3 OceanWaves::Position(int i)const
+{
+	const int s = Sample(i);
+	float x = mCoords.X[i % (mSize + 1)] + mChoppiness*mSurfaceIm[1][s];
+	float z = mCoords.Z[i / (mSize + 1)];
+	if(mFieldCount > 2)
+		z += mChoppiness*mSurfaceRe[2][s];
+
+	return XMFLOAT3(x, mSurfaceRe[0][s], z);
+}
+
+XMFLOAT3 OceanWaves::Normal(int i)const
+{
+	const int s = Sample(i);
+	return NormalFromSlopes(mSurfaceIm[0][s], mSurfaceRe[1][s]);
+}
+
+XMFLOAT3 OceanWaves::TangentX(int i)const
+{
+	const float slopeX = mSurfaceIm[0][Sample(i)];
+	const float invLen = 1.0f / sqrtf(1.0f + slopeX*slopeX);
+	return XMFLOAT3(invLen, slopeX*invLen, 0.0f);
+}
+
+void OceanWaves::Update(float dt)
+{
+	mTime = fmodf(mTime + dt, RepeatPeriod);
+
+	BuildSpectrum();
+	mFFT.Inverse(mFieldCount, mSpectrumRe, mSpectrumIm, mSurfaceRe, mSurfaceIm);
+	++mVersion;
+}
+
+void OceanWaves::BuildSpectrum()
+{
+	const int n = mSize;
+	const bool choppy = mFieldCount > 2;
+
+	concurrency::parallel_for(0, n, [this, n, choppy](int r)
+	{
+		for(int k = r*n; k < (r + 1)*n; ++k)
+		{
+			// h(k, t) = h0(k) e^(iwt) + conj(h0(-k)) e^(-iwt)
+			float s, c;
+			XMScalarSinCos(&s, &c, mOmega[k]*mTime);
+			const float hRe = (mH0Re[k] + mH0MinusRe[k])*c - (mH0Im[k] - mH0MinusIm[k])*s;
+			const float hIm = (mH0Im[k] + mH0MinusIm[k])*c + (mH0Re[k] - mH0MinusRe[k])*s;
+
+			// Each pair of real fields shares one complex transform as a + ib:
+			// slopes are ik h, displacements ik/|k| h.
+			const float kx = mKx[k];
+			const float kz = mKz[k];
+			const float ux = kx*mInvK[k];
+			const float uz = kz*mInvK[k];
+
+			// h + i(ikx h) = (1 - kx) h
+			mSpectrumRe[0][k] = (1.0f - kx)*hRe;
+			mSpectrumIm[0][k] = (1.0f - kx)*hIm;
+
+			// ikz h + i(iux h) = (-ux + ikz) h
+			mSpectrumRe[1][k] = -ux*hRe - kz*hIm;
+			mSpectrumIm[1][k] = -ux*hIm + kz*hRe;
+
+			if(choppy)
+			{
+				// iuz h
+				mSpectrumRe[2][k] = -uz*hIm;
+				mSpectrumIm[2][k] = uz*hRe;
+			}
+		}
+	});
+}
+
+void OceanWaves::GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const
+{
+	// The whole patch is one tile.
+	tileVersions.resize(1, 0);
+	if(tileVersions[0] == mVersion)
+		return;
+	tileVersions[0] = mVersion;
+
+	if(!rowRanges.empty() && rowRanges.back().second == 0)
+		rowRanges.back().second = RowCount();
+	else
+		rowRanges.push_back(std::make_pair(0, RowCount()));
+}
+
+void OceanWaves::CaptureFrame(WavesFrame& frame)const
+{
+	frame.mNumRows = RowCount();
+	frame.mNumCols = ColumnCount();
+	frame.mSpatialStep = mSpatialStep;
+	frame.mHalfWidth = mHalfWidth;
+	frame.mHalfDepth = mHalfWidth;
+	if(frame.mCoords.X.empty())
+		frame.mCoords = mCoords;
+
+	// The ocean keeps no WaveStats.
+	frame.mStats = WaveStats();
+
+	frame.mHeights.resize(VertexCount());
+	frame.mNormals.resize(VertexCount());
+
+	std::vector<std::pair<int, int>> rowRanges;
+	GetDirtyRows(frame.mTileVersions, rowRanges);
+
+	for(const auto& rows : rowRanges)
+	{
+		for(int i = rows.first*ColumnCount(); i < rows.second*ColumnCount(); ++i)
+		{
+			frame.mHeights[i] = Height(i);
+			frame.mNormals[i] = Normal(i);
+		}
+	}
+}
+
+void OceanWaves::WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const
+{
+	WriteVertices(firstRow, lastRow, 0, ColumnCount(), vertices + firstRow*ColumnCount());
+}
+
+void OceanWaves::WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const
+{
+	const int n = mSize;
+	const int cols = lastCol - firstCol;
+	const bool aligned = (reinterpret_cast<std::uintptr_t>(vertices) & 15) == 0;
+	const float* heights = mSurfaceRe[0].data();
+	const float* slopesX = mSurfaceIm[0].data();
+	const float* slopesZ = mSurfaceRe[1].data();
+	const float* displaceX = mSurfaceIm[1].data();
+	const float* displaceZ = mFieldCount > 2 ? mSurfaceRe[2].data() : nullptr;
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		const int row = (i & (n - 1))*n;
+		const float z = mCoords.Z[i];
+		const float v = mCoords.V[i];
+		WaveVertex* dst = vertices + (i - firstRow)*cols;
+
+		for(int j = firstCol; j < lastCol; ++j, ++dst)
+		{
+			const int s = row + (j & (n - 1));
+			const XMFLOAT3 normal = NormalFromSlopes(slopesX[s], slopesZ[s]);
+			const float x = mCoords.X[j] + mChoppiness*displaceX[s];
+			const float dz = displaceZ ? mChoppiness*displaceZ[s] : 0.0f;
+			StoreWaveVertex(dst, aligned, x, heights[s], z + dz, normal, mCoords.U[j], v);
+		}
+	}
+
+	_mm_sfence();
+}
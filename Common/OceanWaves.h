@@ -0,0 +1,160 @@
+//***************************************************************************************
+// OceanWaves.h
+//
+// Open-ocean alternative to WaveSolver.  Instead of integrating the wave equation,
+// the surface is synthesized every frame from a Phillips spectrum (Tessendorf,
+// "Simulating Ocean Water"): each frequency evolves analytically and one 2D inverse
+// FFT per field brings the whole patch back to space.  The cost per Update() is a
+// fixed O(N^2 log N) whatever the sea state, and the patch is periodic, so copies
+// placed Width() apart tile an unbounded surface without seams.
+//
+// It has WaveSolver's Position/Normal/TangentX, dirty rows and row versions,
+// WavesFrame captures and WaveVertex rows or blocks, so the water render item
+// and WaveChunkGrid work with it unchanged.  There is no Disturb(): the
+// spectrum, not impulses, drives the water, so WaveSolverThread cannot run it.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <DirectXMath.h>
+#include "WaveSolver.h"
+
+// Inverse 2D FFT of n x n complex fields, with the real and imaginary parts
+// kept apart so the butterflies vectorize.  n is a power of two no smaller
+// than 16.
+class OceanFFT
+{
+public:
+	explicit OceanFFT(int n);
+
+	int Size()const { return mSize; }
+
+	// Transforms fieldCount fields at once.  spectrum[f] holds F(kx, kz) at
+	// kx*n + kz, i.e. transposed, and is used as scratch.  surface[f] receives
+	// f(x, z) = sum F(kx, kz) e^(2*pi*i*(kx*x + kz*z)/n) at z*n + x.
+	void Inverse(int fieldCount, std::vector<float>* spectrumRe, std::vector<float>* spectrumIm,
+		std::vector<float>* surfaceRe, std::vector<float>* surfaceIm)const;
+
+private:
+	int mSize = 0;
+
+	// e^(2*pi*i*j/n) for j < n/2, and the bit reversal.
+	std::vector<float> mTwiddleRe;
+	std::vector<float> mTwiddleIm;
+	std::vector<int> mBitReverse;
+};
+
+class OceanWaves
+{
+public:
+	// n is the FFT size, a power of two no smaller than 16.  The grid has n+1
+	// vertices per side covering patchSize, with the last row and column
+	// repeating the first so neighbouring patches share their edges.
+	// windDirection need not be normalized; zero means +x.  amplitude is the
+	// Phillips constant; around 5e-4 gives realistic seas for the wind speed.
+	// choppiness pulls vertices towards the crests; 0 leaves them on the grid
+	// and skips one FFT per update.
+	OceanWaves(int n, float patchSize, float windSpeed, DirectX::XMFLOAT2 windDirection,
+		float amplitude, float choppiness, std::uint32_t seed);
+	OceanWaves(const OceanWaves& rhs) = delete;
+	OceanWaves& operator=(const OceanWaves& rhs) = delete;
+	~OceanWaves();
+
+	int RowCount()const;
+	int ColumnCount()const;
+	int VertexCount()const;
+	int TriangleCount()const;
+	float Width()const;
+	float Depth()const;
+
+	// Seconds of simulated time.  The ocean repeats itself every few minutes,
+	// and the clock wraps around when it does.
+	float Time()const { return mTime; }
+
+	// Returns the surface at the ith grid point, including the choppy
+	// horizontal displacement.
+	DirectX::XMFLOAT3 Position(int i)const;
+
+	// Returns the surface height at the ith grid point.
+	float Height(int i)const { return mSurfaceRe[0][Sample(i)]; }
+
+	// Returns the surface normal at the ith grid point.  It comes from the
+	// exact spectral slopes of the height field; the choppy displacement does
+	// not bend it.
+	DirectX::XMFLOAT3 Normal(int i)const;
+
+	// Returns the unit tangent vector at the ith grid point in the local x-axis direction.
+	DirectX::XMFLOAT3 TangentX(int i)const;
+
+	// Advances the ocean by dt and resynthesizes the whole patch.
+	void Update(float dt);
+
+	// Same as WaveSolver::GetDirtyRows.  Every Update() moves the whole patch,
+	// so the rows come back all or nothing.
+	void GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const;
+
+	// Same as WaveSolver::RowsVersion.  One version covers the whole patch and
+	// goes up with every Update().
+	std::uint64_t RowsVersion(int firstRow, int lastRow)const { return mVersion; }
+
+	// Same as WaveSolver::CaptureFrame.  A WavesFrame has no horizontal
+	// displacement, so the frame keeps the heights and normals on the
+	// undisplaced grid and drops the choppiness.
+	void CaptureFrame(WavesFrame& frame)const;
+
+	// Same as WaveSolver::WriteVertices.
+	void WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const;
+	void WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const;
+
+private:
+	// Index into the n x n fields of grid point i of the (n+1) x (n+1) grid.
+	int Sample(int i)const
+	{
+		const int row = (i / (mSize + 1)) & (mSize - 1);
+		const int col = (i % (mSize + 1)) & (mSize - 1);
+		return row*mSize + col;
+	}
+
+	void BuildSpectrum();
+
+	int mSize = 0;
+	float mPatchSize = 0.0f;
+	float mSpatialStep = 0.0f;
+	float mHalfWidth = 0.0f;
+	float mChoppiness = 0.0f;
+	float mTime = 0.0f;
+
+	// Starts at 1, so a fresh consumer writes every row.
+	std::uint64_t mVersion = 1;
+
+	WaveGridCoords mCoords;
+	OceanFFT mFFT;
+
+	// Per frequency, stored transposed (kx major) for the first FFT pass:
+	// h0(k), conj(h0(-k)), the dispersion w(k), the wave vector and 1/|k|.
+	std::vector<float> mH0Re;
+	std::vector<float> mH0Im;
+	std::vector<float> mH0MinusRe;
+	std::vector<float> mH0MinusIm;
+	std::vector<float> mOmega;
+	std::vector<float> mKx;
+	std::vector<float> mKz;
+	std::vector<float> mInvK;
+
+	// Up to three complex fields, each carrying two real ones.  The spectra
+	// are transformed along kx in place, then transposed into the surface
+	// arrays and transformed along kz, which leaves the surface row-major:
+	//   field 0: height (re), x slope (im)
+	//   field 1: z slope (re), x displacement (im)
+	//   field 2: z displacement (re), only when choppy.
+	// Real and imaginary parts are kept apart so the butterflies vectorize.
+	static const int MaxFields = 3;
+	int mFieldCount = 0;
+	std::vector<float> mSpectrumRe[MaxFields];
+	std::vector<float> mSpectrumIm[MaxFields];
+	std::vector<float> mSurfaceRe[MaxFields];
+	std::vector<float> mSurfaceIm[MaxFields];
+};
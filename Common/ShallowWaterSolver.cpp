@@ -0,0 +1,554 @@
+//***************************************************************************************
+// ShallowWaterSolver.cpp
+//***************************************************************************************
+
+#include "ShallowWaterSolver.h"
+#include <ppl.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <intrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const float Gravity = 9.81f;
+
+	// Points shallower than this count as dry: no water leaves them.
+	const float DryDepth = 1e-4f;
+
+	// New velocity of one face from the surface on either side, and its flux
+	// of the upwind depth.  Water only leaves wet points.
+	inline float FaceUpdate(float velocity, float water0, float bed0, float water1, float bed1,
+		float gravityStep, float damping, float maxSpeed, float* flux)
+	{
+		velocity = (velocity - gravityStep*((water1 + bed1) - (water0 + bed0)))*damping;
+		velocity = std::min(std::max(velocity, -maxSpeed), maxSpeed);
+
+		const float upwind = velocity > 0.0f ? water0 : water1;
+		if(!(upwind > DryDepth))
+			velocity = 0.0f;
+
+		*flux = velocity*upwind;
+		return velocity;
+	}
+
+	// Four faces of FaceUpdate at once, in the same order of operations so the
+	// result matches the scalar path bit for bit.
+	inline __m128 FaceUpdate4(__m128 velocity, __m128 water0, __m128 bed0, __m128 water1, __m128 bed1,
+		__m128 gravityStep, __m128 damping, __m128 maxSpeed, __m128* flux)
+	{
+		const __m128 slope = _mm_sub_ps(_mm_add_ps(water1, bed1), _mm_add_ps(water0, bed0));
+		velocity = _mm_mul_ps(_mm_sub_ps(velocity, _mm_mul_ps(gravityStep, slope)), damping);
+		velocity = _mm_min_ps(_mm_max_ps(velocity, _mm_sub_ps(_mm_setzero_ps(), maxSpeed)), maxSpeed);
+
+		const __m128 forward = _mm_cmpgt_ps(velocity, _mm_setzero_ps());
+		const __m128 upwind = _mm_or_ps(_mm_and_ps(forward, water0), _mm_andnot_ps(forward, water1));
+		velocity = _mm_and_ps(velocity, _mm_cmpgt_ps(upwind, _mm_set1_ps(DryDepth)));
+
+		*flux = _mm_mul_ps(velocity, upwind);
+		return velocity;
+	}
+
+	// Updates the faces after the points of one row: the x faces inside the
+	// row, and the z faces to the next row unless this is the last one.
+	void FaceRow(float* velocityX, float* velocityZ, float* fluxX, float* fluxZ,
+		const float* water, const float* bed, const float* waterDown, const float* bedDown,
+		int n, float gravityStep, float damping, float maxSpeed)
+	{
+		const __m128 gravityStep4 = _mm_set1_ps(gravityStep);
+		const __m128 damping4 = _mm_set1_ps(damping);
+		const __m128 maxSpeed4 = _mm_set1_ps(maxSpeed);
+
+		// x faces [0, n-1); the one after the last point is a wall.
+		int j = 0;
+		for(; j + 4 <= n - 1; j += 4)
+		{
+			__m128 flux;
+			const __m128 velocity = FaceUpdate4(_mm_loadu_ps(velocityX + j),
+				_mm_loadu_ps(water + j), _mm_loadu_ps(bed + j),
+				_mm_loadu_ps(water + j + 1), _mm_loadu_ps(bed + j + 1),
+				gravityStep4, damping4, maxSpeed4, &flux);
+			_mm_storeu_ps(velocityX + j, velocity);
+			_mm_storeu_ps(fluxX + j, flux);
+		}
+		for(; j < n - 1; ++j)
+		{
+			velocityX[j] = FaceUpdate(velocityX[j], water[j], bed[j], water[j + 1], bed[j + 1],
+				gravityStep, damping, maxSpeed, &fluxX[j]);
+		}
+
+		if(waterDown == nullptr)
+			return;
+
+		j = 0;
+		for(; j + 4 <= n; j += 4)
+		{
+			__m128 flux;
+			const __m128 velocity = FaceUpdate4(_mm_loadu_ps(velocityZ + j),
+				_mm_loadu_ps(water + j), _mm_loadu_ps(bed + j),
+				_mm_loadu_ps(waterDown + j), _mm_loadu_ps(bedDown + j),
+				gravityStep4, damping4, maxSpeed4, &flux);
+			_mm_storeu_ps(velocityZ + j, velocity);
+			_mm_storeu_ps(fluxZ + j, flux);
+		}
+		for(; j < n; ++j)
+		{
+			velocityZ[j] = FaceUpdate(velocityZ[j], water[j], bed[j], waterDown[j], bedDown[j],
+				gravityStep, damping, maxSpeed, &fluxZ[j]);
+		}
+	}
+
+	// Moves the water of one row by the net flux through its four faces.
+	// fluxZUp holds the faces from the row above.  Returns whether any depth
+	// changed.
+	bool WaterRow(float* next, const float* water, const float* fluxX, const float* fluxZ,
+		const float* fluxZUp, int n, float scale)
+	{
+		auto update = [&](int j, float fluxLeft)
+		{
+			const float net = (fluxX[j] - fluxLeft) + (fluxZ[j] - fluxZUp[j]);
+			return std::max(water[j] - scale*net, 0.0f);
+		};
+
+		next[0] = update(0, 0.0f);
+		bool changed = next[0] != water[0];
+
+		const __m128 scale4 = _mm_set1_ps(scale);
+		__m128 diff = _mm_setzero_ps();
+		int j = 1;
+		for(; j + 4 <= n; j += 4)
+		{
+			const __m128 w = _mm_loadu_ps(water + j);
+			const __m128 net = _mm_add_ps(
+				_mm_sub_ps(_mm_loadu_ps(fluxX + j), _mm_loadu_ps(fluxX + j - 1)),
+				_mm_sub_ps(_mm_loadu_ps(fluxZ + j), _mm_loadu_ps(fluxZUp + j)));
+			const __m128 h = _mm_max_ps(_mm_sub_ps(w, _mm_mul_ps(scale4, net)), _mm_setzero_ps());
+			_mm_storeu_ps(next + j, h);
+			diff = _mm_or_ps(diff, _mm_cmpneq_ps(h, w));
+		}
+		for(; j < n; ++j)
+		{
+			next[j] = update(j, fluxX[j - 1]);
+			changed |= next[j] != water[j];
+		}
+
+		return changed || _mm_movemask_ps(diff) != 0;
+	}
+}
+
+ShallowWaterSolver::ShallowWaterSolver(int m, int n, float dx, float dt, float friction)
+{
+	mNumRows = m;
+	mNumCols = n;
+
+	mVertexCount = m*n;
+	mTriangleCount = (m - 1)*(n - 1) * 2;
+
+	mTimeStep = dt;
+	mSpatialStep = dx;
+
+	mGravityStep = Gravity*dt/dx;
+	mVelocityDamping = std::max(1.0f - friction*dt, 0.0f);
+	mMaxSpeed = 0.25f*dx/dt;
+
+	mHalfWidth = (n - 1)*dx*0.5f;
+	mHalfDepth = (m - 1)*dx*0.5f;
+
+	// Derive tex-coords from position by mapping [-w/2,w/2] --> [0,1].
+	mCoords.X.resize(n);
+	mCoords.U.resize(n);
+	for(int j = 0; j < n; ++j)
+	{
+		mCoords.X[j] = -mHalfWidth + j*dx;
+		mCoords.U[j] = 0.5f + mCoords.X[j] / Width();
+	}
+
+	mCoords.Z.resize(m);
+	mCoords.V.resize(m);
+	for(int i = 0; i < m; ++i)
+	{
+		mCoords.Z[i] = mHalfDepth - i*dx;
+		mCoords.V[i] = 0.5f - mCoords.Z[i] / Depth();
+	}
+
+	mTileCount = (m - 2 + WaveTileRows - 1) / WaveTileRows;
+	mTileVersion.assign(mTileCount, 1);
+	mTileChanged.assign(mTileCount, 0);
+
+	mBed.assign(m*n, 0.0f);
+	mWater.assign(m*n, 0.0f);
+	mNextWater.assign(m*n, 0.0f);
+	mVelocityX.assign(m*n, 0.0f);
+	mVelocityZ.assign(m*n, 0.0f);
+	mFluxX.assign(m*n, 0.0f);
+	mFluxZ.assign(m*n, 0.0f);
+}
+
+ShallowWaterSolver::~ShallowWaterSolver()
+{
+}
+
+int ShallowWaterSolver::RowCount()const
+{
+	return mNumRows;
+}
+
+int ShallowWaterSolver::ColumnCount()const
+{
+	return mNumCols;
+}
+
+int ShallowWaterSolver::VertexCount()const
+{
+	return mVertexCount;
+}
+
+int ShallowWaterSolver::TriangleCount()const
+{
+	return mTriangleCount;
+}
+
+float ShallowWaterSolver::Width()const
+{
+	return mNumCols*mSpatialStep;
+}
+
+float ShallowWaterSolver::Depth()const
+{
+	return mNumRows*mSpatialStep;
+}
+
+void ShallowWaterSolver::Flood(float level)
+{
+	for(int k = 0; k < mVertexCount; ++k)
+		mWater[k] = std::max(level - mBed[k], 0.0f);
+
+	std::fill(mVelocityX.begin(), mVelocityX.end(), 0.0f);
+	std::fill(mVelocityZ.begin(), mVelocityZ.end(), 0.0f);
+
+	MarkAllDirty();
+}
+
+XMFLOAT3 ShallowWaterSolver::Normal(int i)const
+{
+	const int row = i / mNumCols;
+	const int col = i % mNumCols;
+	const int n = mNumCols;
+
+	float l = Height(row*n + std::max(col - 1, 0));
+	float r = Height(row*n + std::min(col + 1, n - 1));
+	float t = Height(std::max(row - 1, 0)*n + col);
+	float b = Height(std::min(row + 1, mNumRows - 1)*n + col);
+
+	XMVECTOR normal = XMVectorSet(l - r, 2.0f*mSpatialStep, b - t, 0.0f);
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Normalize(normal));
+	return result;
+}
+
+XMFLOAT3 ShallowWaterSolver::TangentX(int i)const
+{
+	const int row = i / mNumCols;
+	const int col = i % mNumCols;
+	const int n = mNumCols;
+
+	float l = Height(row*n + std::max(col - 1, 0));
+	float r = Height(row*n + std::min(col + 1, n - 1));
+
+	XMVECTOR tangent = XMVectorSet(2.0f*mSpatialStep, r - l, 0.0f, 0.0f);
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Normalize(tangent));
+	return result;
+}
+
+int ShallowWaterSolver::Update(float dt)
+{
+	// Accumulate time.
+	mAccumulator += dt;
+
+	// Run as many fixed steps as the elapsed time covers, up to the cap.
+	int steps = 0;
+	while(mAccumulator >= mTimeStep && steps < mMaxSubsteps)
+	{
+		Step();
+		mAccumulator -= mTimeStep;
+		++steps;
+	}
+
+	// If we hit the cap, drop the time we could not simulate rather than
+	// carrying it over and falling further behind every frame.
+	if(mAccumulator >= mTimeStep)
+		mAccumulator = std::fmod(mAccumulator, mTimeStep);
+
+	return steps;
+}
+
+void ShallowWaterSolver::Step()
+{
+	const int n = mNumCols;
+
+	// Faces first.  Each row writes only the faces after its own points, so
+	// the row tiles are independent.
+	concurrency::parallel_for(0, mTileCount, [this, n](int tile)
+	{
+		int r0, r1;
+		TileRowRange(tile, r0, r1);
+
+		for(int i = r0; i < r1; ++i)
+		{
+			const bool last = i == mNumRows - 1;
+			FaceRow(&mVelocityX[i*n], &mVelocityZ[i*n], &mFluxX[i*n], &mFluxZ[i*n],
+				&mWater[i*n], &mBed[i*n],
+				last ? nullptr : &mWater[(i + 1)*n], last ? nullptr : &mBed[(i + 1)*n],
+				n, mGravityStep, mVelocityDamping, mMaxSpeed);
+		}
+	});
+
+	// Then the depths from the fluxes.  The z faces after the last row are a
+	// wall with zero flux, and stand in for the missing faces above row 0.
+	const float scale = mTimeStep / mSpatialStep;
+	concurrency::parallel_for(0, mTileCount, [this, n, scale](int tile)
+	{
+		int r0, r1;
+		TileRowRange(tile, r0, r1);
+
+		bool changed = false;
+		for(int i = r0; i < r1; ++i)
+		{
+			const float* fluxZUp = i == 0 ? &mFluxZ[(mNumRows - 1)*n] : &mFluxZ[(i - 1)*n];
+			changed |= WaterRow(&mNextWater[i*n], &mWater[i*n], &mFluxX[i*n], &mFluxZ[i*n],
+				fluxZUp, n, scale);
+		}
+
+		mTileChanged[tile] = changed;
+	});
+
+	std::swap(mWater, mNextWater);
+
+	// A tile's normals also read the rows next to it, so a change dirties
+	// the neighbouring tiles too.
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		const bool dirty = mTileChanged[tile] ||
+			(tile > 0 && mTileChanged[tile - 1]) ||
+			(tile < mTileCount - 1 && mTileChanged[tile + 1]);
+		if(dirty)
+			++mTileVersion[tile];
+	}
+}
+
+void ShallowWaterSolver::Disturb(int i, int j, float magnitude)
+{
+	assert(i > 0 && i < mNumRows-1);
+	assert(j > 0 && j < mNumCols-1);
+
+	auto add = [this](int k, float h) { mWater[k] = std::max(mWater[k] + h, 0.0f); };
+
+	// Pour onto the ijth vertex and its neighbors.
+	add(i*mNumCols+j,     magnitude);
+	add(i*mNumCols+j+1,   0.5f*magnitude);
+	add(i*mNumCols+j-1,   0.5f*magnitude);
+	add((i+1)*mNumCols+j, 0.5f*magnitude);
+	add((i-1)*mNumCols+j, 0.5f*magnitude);
+
+	// The normals of the rows around the touched ones change too.
+	TouchRows(i - 2, i + 3);
+}
+
+void ShallowWaterSolver::DisturbBatch(const WaveImpulse* impulses, int count)
+{
+	std::vector<float> rowWeights;
+	std::vector<float> colWeights;
+
+	for(int k = 0; k < count; ++k)
+	{
+		const WaveImpulse& impulse = impulses[k];
+
+		// Grid coordinates of the centre; rows run towards -z.
+		const float ci = (mHalfDepth - impulse.Z) / mSpatialStep;
+		const float cj = (impulse.X + mHalfWidth) / mSpatialStep;
+		const float r = std::max(impulse.Radius / mSpatialStep, 1.0f);
+		const float sigma = r / 3.0f;
+		const float invTwoSigmaSq = 1.0f / (2.0f*sigma*sigma);
+
+		const int i0 = std::max((int)std::ceil(ci - r), 0);
+		const int i1 = std::min((int)std::floor(ci + r) + 1, mNumRows);
+		const int j0 = std::max((int)std::ceil(cj - r), 0);
+		const int j1 = std::min((int)std::floor(cj + r) + 1, mNumCols);
+		if(i0 >= i1 || j0 >= j1)
+			continue;
+
+		// The Gaussian is separable: one weight per row times one per column.
+		rowWeights.resize(i1 - i0);
+		for(int i = i0; i < i1; ++i)
+			rowWeights[i - i0] = impulse.Magnitude * std::exp(-(i - ci)*(i - ci)*invTwoSigmaSq);
+
+		colWeights.resize(j1 - j0);
+		for(int j = j0; j < j1; ++j)
+			colWeights[j - j0] = std::exp(-(j - cj)*(j - cj)*invTwoSigmaSq);
+
+		for(int i = i0; i < i1; ++i)
+		{
+			float* water = &mWater[i*mNumCols];
+			for(int j = j0; j < j1; ++j)
+				water[j] = std::max(water[j] + rowWeights[i - i0]*colWeights[j - j0], 0.0f);
+		}
+
+		TouchRows(i0 - 1, i1 + 1);
+	}
+}
+
+void ShallowWaterSolver::GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const
+{
+	tileVersions.resize(mTileCount, 0);
+
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		if(tileVersions[tile] == mTileVersion[tile])
+			continue;
+		tileVersions[tile] = mTileVersion[tile];
+
+		int r0, r1;
+		TileRowRange(tile, r0, r1);
+
+		if(!rowRanges.empty() && rowRanges.back().second == r0)
+			rowRanges.back().second = r1;
+		else
+			rowRanges.push_back(std::make_pair(r0, r1));
+	}
+}
+
+std::uint64_t ShallowWaterSolver::RowsVersion(int firstRow, int lastRow)const
+{
+	// Versions only grow, so the sum changes whenever one of them does.
+	std::uint64_t sum = 0;
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		int r0, r1;
+		TileRowRange(tile, r0, r1);
+		if(r0 < lastRow && firstRow < r1)
+			sum += mTileVersion[tile];
+	}
+
+	return sum;
+}
+
+void ShallowWaterSolver::CaptureFrame(WavesFrame& frame)const
+{
+	frame.mNumRows = mNumRows;
+	frame.mNumCols = mNumCols;
+	frame.mSpatialStep = mSpatialStep;
+	frame.mHalfWidth = mHalfWidth;
+	frame.mHalfDepth = mHalfDepth;
+	if(frame.mCoords.X.empty())
+		frame.mCoords = mCoords;
+
+	// The shallow water keeps no WaveStats.
+	frame.mStats = WaveStats();
+
+	frame.mHeights.resize(mVertexCount);
+	frame.mNormals.resize(mVertexCount);
+
+	std::vector<std::pair<int, int>> rowRanges;
+	GetDirtyRows(frame.mTileVersions, rowRanges);
+
+	for(const auto& rows : rowRanges)
+	{
+		for(int i = rows.first; i < rows.second; ++i)
+			DrawnRow(i, 0, mNumCols, &frame.mHeights[i*mNumCols], &frame.mNormals[i*mNumCols]);
+	}
+}
+
+void ShallowWaterSolver::WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const
+{
+	WriteVertices(firstRow, lastRow, 0, mNumCols, vertices + firstRow*mNumCols);
+}
+
+void ShallowWaterSolver::WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const
+{
+	const int cols = lastCol - firstCol;
+	const bool aligned = (reinterpret_cast<std::uintptr_t>(vertices) & 15) == 0;
+	std::vector<float> heights(cols);
+	std::vector<XMFLOAT3> normals(cols);
+
+	for(int i = firstRow; i < lastRow; ++i)
+	{
+		DrawnRow(i, firstCol, lastCol, heights.data(), normals.data());
+
+		const float z = mCoords.Z[i];
+		const float v = mCoords.V[i];
+		WaveVertex* dst = vertices + (i - firstRow)*cols;
+
+		for(int k = 0; k < cols; ++k, ++dst)
+		{
+			const int j = firstCol + k;
+			StoreWaveVertex(dst, aligned, mCoords.X[j], heights[k], z, normals[k], mCoords.U[j], v);
+		}
+	}
+
+	_mm_sfence();
+}
+
+float ShallowWaterSolver::DrawnHeight(int i)const
+{
+	// Sink dry points by a fraction of a cell, enough to keep the water
+	// triangles on dry land under the terrain.
+	return mWater[i] > DryDepth ? mBed[i] + mWater[i] : mBed[i] - 0.25f*mSpatialStep;
+}
+
+void ShallowWaterSolver::DrawnRow(int i, int j0, int j1, float* heights, XMFLOAT3* normals)const
+{
+	const int n = mNumCols;
+	const float* up = &mWater[std::max(i - 1, 0)*n];
+	const float* upBed = &mBed[std::max(i - 1, 0)*n];
+	const float* down = &mWater[std::min(i + 1, mNumRows - 1)*n];
+	const float* downBed = &mBed[std::min(i + 1, mNumRows - 1)*n];
+	const float twoDx = 2.0f*mSpatialStep;
+
+	for(int j = j0; j < j1; ++j, ++heights, ++normals)
+	{
+		*heights = DrawnHeight(i*n + j);
+
+		// The normals follow the water surface, not the drawn heights.
+		const float l = Height(i*n + std::max(j - 1, 0));
+		const float r = Height(i*n + std::min(j + 1, n - 1));
+		const float t = up[j] + upBed[j];
+		const float b = down[j] + downBed[j];
+
+		const float nx = l - r;
+		const float nz = b - t;
+		const float invLen = 1.0f / sqrtf(nx*nx + twoDx*twoDx + nz*nz);
+		*normals = XMFLOAT3(nx*invLen, twoDx*invLen, nz*invLen);
+	}
+}
+
+void ShallowWaterSolver::TileRowRange(int tile, int& r0, int& r1)const
+{
+	// Same split as WaveSolver, with the boundary rows in the outer tiles.
+	r0 = tile == 0 ? 0 : 1 + tile*WaveTileRows;
+	r1 = tile == mTileCount - 1 ? mNumRows : 1 + (tile + 1)*WaveTileRows;
+}
+
+void ShallowWaterSolver::TouchRows(int r0, int r1)
+{
+	r0 = std::max(r0, 0);
+	r1 = std::min(r1, mNumRows);
+
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		int t0, t1;
+		TileRowRange(tile, t0, t1);
+		if(t0 < r1 && r0 < t1)
+			++mTileVersion[tile];
+	}
+}
+
+void ShallowWaterSolver::MarkAllDirty()
+{
+	for(std::uint64_t& version : mTileVersion)
+		++version;
+}
@@ -0,0 +1,164 @@
+//***************************************************************************************
+// ShallowWaterSolver.h
+//
+// Shallow-water alternative to WaveSolver for water that flows: it fills basins,
+// runs downhill and wets or dries the terrain under it.  Water depth lives at the
+// grid points and velocities on the faces between them (a staggered grid), over a
+// bed sampled from a terrain height function.  Each step updates the face
+// velocities from the surface slope, then moves water across the faces with
+// upwinded fluxes, so the total volume is conserved exactly.
+//
+// It produces the same outputs as WaveSolver (Position/Normal, dirty rows and
+// row versions, WavesFrame captures and WaveVertex rows or blocks), so the
+// water render item, WaveChunkGrid and WaveSolverThread work with it unchanged.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <DirectXMath.h>
+#include "WaveSolver.h"
+
+class ShallowWaterSolver
+{
+public:
+	// m x n grid points dx apart, advanced in fixed steps of dt.  Gravity waves
+	// run at sqrt(g*depth), so dt must stay below about dx / (2*sqrt(g*depth))
+	// for the deepest water.  friction is the fraction of velocity lost per
+	// second.  The grid starts dry on a flat bed at y = 0.
+	ShallowWaterSolver(int m, int n, float dx, float dt, float friction);
+	ShallowWaterSolver(const ShallowWaterSolver& rhs) = delete;
+	ShallowWaterSolver& operator=(const ShallowWaterSolver& rhs) = delete;
+	~ShallowWaterSolver();
+
+	int RowCount()const;
+	int ColumnCount()const;
+	int VertexCount()const;
+	int TriangleCount()const;
+	float Width()const;
+	float Depth()const;
+
+	// Samples the bed under every grid point from heightAt(x, z), e.g. the
+	// demos' GetHillsHeight.  The water depth is kept, so the surface moves
+	// with the bed.
+	template<class HeightFn>
+	void SetBathymetry(HeightFn heightAt)
+	{
+		for(int i = 0; i < mNumRows; ++i)
+			for(int j = 0; j < mNumCols; ++j)
+				mBed[i*mNumCols + j] = heightAt(mCoords.X[j], mCoords.Z[i]);
+
+		MarkAllDirty();
+	}
+
+	// Fills every point whose bed is below level with still water up to
+	// level, and drains the rest.
+	void Flood(float level);
+
+	// Returns the drawn surface at the ith grid point.  Dry points are sunk a
+	// little below the bed so the terrain hides them.
+	DirectX::XMFLOAT3 Position(int i)const
+	{
+		return DirectX::XMFLOAT3(
+			-mHalfWidth + (i % mNumCols)*mSpatialStep,
+			DrawnHeight(i),
+			mHalfDepth - (i / mNumCols)*mSpatialStep);
+	}
+
+	// Returns the water surface height (bed plus depth) at the ith grid point.
+	float Height(int i)const { return mBed[i] + mWater[i]; }
+
+	// Returns the water depth at the ith grid point; 0 where it is dry.
+	float WaterDepth(int i)const { return mWater[i]; }
+
+	// Returns the bed height at the ith grid point.
+	float BedHeight(int i)const { return mBed[i]; }
+
+	// Returns the surface normal at the ith grid point.
+	DirectX::XMFLOAT3 Normal(int i)const;
+
+	// Returns the unit tangent vector at the ith grid point in the local x-axis direction.
+	DirectX::XMFLOAT3 TangentX(int i)const;
+
+	// Upper bound on the fixed steps a single Update() may run.
+	void SetMaxSubsteps(int maxSubsteps) { mMaxSubsteps = maxSubsteps; }
+
+	// Advances the simulation by dt using fixed time steps; returns the number
+	// of steps taken.
+	int Update(float dt);
+
+	// Pours water onto the ijth grid point, half as much onto its neighbours.
+	// A negative magnitude takes water away, down to dry ground.
+	void Disturb(int i, int j, float magnitude);
+
+	// Pours a Gaussian mound of water per impulse, clipped to the grid.
+	void DisturbBatch(const WaveImpulse* impulses, int count);
+
+	// Same as WaveSolver::GetDirtyRows.  Tiles whose water did not move, such
+	// as dry land, stay clean.
+	void GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const;
+
+	// Same as WaveSolver::RowsVersion, so WaveChunkGrid can cull and upload
+	// the water chunk by chunk.
+	std::uint64_t RowsVersion(int firstRow, int lastRow)const;
+
+	// Same as WaveSolver::CaptureFrame.
+	void CaptureFrame(WavesFrame& frame)const;
+
+	// Same as WaveSolver::WriteVertices.
+	void WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const;
+	void WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const;
+
+private:
+	float DrawnHeight(int i)const;
+	void DrawnRow(int i, int j0, int j1, float* heights, DirectX::XMFLOAT3* normals)const;
+	void TileRowRange(int tile, int& r0, int& r1)const;
+	void TouchRows(int r0, int r1);
+	void MarkAllDirty();
+	void Step();
+
+	int mNumRows = 0;
+	int mNumCols = 0;
+
+	int mVertexCount = 0;
+	int mTriangleCount = 0;
+
+	float mTimeStep = 0.0f;
+	float mSpatialStep = 0.0f;
+
+	// g*dt/dx, the velocity change per unit of surface difference, and the
+	// velocity kept per step after friction.
+	float mGravityStep = 0.0f;
+	float mVelocityDamping = 0.0f;
+
+	// Faces carry at most a quarter of the upwind depth per step, so a point
+	// draining through all four faces never goes below zero.
+	float mMaxSpeed = 0.0f;
+
+	float mAccumulator = 0.0f;
+	int mMaxSubsteps = 8;
+
+	float mHalfWidth = 0.0f;
+	float mHalfDepth = 0.0f;
+	WaveGridCoords mCoords;
+
+	int mTileCount = 0;
+	std::vector<std::uint64_t> mTileVersion;
+	std::vector<std::uint8_t> mTileChanged;
+
+	// Per grid point: bed height and water depth (double buffered).
+	std::vector<float> mBed;
+	std::vector<float> mWater;
+	std::vector<float> mNextWater;
+
+	// Per face, stored with the point before it: VelocityX[i*n + j] is the
+	// face between points j and j+1 of row i, VelocityZ[i*n + j] the face
+	// between rows i and i+1.  The last column and row are walls and stay
+	// zero.  The fluxes are this step's volume per unit width through them.
+	std::vector<float> mVelocityX;
+	std::vector<float> mVelocityZ;
+	std::vector<float> mFluxX;
+	std::vector<float> mFluxZ;
+};
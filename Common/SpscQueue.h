@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread.  Push and Pop never block; they fail when the queue is full or
+// empty and leave the waiting policy to the caller.
+template<class T, std::size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+	SpscQueue() = default;
+	SpscQueue(const SpscQueue& rhs) = delete;
+	SpscQueue& operator=(const SpscQueue& rhs) = delete;
+
+	// Producer thread only.
+	bool Push(const T& item)
+	{
+		std::size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		mItems[tail & (Capacity - 1)] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Producer thread only.  Moves the item in, so large payloads such as
+	// vectors change hands without being copied.
+	bool Push(T&& item)
+	{
+		std::size_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mHead.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		mItems[tail & (Capacity - 1)] = std::move(item);
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only.
+	bool Pop(T& item)
+	{
+		std::size_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mTail.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(mItems[head & (Capacity - 1)]);
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Only a hint when called from the producer side.
+	bool Empty() const
+	{
+		return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+	}
+
+private:
+	T mItems[Capacity];
+
+	// Keep the two indices on separate cache lines so the threads do not
+	// invalidate each other's line on every operation.
+	alignas(64) std::atomic<std::size_t> mHead{ 0 };
+	alignas(64) std::atomic<std::size_t> mTail{ 0 };
+};
@@ -42,6 +42,12 @@ public:
 	{
 		memcpy(&mMappedData[elemIndex * mBufferSize], &data, sizeof T);
 	}
+	// Direct access to the mapped memory for writers that fill many elements at
+	// once.  Elements are only tightly packed when this is not a constant buffer.
+	T* MappedData()
+	{
+		return reinterpret_cast<T*>(mMappedData);
+	}
 	ID3D12Resource* Resource() 
 	{
 		return mUploadBuffer.Get();
@@ -0,0 +1,166 @@
+//***************************************************************************************
+// VertexPacking.cpp
+//***************************************************************************************
+
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	float SignNotZero(float x)
+	{
+		return x >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	std::uint16_t ToUnorm16(float x)
+	{
+		return (std::uint16_t)lroundf(std::min(std::max(x, 0.0f), 1.0f)*65535.0f);
+	}
+
+	std::int16_t ToSnorm16(float x)
+	{
+		return (std::int16_t)lroundf(std::min(std::max(x, -1.0f), 1.0f)*32767.0f);
+	}
+
+	float FromSnorm16(std::int16_t x)
+	{
+		// -32768 and -32767 both decode to -1, as in D3D.
+		return std::max(x/32767.0f, -1.0f);
+	}
+
+	void PackDirection(const XMFLOAT3& direction, std::int16_t packed[2])
+	{
+		XMFLOAT2 e = EncodeOctahedral(direction);
+		packed[0] = ToSnorm16(e.x);
+		packed[1] = ToSnorm16(e.y);
+	}
+
+	XMFLOAT3 UnpackDirection(const std::int16_t packed[2])
+	{
+		return DecodeOctahedral(XMFLOAT2(FromSnorm16(packed[0]), FromSnorm16(packed[1])));
+	}
+
+	// Angle between two directions in degrees; 0 if either is zero.  atan2 of
+	// the cross and dot products keeps small angles, which acos of a float
+	// cosine rounds to steps of about 0.02 degrees.
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR u = XMLoadFloat3(&a);
+		XMVECTOR v = XMLoadFloat3(&b);
+		if(XMVector3Equal(u, XMVectorZero()) || XMVector3Equal(v, XMVectorZero()))
+			return 0.0f;
+
+		float s = XMVectorGetX(XMVector3Length(XMVector3Cross(u, v)));
+		float c = XMVectorGetX(XMVector3Dot(u, v));
+		return XMConvertToDegrees(atan2f(s, c));
+	}
+}
+
+XMFLOAT2 EncodeOctahedral(const XMFLOAT3& direction)
+{
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower
+	// half over the upper half's diagonals.
+	float l1 = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if(l1 <= 0.0f)
+		return XMFLOAT2(0.0f, 0.0f);
+
+	float x = direction.x/l1;
+	float y = direction.y/l1;
+	if(direction.z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y))*SignNotZero(x);
+		float fy = (1.0f - fabsf(x))*SignNotZero(y);
+		x = fx;
+		y = fy;
+	}
+	return XMFLOAT2(x, y);
+}
+
+XMFLOAT3 DecodeOctahedral(const XMFLOAT2& encoded)
+{
+	float x = encoded.x;
+	float y = encoded.y;
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if(z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y))*SignNotZero(x);
+		float fy = (1.0f - fabsf(x))*SignNotZero(y);
+		x = fx;
+		y = fy;
+	}
+
+	XMFLOAT3 direction;
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+	return direction;
+}
+
+PackingReport PackMesh(const GeometryGenerator::MeshData& mesh, PackedMesh& packed)
+{
+	XMFLOAT3 lo(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(const auto& v : mesh.Vertices)
+	{
+		lo = XMFLOAT3(std::min(lo.x, v.Position.x), std::min(lo.y, v.Position.y), std::min(lo.z, v.Position.z));
+		hi = XMFLOAT3(std::max(hi.x, v.Position.x), std::max(hi.y, v.Position.y), std::max(hi.z, v.Position.z));
+	}
+	if(mesh.Vertices.empty())
+		lo = hi = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	packed.PositionOffset = lo;
+	packed.PositionScale = XMFLOAT3(hi.x - lo.x, hi.y - lo.y, hi.z - lo.z);
+
+	// A flat axis has no extent to divide by; every vertex sits at its offset.
+	auto normalized = [](float p, float offset, float scale)
+	{
+		return scale > 0.0f ? (p - offset)/scale : 0.0f;
+	};
+
+	packed.Vertices.resize(mesh.Vertices.size());
+	packed.Indices32 = mesh.Indices32;
+
+	PackingReport report;
+	for(std::size_t i = 0; i < mesh.Vertices.size(); ++i)
+	{
+		const GeometryGenerator::Vertex& v = mesh.Vertices[i];
+		PackedVertex& p = packed.Vertices[i];
+
+		p.Position[0] = ToUnorm16(normalized(v.Position.x, lo.x, packed.PositionScale.x));
+		p.Position[1] = ToUnorm16(normalized(v.Position.y, lo.y, packed.PositionScale.y));
+		p.Position[2] = ToUnorm16(normalized(v.Position.z, lo.z, packed.PositionScale.z));
+		p.Position[3] = 0;
+		PackDirection(v.Normal, p.Normal);
+		PackDirection(v.TangentU, p.TangentU);
+		p.TexC[0] = XMConvertFloatToHalf(v.TexC.x);
+		p.TexC[1] = XMConvertFloatToHalf(v.TexC.y);
+
+		const GeometryGenerator::Vertex u = UnpackVertex(packed, p);
+		report.MaxPositionError = std::max(report.MaxPositionError, XMVectorGetX(XMVector3Length(
+			XMLoadFloat3(&u.Position) - XMLoadFloat3(&v.Position))));
+		report.MaxNormalErrorDegrees = std::max(report.MaxNormalErrorDegrees, AngleDegrees(u.Normal, v.Normal));
+		report.MaxTangentErrorDegrees = std::max(report.MaxTangentErrorDegrees, AngleDegrees(u.TangentU, v.TangentU));
+		report.MaxTexCError = std::max(report.MaxTexCError,
+			std::max(fabsf(u.TexC.x - v.TexC.x), fabsf(u.TexC.y - v.TexC.y)));
+	}
+
+	report.VertexBytesBefore = mesh.Vertices.size()*sizeof(GeometryGenerator::Vertex);
+	report.VertexBytesAfter = packed.Vertices.size()*sizeof(PackedVertex);
+	return report;
+}
+
+GeometryGenerator::Vertex UnpackVertex(const PackedMesh& packed, const PackedVertex& vertex)
+{
+	GeometryGenerator::Vertex v;
+	v.Position = XMFLOAT3(
+		packed.PositionOffset.x + packed.PositionScale.x*(vertex.Position[0]/65535.0f),
+		packed.PositionOffset.y + packed.PositionScale.y*(vertex.Position[1]/65535.0f),
+		packed.PositionOffset.z + packed.PositionScale.z*(vertex.Position[2]/65535.0f));
+	v.Normal = UnpackDirection(vertex.Normal);
+	v.TangentU = UnpackDirection(vertex.TangentU);
+	v.TexC = XMFLOAT2(XMConvertHalfToFloat(vertex.TexC[0]), XMConvertHalfToFloat(vertex.TexC[1]));
+	return v;
+}
@@ -0,0 +1,63 @@
+//***************************************************************************************
+// VertexPacking.h
+//
+// Packs GeometryGenerator meshes into a 20 byte vertex, down from 44:
+//   Position  R16G16B16A16_UNORM  offset within the mesh bounds (w unused)
+//   Normal    R16G16_SNORM        octahedral encoding
+//   TangentU  R16G16_SNORM        octahedral encoding
+//   TexC      R16G16_FLOAT
+// A vertex shader decodes the position as PositionOffset + PositionScale*p.xyz and
+// the directions with DecodeOctahedral below.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include "GeometryGenerator.h"
+
+struct PackedVertex
+{
+	std::uint16_t Position[4];
+	std::int16_t Normal[2];
+	std::int16_t TangentU[2];
+	DirectX::PackedVector::HALF TexC[2];
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match its input layout.");
+
+struct PackedMesh
+{
+	std::vector<PackedVertex> Vertices;
+	std::vector<GeometryGenerator::uint32> Indices32;
+
+	// The mesh bounds' minimum corner and size; goes in the object constants.
+	DirectX::XMFLOAT3 PositionOffset = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 PositionScale = { 0.0f, 0.0f, 0.0f };
+};
+
+// The largest error packing introduced, and what it saved.
+struct PackingReport
+{
+	float MaxPositionError = 0.0f;         // in mesh units
+	float MaxNormalErrorDegrees = 0.0f;
+	float MaxTangentErrorDegrees = 0.0f;
+	float MaxTexCError = 0.0f;
+
+	std::size_t VertexBytesBefore = 0;
+	std::size_t VertexBytesAfter = 0;
+};
+
+// Octahedral encoding of a direction into [-1,1]^2 and back.  Zero vectors
+// decode as +z.
+DirectX::XMFLOAT2 EncodeOctahedral(const DirectX::XMFLOAT3& direction);
+DirectX::XMFLOAT3 DecodeOctahedral(const DirectX::XMFLOAT2& encoded);
+
+// Packs mesh into packed, measuring the error by decoding every vertex again.
+PackingReport PackMesh(const GeometryGenerator::MeshData& mesh, PackedMesh& packed);
+
+// Decodes one vertex the way the vertex shader does.
+GeometryGenerator::Vertex UnpackVertex(const PackedMesh& packed, const PackedVertex& vertex);
@@ -0,0 +1,60 @@
+//***************************************************************************************
+// WaveChunks.cpp
+//***************************************************************************************
+
+#include "WaveChunks.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace DirectX;
+
+WaveChunkGrid::WaveChunkGrid(int m, int n, float dx, float maxHeight, int chunkQuads)
+{
+	assert(chunkQuads > 0 && (chunkQuads + 1)*(chunkQuads + 1) <= 0x10000);
+
+	// Same placement as WaveSolver::Position.
+	const float halfWidth = (n - 1)*dx*0.5f;
+	const float halfDepth = (m - 1)*dx*0.5f;
+
+	for(int r0 = 0; r0 < m - 1; r0 += chunkQuads)
+	{
+		for(int c0 = 0; c0 < n - 1; c0 += chunkQuads)
+		{
+			WaveChunk chunk;
+			chunk.FirstRow = r0;
+			chunk.LastRow = std::min(r0 + chunkQuads, m - 1) + 1;
+			chunk.FirstCol = c0;
+			chunk.LastCol = std::min(c0 + chunkQuads, n - 1) + 1;
+
+			const int rows = chunk.LastRow - chunk.FirstRow;
+			const int cols = chunk.LastCol - chunk.FirstCol;
+
+			chunk.BaseVertex = mVertexCount;
+			chunk.StartIndex = (std::uint32_t)mIndices.size();
+			chunk.IndexCount = 6*(rows - 1)*(cols - 1);
+			mVertexCount += rows*cols;
+
+			mIndices.resize(chunk.StartIndex + chunk.IndexCount);
+			WriteGridIndices(rows, cols, WaveIndexOrder::Morton, &mIndices[chunk.StartIndex]);
+
+			const float x0 = -halfWidth + chunk.FirstCol*dx;
+			const float x1 = -halfWidth + (chunk.LastCol - 1)*dx;
+			const float z0 = halfDepth - (chunk.LastRow - 1)*dx;
+			const float z1 = halfDepth - chunk.FirstRow*dx;
+			chunk.Bounds.Center = XMFLOAT3(0.5f*(x0 + x1), 0.0f, 0.5f*(z0 + z1));
+			chunk.Bounds.Extents = XMFLOAT3(0.5f*(x1 - x0), maxHeight, 0.5f*(z1 - z0));
+
+			mChunks.push_back(chunk);
+		}
+	}
+}
+
+void WaveChunkGrid::Cull(const BoundingFrustum& frustum, std::vector<int>& visible)const
+{
+	visible.clear();
+	for(int c = 0; c < (int)mChunks.size(); ++c)
+	{
+		if(frustum.Intersects(mChunks[c].Bounds))
+			visible.push_back(c);
+	}
+}
@@ -0,0 +1,83 @@
+//***************************************************************************************
+// WaveChunks.h
+//
+// Splits a wave grid into square render chunks.  Every chunk has its own vertex
+// range and 16-bit indices, so the water can be any size, and its own bounding
+// box, so only the chunks in view are uploaded and drawn.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+#include "WaveSolver.h"
+
+// Grid vertex rows [FirstRow, LastRow) and columns [FirstCol, LastCol).
+// Neighbouring chunks share their edge row or column; each chunk has its own
+// copy of it in the chunked vertex buffer.
+struct WaveChunk
+{
+    int FirstRow = 0;
+    int LastRow = 0;
+    int FirstCol = 0;
+    int LastCol = 0;
+
+    // DrawIndexedInstanced parameters into the chunked buffers.  The
+    // indices count from BaseVertex, so they always fit in 16 bits.
+    int BaseVertex = 0;
+    std::uint32_t StartIndex = 0;
+    std::uint32_t IndexCount = 0;
+
+    // In the grid's local space, for heights within +-maxHeight.
+    DirectX::BoundingBox Bounds;
+};
+
+class WaveChunkGrid
+{
+public:
+	// Chunks of up to chunkQuads x chunkQuads quads of an m x n grid with
+	// spacing dx.  (chunkQuads + 1)^2 vertices must fit in 16-bit indices.
+	WaveChunkGrid(int m, int n, float dx, float maxHeight, int chunkQuads = 64);
+
+	int ChunkCount()const { return (int)mChunks.size(); }
+	const WaveChunk& Chunk(int c)const { return mChunks[c]; }
+
+	// Size of the chunked vertex buffer, and the chunks' indices.
+	int VertexCount()const { return mVertexCount; }
+	const std::vector<std::uint16_t>& Indices()const { return mIndices; }
+
+	// Replaces visible with the chunks that intersect frustum, which must be
+	// in the grid's local space.
+	void Cull(const DirectX::BoundingFrustum& frustum, std::vector<int>& visible)const;
+
+	// Writes the vertices of every visible chunk that changed since
+	// chunkVersions was last passed in, and brings chunkVersions up to date.
+	// Keep one chunkVersions per copy of the vertex buffer, e.g. per frame
+	// resource.  waves is a WavesFrame or a WaveSolver; with normals turned
+	// off, normals are only derived for the chunks written.
+	template<class Source>
+	void WriteVisibleVertices(const Source& waves, const std::vector<int>& visible,
+		std::vector<std::uint64_t>& chunkVersions, WaveVertex* vertices)const
+	{
+		// Versions start at 1, so a fresh consumer writes every chunk.
+		chunkVersions.resize(mChunks.size(), 0);
+
+		for(int c : visible)
+		{
+			const WaveChunk& chunk = mChunks[c];
+			const std::uint64_t version = waves.RowsVersion(chunk.FirstRow, chunk.LastRow);
+			if(chunkVersions[c] == version)
+				continue;
+
+			chunkVersions[c] = version;
+			waves.WriteVertices(chunk.FirstRow, chunk.LastRow, chunk.FirstCol, chunk.LastCol,
+				vertices + chunk.BaseVertex);
+		}
+	}
+
+private:
+	std::vector<WaveChunk> mChunks;
+	std::vector<std::uint16_t> mIndices;
+	int mVertexCount = 0;
+};
@@ -0,0 +1,124 @@
+//***************************************************************************************
+// WaveSnapshot.cpp
+//***************************************************************************************
+
+#include "WaveSnapshot.h"
+#include "DxException.h"
+#include <cassert>
+
+namespace
+{
+	void ThrowLastError()
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	void WriteAll(HANDLE file, const void* data, std::uint32_t bytes)
+	{
+		DWORD written = 0;
+		if(!WriteFile(file, data, bytes, &written, nullptr))
+			ThrowLastError();
+		if(written != bytes)
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_HANDLE_DISK_FULL));
+	}
+}
+
+WaveStreamWriter::WaveStreamWriter(const std::wstring& filename, const WaveStateHeader& header)
+	: mHeader(header)
+{
+	// Readers may map the stream while it is still being written.
+	mFile = CreateFileW(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(mFile == INVALID_HANDLE_VALUE)
+		ThrowLastError();
+
+	try
+	{
+		WriteAll(mFile, &mHeader, sizeof(mHeader));
+	}
+	catch(...)
+	{
+		CloseHandle(mFile);
+		throw;
+	}
+}
+
+WaveStreamWriter::~WaveStreamWriter()
+{
+	CloseHandle(mFile);
+}
+
+void WaveStreamWriter::AppendState(const void* state)
+{
+	WriteAll(mFile, state, mHeader.StateBytes);
+	++mStateCount;
+}
+
+WaveStreamReader::WaveStreamReader(const std::wstring& filename)
+{
+	// The destructor does not run if the constructor throws.
+	try
+	{
+		Open(filename);
+	}
+	catch(...)
+	{
+		Close();
+		throw;
+	}
+}
+
+WaveStreamReader::~WaveStreamReader()
+{
+	Close();
+}
+
+void WaveStreamReader::Open(const std::wstring& filename)
+{
+	mFile = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(mFile == INVALID_HANDLE_VALUE)
+		ThrowLastError();
+
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx(mFile, &fileSize))
+		ThrowLastError();
+
+	if(fileSize.QuadPart < (LONGLONG)sizeof(WaveStateHeader))
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+
+	// A zero size maps the whole file as it is now.
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mMapping == nullptr)
+		ThrowLastError();
+
+	mView = static_cast<const std::uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if(mView == nullptr)
+		ThrowLastError();
+
+	mHeader = reinterpret_cast<const WaveStateHeader*>(mView);
+	if(mHeader->Magic != WaveStateHeader::MagicValue ||
+	   mHeader->Version != WaveStateHeader::CurrentVersion ||
+	   mHeader->StateBytes == 0)
+	{
+		ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+	}
+
+	mStateCount = (int)((fileSize.QuadPart - sizeof(WaveStateHeader)) / mHeader->StateBytes);
+}
+
+void WaveStreamReader::Close()
+{
+	if(mView != nullptr)
+		UnmapViewOfFile(mView);
+	if(mMapping != nullptr)
+		CloseHandle(mMapping);
+	if(mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+}
+
+const void* WaveStreamReader::State(int i)const
+{
+	assert(i >= 0 && i < mStateCount);
+	return mView + sizeof(WaveStateHeader) + (std::size_t)i*mHeader->StateBytes;
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// WaveSnapshot.h
+//
+// Snapshot streams of WaveSolver states.  A stream is a WaveStateHeader followed
+// by any number of states of header.StateBytes each.  The writer appends states
+// as the simulation runs; the reader memory-maps a finished (or still growing)
+// stream, so any state can be restored or its heights read in place without
+// copying the file.
+//***************************************************************************************
+
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "WaveSolver.h"
+
+class WaveStreamWriter
+{
+public:
+	// Creates filename, replacing any existing file, and writes header.
+	WaveStreamWriter(const std::wstring& filename, const WaveStateHeader& header);
+	WaveStreamWriter(const WaveStreamWriter& rhs) = delete;
+	WaveStreamWriter& operator=(const WaveStreamWriter& rhs) = delete;
+	~WaveStreamWriter();
+
+	// Appends one state of Header().StateBytes bytes.  It goes straight to the
+	// file, so a reader opened afterwards sees it.
+	void AppendState(const void* state);
+
+	// Saves and appends the current state of waves, whose StateHeader() must
+	// match the stream's.
+	template<class Solver>
+	void Append(const Solver& waves)
+	{
+		mScratch.resize(mHeader.StateBytes);
+		waves.SaveState(mScratch.data());
+		AppendState(mScratch.data());
+	}
+
+	const WaveStateHeader& Header()const { return mHeader; }
+	int StateCount()const { return mStateCount; }
+
+private:
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	WaveStateHeader mHeader;
+	int mStateCount = 0;
+	std::vector<std::uint8_t> mScratch;
+};
+
+class WaveStreamReader
+{
+public:
+	// Maps the states present in filename when it is opened; states appended
+	// later need a new reader.  A partially written last state is ignored.
+	explicit WaveStreamReader(const std::wstring& filename);
+	WaveStreamReader(const WaveStreamReader& rhs) = delete;
+	WaveStreamReader& operator=(const WaveStreamReader& rhs) = delete;
+	~WaveStreamReader();
+
+	const WaveStateHeader& Header()const { return *mHeader; }
+	int StateCount()const { return mStateCount; }
+
+	// Points into the mapping and stays valid for the reader's lifetime.
+	// Pass it to WaveSolver::LoadState to resume from it.
+	const void* State(int i)const;
+
+	// The current heights of state i, read in place.  Scalar must match the
+	// configuration that wrote the stream.
+	template<class Scalar>
+	const Scalar* Heights(int i)const
+	{
+		return static_cast<const Scalar*>(State(i));
+	}
+
+private:
+	void Open(const std::wstring& filename);
+	void Close();
+
+private:
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+	const std::uint8_t* mView = nullptr;
+	const WaveStateHeader* mHeader = nullptr;
+	int mStateCount = 0;
+};
@@ -0,0 +1,1850 @@
+//***************************************************************************************
+// WaveSolver.cpp by Frank Luna (C) 2011 All Rights Reserved.
+//***************************************************************************************
+
+#include "WaveSolver.h"
+#include <ppl.h>
+#include <algorithm>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <intrin.h>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Rows of cells processed by one task of the fused update.  Inside a tile
+	// the normals lag the heights by one row, so only ~3 rows are hot at a time
+	// no matter how wide the grid is; the tile size just bounds the halo work.
+	const int TileRows = WaveTileRows;
+
+	// A block of t steps in Advance() keeps about t+2 rows of each of the
+	// three solutions hot.  This is the share of L2 it plans for, and a cap
+	// on the steps per block past which the halo work outgrows the saving.
+	const int BlockCacheBytes = 256*1024;
+	const int MaxBlockSteps = 16;
+
+	// MortonLayout bricks, and the ring of neighbouring cells a brick's
+	// stencil gathers around it.
+	const int BrickShift = MortonLayout::BrickShift;
+	const int BrickSize = MortonLayout::BrickSize;
+	const int BrickMask = MortonLayout::BrickMask;
+	const int BrickCells = BrickSize*BrickSize;
+	const int HaloPitch = BrickSize + 2;
+
+	// Reference kernel; also handles the columns left over by the SIMD kernels.
+	void StencilRowScalar(float* next, const float* prev, const float* curr, int rowPitch,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		for(int j = j0; j < j1; ++j)
+		{
+			next[j] = k1*prev[j] + k2*curr[j] +
+				k3*(curr[j+rowPitch] + curr[j-rowPitch] + curr[j+1] + curr[j-1]);
+		}
+	}
+
+	// 4 cells per instruction.  SSE2 is baseline on every target we build.
+	void StencilRowSSE(float* next, const float* prev, const float* curr, int rowPitch,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		__m128 K1 = _mm_set1_ps(k1);
+		__m128 K2 = _mm_set1_ps(k2);
+		__m128 K3 = _mm_set1_ps(k3);
+
+		int j = j0;
+		for(; j + 4 <= j1; j += 4)
+		{
+			__m128 sum = _mm_add_ps(_mm_loadu_ps(curr + j + rowPitch), _mm_loadu_ps(curr + j - rowPitch));
+			sum = _mm_add_ps(sum, _mm_loadu_ps(curr + j + 1));
+			sum = _mm_add_ps(sum, _mm_loadu_ps(curr + j - 1));
+
+			__m128 h = _mm_add_ps(
+				_mm_mul_ps(K1, _mm_loadu_ps(prev + j)),
+				_mm_mul_ps(K2, _mm_loadu_ps(curr + j)));
+			_mm_storeu_ps(next + j, _mm_add_ps(h, _mm_mul_ps(K3, sum)));
+		}
+
+		StencilRowScalar(next, prev, curr, rowPitch, j, j1, k1, k2, k3);
+	}
+
+	// 8 cells per instruction.  Only float arithmetic is needed, so plain AVX
+	// is enough; no FMA so results match the scalar kernel exactly.
+	void StencilRowAVX(float* next, const float* prev, const float* curr, int rowPitch,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		__m256 K1 = _mm256_set1_ps(k1);
+		__m256 K2 = _mm256_set1_ps(k2);
+		__m256 K3 = _mm256_set1_ps(k3);
+
+		int j = j0;
+		for(; j + 8 <= j1; j += 8)
+		{
+			__m256 sum = _mm256_add_ps(_mm256_loadu_ps(curr + j + rowPitch), _mm256_loadu_ps(curr + j - rowPitch));
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(curr + j + 1));
+			sum = _mm256_add_ps(sum, _mm256_loadu_ps(curr + j - 1));
+
+			__m256 h = _mm256_add_ps(
+				_mm256_mul_ps(K1, _mm256_loadu_ps(prev + j)),
+				_mm256_mul_ps(K2, _mm256_loadu_ps(curr + j)));
+			_mm256_storeu_ps(next + j, _mm256_add_ps(h, _mm256_mul_ps(K3, sum)));
+		}
+
+		StencilRowSSE(next, prev, curr, rowPitch, j, j1, k1, k2, k3);
+	}
+
+	// 16.16 fixed point.  The products and the sum are formed in 64 bits and
+	// rounded once, so the result does not depend on evaluation order.
+	void StencilRowFixed(std::int32_t* next, const std::int32_t* prev, const std::int32_t* curr, int rowPitch,
+		int j0, int j1, std::int32_t k1, std::int32_t k2, std::int32_t k3)
+	{
+		const int shift = WaveScalarTraits<std::int32_t>::FractionBits;
+		const std::int64_t half = std::int64_t(1) << (shift - 1);
+
+		for(int j = j0; j < j1; ++j)
+		{
+			std::int64_t sum = (std::int64_t)curr[j+rowPitch] + curr[j-rowPitch] + curr[j+1] + curr[j-1];
+			std::int64_t h = (std::int64_t)k1*prev[j] + (std::int64_t)k2*curr[j] + k3*sum;
+			next[j] = (std::int32_t)((h + half) >> shift);
+		}
+	}
+
+	// Half floats, widened to float for the arithmetic.  Same operation order
+	// as the float kernels; the conversions round to nearest even.
+	void StencilRowHalf(HALF* next, const HALF* prev, const HALF* curr, int rowPitch,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		for(int j = j0; j < j1; ++j)
+		{
+			float sum = XMConvertHalfToFloat(curr[j+rowPitch]) + XMConvertHalfToFloat(curr[j-rowPitch]);
+			sum += XMConvertHalfToFloat(curr[j+1]);
+			sum += XMConvertHalfToFloat(curr[j-1]);
+
+			float h = k1*XMConvertHalfToFloat(prev[j]) + k2*XMConvertHalfToFloat(curr[j]);
+			next[j] = XMConvertFloatToHalf(h + k3*sum);
+		}
+	}
+
+	// 8 cells per instruction, converted with F16C.
+	void StencilRowHalfF16C(HALF* next, const HALF* prev, const HALF* curr, int rowPitch,
+		int j0, int j1, float k1, float k2, float k3)
+	{
+		__m256 K1 = _mm256_set1_ps(k1);
+		__m256 K2 = _mm256_set1_ps(k2);
+		__m256 K3 = _mm256_set1_ps(k3);
+
+		auto load = [](const HALF* p) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); };
+
+		int j = j0;
+		for(; j + 8 <= j1; j += 8)
+		{
+			__m256 sum = _mm256_add_ps(load(curr + j + rowPitch), load(curr + j - rowPitch));
+			sum = _mm256_add_ps(sum, load(curr + j + 1));
+			sum = _mm256_add_ps(sum, load(curr + j - 1));
+
+			__m256 h = _mm256_add_ps(
+				_mm256_mul_ps(K1, load(prev + j)),
+				_mm256_mul_ps(K2, load(curr + j)));
+			h = _mm256_add_ps(h, _mm256_mul_ps(K3, sum));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(next + j), _mm256_cvtps_ph(h, _MM_FROUND_TO_NEAREST_INT));
+		}
+
+		StencilRowHalf(next, prev, curr, rowPitch, j, j1, k1, k2, k3);
+	}
+
+	bool CpuSupportsAVX()
+	{
+		int info[4];
+		__cpuid(info, 1);
+
+		// The OS must also save the upper halves of the ymm registers.
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+	}
+
+	bool CpuSupportsF16C()
+	{
+		int info[4];
+		__cpuid(info, 1);
+		return CpuSupportsAVX() && (info[2] & (1 << 29)) != 0;
+	}
+
+	// Widest stencil kernel the CPU supports for each height type.
+	auto PickStencilRow(float*) -> decltype(&StencilRowScalar)
+	{
+		return CpuSupportsAVX() ? StencilRowAVX : StencilRowSSE;
+	}
+
+	auto PickStencilRow(std::int32_t*) -> decltype(&StencilRowFixed)
+	{
+		return StencilRowFixed;
+	}
+
+	auto PickStencilRow(HALF*) -> decltype(&StencilRowHalf)
+	{
+		return CpuSupportsF16C() ? StencilRowHalfF16C : StencilRowHalf;
+	}
+
+	// Appends the rows of every tile whose version differs from the one in
+	// seenVersions, merging neighbouring tiles, and updates seenVersions.
+	// Versions start at 1, so a fresh consumer sees every tile as dirty.
+	void AppendDirtyRows(const std::vector<std::uint64_t>& tileVersions, int numRows,
+		std::vector<std::uint64_t>& seenVersions, std::vector<std::pair<int, int>>& rowRanges)
+	{
+		const int tileCount = (int)tileVersions.size();
+		seenVersions.resize(tileCount, 0);
+
+		for(int tile = 0; tile < tileCount; ++tile)
+		{
+			if(seenVersions[tile] == tileVersions[tile])
+				continue;
+			seenVersions[tile] = tileVersions[tile];
+
+			// The boundary rows are reported with the outer tiles, which are
+			// the ones that change them.
+			int r0 = tile == 0 ? 0 : 1 + tile*TileRows;
+			int r1 = tile == tileCount - 1 ? numRows : 1 + (tile + 1)*TileRows;
+
+			if(!rowRanges.empty() && rowRanges.back().second == r0)
+				rowRanges.back().second = r1;
+			else
+				rowRanges.push_back(std::make_pair(r0, r1));
+		}
+	}
+
+	// Sum of the versions of the tiles holding rows [firstRow, lastRow).
+	// Versions only grow, so the sum changes whenever one of them does.
+	std::uint64_t SumTileVersions(const std::vector<std::uint64_t>& tileVersions, int numRows, int firstRow, int lastRow)
+	{
+		const int tileCount = (int)tileVersions.size();
+		auto tileOf = [=](int i) { return std::min(std::max(i - 1, 0) / TileRows, tileCount - 1); };
+
+		std::uint64_t sum = 0;
+		for(int tile = tileOf(firstRow); tile <= tileOf(std::min(lastRow, numRows) - 1); ++tile)
+			sum += tileVersions[tile];
+		return sum;
+	}
+
+	// Spreads the low 16 bits of x over the even bits of a Morton code.
+	std::uint32_t SpreadBits(std::uint32_t x)
+	{
+		x &= 0x0000ffff;
+		x = (x | (x << 8)) & 0x00ff00ff;
+		x = (x | (x << 4)) & 0x0f0f0f0f;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+
+	// Gathers the even bits of a Morton code into the low 16 bits.
+	std::uint32_t CompactBits(std::uint32_t x)
+	{
+		x &= 0x55555555;
+		x = (x | (x >> 1)) & 0x33333333;
+		x = (x | (x >> 2)) & 0x0f0f0f0f;
+		x = (x | (x >> 4)) & 0x00ff00ff;
+		x = (x | (x >> 8)) & 0x0000ffff;
+		return x;
+	}
+
+	// Finite-difference normal, and x-tangent unless tangent is null, from the
+	// heights left, right, above and below a grid point.
+	inline void NormalFromHeights(float l, float r, float t, float b, float twoDx,
+		XMFLOAT3* normal, XMFLOAT3* tangent)
+	{
+		float nx = -r+l;
+		float nz = b-t;
+		float invLen = 1.0f / sqrtf(nx*nx + twoDx*twoDx + nz*nz);
+		*normal = XMFLOAT3(nx*invLen, twoDx*invLen, nz*invLen);
+
+		if(tangent)
+		{
+			float ty = r-l;
+			float invLenT = 1.0f / sqrtf(twoDx*twoDx + ty*ty);
+			*tangent = XMFLOAT3(twoDx*invLenT, ty*invLenT, 0.0f);
+		}
+	}
+
+	// Row i of a MortonLayout solution, indexed by column like a pointer to
+	// a row-major row.
+	template<class Scalar>
+	struct BrickRow
+	{
+		Scalar* Cells;              // the row's first cell in brick 0
+		const int* BrickOffsets;    // the bricks of the row's brick row
+
+		Scalar& operator[](int j)const { return Cells[BrickOffsets[j >> BrickShift] + (j & BrickMask)]; }
+	};
+
+	// Folds count cells into the running largest magnitude and sum of
+	// squares, in order, so a row split into pieces sums exactly like a
+	// whole one.
+	template<class Scalar>
+	void AccumulateActivity(const Scalar* cells, int count, float& activity, float& sumSq)
+	{
+		for(int j = 0; j < count; ++j)
+		{
+			const float h = WaveScalarTraits<Scalar>::ToFloat(cells[j]);
+			activity = std::max(activity, std::fabs(h));
+			sumSq += h*h;
+		}
+	}
+
+	// Largest height magnitude over the interior of one row; adds the sum of
+	// the squared heights to energy.
+	template<class Scalar>
+	float RowActivity(const Scalar* row, int n, float& energy)
+	{
+		float activity = 0.0f;
+		float sumSq = 0.0f;
+		AccumulateActivity(row + 1, n - 2, activity, sumSq);
+
+		energy += sumSq;
+		return activity;
+	}
+
+	// Normals, and x-tangents unless tangents is null, of columns [j0, j1)
+	// of row i of the grid, written from normals[0].  height(r, c) returns
+	// the height of grid point (r, c) as a float.  Edge cells take the
+	// normal of the cell they copy, or point straight up where the edges stay
+	// flat, just as the fused update leaves them.
+	template<class Heights>
+	void DeriveNormalsSpan(Heights height, int m, int n, float dx, const WaveEdgeSources& edges,
+		int i, int j0, int j1, XMFLOAT3* normals, XMFLOAT3* tangents)
+	{
+		const int r = i == 0 ? edges.Top : (i == m - 1 ? edges.Bottom : i);
+		for(int j = j0; j < j1; ++j)
+		{
+			const int c = j == 0 ? edges.Left : (j == n - 1 ? edges.Right : j);
+			XMFLOAT3* tangent = tangents ? &tangents[j - j0] : nullptr;
+
+			if(r < 0 || c < 0)
+			{
+				normals[j - j0] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				if(tangent)
+					*tangent = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				continue;
+			}
+
+			NormalFromHeights(height(r, c - 1), height(r, c + 1),
+				height(r - 1, c), height(r + 1, c), 2.0f*dx, &normals[j - j0], tangent);
+		}
+	}
+
+	// Writes the vertices of columns [j0, j1) of row i to dst.  heights and
+	// normals start at column j0.  The caller issues the
+	// _mm_sfence that makes the streamed writes visible before the GPU is
+	// told to read them.
+	template<class Scalar>
+	void EmitVertexSpan(const Scalar* heights, const XMFLOAT3* normals, const WaveGridCoords& coords,
+		int i, int j0, int j1, WaveVertex* dst)
+	{
+		const bool aligned = (reinterpret_cast<std::uintptr_t>(dst) & 15) == 0;
+		const float z = coords.Z[i];
+		const float v = coords.V[i];
+
+		for(int j = j0; j < j1; ++j, ++heights, ++normals, ++dst)
+		{
+			const float y = WaveScalarTraits<Scalar>::ToFloat(*heights);
+			StoreWaveVertex(dst, aligned, coords.X[j], y, z, *normals, coords.U[j], v);
+		}
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+WaveSolver<Scalar, Boundary, Layout>::WaveSolver(int m, int n, float dx, float dt, float speed, float damping)
+{
+    mNumRows = m;
+    mNumCols = n;
+
+    mVertexCount = m*n;
+    mTriangleCount = (m - 1)*(n - 1) * 2;
+
+    mSpatialStep = dx;
+    mSpeed = speed;
+    mDamping = damping;
+
+    // An unstable step would blow up within a few frames; take the largest
+    // stable one instead.
+    assert(dt > 0.0f);
+    mTimeStep = std::min(dt, MaxStableTimeStep());
+    SetCoefficients();
+
+    mHalfWidth = (n - 1)*dx*0.5f;
+    mHalfDepth = (m - 1)*dx*0.5f;
+
+    // Derive tex-coords from position by mapping [-w/2,w/2] --> [0,1].
+    mCoords.X.resize(n);
+    mCoords.U.resize(n);
+    for(int j = 0; j < n; ++j)
+    {
+        mCoords.X[j] = -mHalfWidth + j*dx;
+        mCoords.U[j] = 0.5f + mCoords.X[j] / Width();
+    }
+
+    mCoords.Z.resize(m);
+    mCoords.V.resize(m);
+    for(int i = 0; i < m; ++i)
+    {
+        mCoords.Z[i] = mHalfDepth - i*dx;
+        mCoords.V[i] = 0.5f - mCoords.Z[i] / Depth();
+    }
+
+    mStencilRow = PickStencilRow((Scalar*)nullptr);
+
+    const int rowBytes = n*(int)sizeof(Scalar);
+    mBlockSteps = std::max(1, std::min(BlockCacheBytes/(3*rowBytes) - 2, MaxBlockSteps));
+
+    // Bricks are numbered in Z-order over a square power-of-two grid of
+    // them, skipping the numbers that fall off the grid, so the storage
+    // stays dense.  The cells of partial bricks past the last row and
+    // column are padding.
+    int cells = m*n;
+    if(std::is_same<Layout, MortonLayout>::value)
+    {
+        const int brickRows = (m + BrickMask) >> BrickShift;
+        mBrickCols = (n + BrickMask) >> BrickShift;
+
+        std::vector<std::pair<std::uint32_t, int>> codes;
+        for(int bi = 0; bi < brickRows; ++bi)
+            for(int bj = 0; bj < mBrickCols; ++bj)
+                codes.push_back(std::make_pair((SpreadBits(bi) << 1) | SpreadBits(bj), bi*mBrickCols + bj));
+        std::sort(codes.begin(), codes.end());
+
+        mBrickOffset.resize(codes.size());
+        for(int rank = 0; rank < (int)codes.size(); ++rank)
+            mBrickOffset[codes[rank].second] = rank*BrickCells;
+
+        cells = (int)codes.size()*BrickCells;
+    }
+
+    // Flat water at rest; x/z of each grid point are derived in Position().
+    mPrevSolution.assign(cells, Scalar(0));
+    mCurrSolution.assign(cells, Scalar(0));
+    mNextSolution.assign(cells, Scalar(0));
+    if(Traits::StoresNormals)
+    {
+        mNormals.assign(m*n, XMFLOAT3(0.0f, 1.0f, 0.0f));
+        mTangentX.assign(m*n, XMFLOAT3(1.0f, 0.0f, 0.0f));
+    }
+
+    // Two halo rows per tile for the normals.  Under clamped and absorbing
+    // boundaries their boundary columns are never written, so they stay zero
+    // like the rest of the boundary.  Bricked tiles also pack the rows they
+    // derive normals from next to them.
+    mTileCount = (m - 2 + TileRows - 1) / TileRows;
+    if(Traits::StoresNormals)
+        mHaloRows.assign(TileHaloRows()*mTileCount*n, Scalar(0));
+
+    // Every tile starts awake and dirty.
+    mTileAwake.assign(mTileCount, 1);
+    mTileVersion.assign(mTileCount, 1);
+    mTileActivity.assign(mTileCount, FLT_MAX);
+    mTilePrevActivity.assign(mTileCount, FLT_MAX);
+    mTileEdgeActivity.assign(2*mTileCount, FLT_MAX);
+    mTileEnergy.assign(mTileCount, 0.0f);
+
+    if(std::is_same<Boundary, AbsorbingBoundary>::value)
+    {
+        // Damp 1 - D*t^2 per step, t falling from 1 next to the edge to 0 at
+        // the inner side of the sponge.
+        const int cells = AbsorbingBoundary::SpongeCells;
+        auto sponge = [cells](int edgeDistance)
+        {
+            float t = std::max(cells + 1 - edgeDistance, 0) / (float)cells;
+            return Traits::ToCoefficient(1.0f - AbsorbingBoundary::SpongeDamping()*t*t);
+        };
+
+        mSpongeRow.resize(m);
+        for(int i = 0; i < m; ++i)
+            mSpongeRow[i] = sponge(std::min(i, m - 1 - i));
+
+        mSpongeCol.resize(n);
+        for(int j = 0; j < n; ++j)
+            mSpongeCol[j] = sponge(std::min(j, n - 1 - j));
+    }
+}
+
+template<class Scalar, class Boundary, class Layout>
+WaveSolver<Scalar, Boundary, Layout>::~WaveSolver()
+{
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::RowCount()const
+{
+	return mNumRows;
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::ColumnCount()const
+{
+	return mNumCols;
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::VertexCount()const
+{
+	return mVertexCount;
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::TriangleCount()const
+{
+	return mTriangleCount;
+}
+
+template<class Scalar, class Boundary, class Layout>
+float WaveSolver<Scalar, Boundary, Layout>::Width()const
+{
+	return mNumCols*mSpatialStep;
+}
+
+template<class Scalar, class Boundary, class Layout>
+float WaveSolver<Scalar, Boundary, Layout>::Depth()const
+{
+	return mNumRows*mSpatialStep;
+}
+
+template<class Scalar, class Boundary, class Layout>
+float WaveSolver<Scalar, Boundary, Layout>::SpatialStep()const
+{
+	return mSpatialStep;
+}
+
+template<class Scalar, class Boundary, class Layout>
+float WaveSolver<Scalar, Boundary, Layout>::MaxStableTimeStep()const
+{
+	// With e = (speed*dt/dx)^2 and d = damping*dt + 2, a Fourier mode grows
+	// by g per step with g^2 - (k2 + k3*s)g - k1 = 0, s = 2(cos a + cos b).
+	// Both roots stay inside the unit circle iff |k2 + k3*s| <= 1 - k1 = 4/d
+	// for every s in [-4, 4], which the checkerboard mode s = -4 turns into
+	// |4 - 16e| <= 4, i.e. e <= 1/2.
+	const float StableFraction = 0.95f;
+	return StableFraction * mSpatialStep / (mSpeed * std::sqrt(2.0f));
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::SetTimeStep(float dt)
+{
+	// A zero step never advances the clock and a negative one runs the
+	// simulation backwards; both are caller bugs.  Release builds keep the
+	// current step.
+	assert(dt > 0.0f);
+	if(!(dt > 0.0f))
+		return;
+
+	dt = std::min(dt, MaxStableTimeStep());
+
+	// The solver stores no velocity, only the last two solutions: keep
+	// (curr - prev)/dt by moving prev.
+	const float ratio = dt / mTimeStep;
+	for(std::size_t k = 0; k < mCurrSolution.size(); ++k)
+	{
+		const float curr = Traits::ToFloat(mCurrSolution[k]);
+		const float prev = Traits::ToFloat(mPrevSolution[k]);
+		mPrevSolution[k] = Traits::FromFloat(curr - (curr - prev)*ratio);
+	}
+
+	// Time owed to the old step may be more than a whole new one; keep only
+	// the fraction, so InterpolationFraction() stays below 1.
+	mAccumulator = std::fmod(mAccumulator, dt);
+
+	mTimeStep = dt;
+	SetCoefficients();
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::SetCoefficients()
+{
+	const float dt = mTimeStep;
+	const float dx = mSpatialStep;
+
+	float d = mDamping*dt + 2.0f;
+	float e = (mSpeed*mSpeed)*(dt*dt) / (dx*dx);
+	mK1 = Traits::ToCoefficient((mDamping*dt - 2.0f) / d);
+	mK2 = Traits::ToCoefficient((4.0f - 8.0f*e) / d);
+	mK3 = Traits::ToCoefficient((2.0f*e) / d);
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::Update(float dt)
+{
+	// Accumulate time.
+	mAccumulator += dt;
+
+	// Run as many fixed steps as the elapsed time covers, up to the cap.
+	int steps = 0;
+	while(mAccumulator >= mTimeStep && steps < mMaxSubsteps)
+	{
+		Step();
+		mAccumulator -= mTimeStep;
+		++steps;
+	}
+
+	// If we hit the cap, drop the time we could not simulate rather than
+	// carrying it over and falling further behind every frame.
+	if(mAccumulator >= mTimeStep)
+		mAccumulator = std::fmod(mAccumulator, mTimeStep);
+
+	mStats.Steps = steps;
+	mStats.TimeStep = mTimeStep;
+	mStats.Courant = mSpeed*mTimeStep/mSpatialStep;
+
+	return steps;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::Step()
+{
+	// Only update interior points; the edges are handled by the boundary
+	// policy.  Heights and normals are computed in one pass over row tiles.
+	// Tiles write disjoint cells, so the result does not depend on scheduling.
+	concurrency::parallel_for(0, mTileCount, [this](int tile)
+	{
+		if(mTileAwake[tile])
+			UpdateTile(tile, Layout());
+	});
+
+	// Sleeping tiles are flat.  Summing the tiles in order keeps the
+	// telemetry deterministic.
+	float energy = 0.0f;
+	float maxAmplitude = 0.0f;
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		if(mTileAwake[tile])
+		{
+			energy += mTileEnergy[tile];
+			maxAmplitude = std::max(maxAmplitude, mTileActivity[tile]);
+		}
+	}
+	mStats.Energy = energy*mSpatialStep*mSpatialStep;
+	mStats.MaxAmplitude = maxAmplitude;
+
+	// The new solution becomes the current solution, the old current
+	// solution becomes the previous one and the old previous buffer is
+	// recycled for the next step.  Sleeping tiles are zero in all three
+	// buffers, so rotating them is exact.
+	std::swap(mPrevSolution, mCurrSolution);
+	std::swap(mCurrSolution, mNextSolution);
+
+	UpdateTileActivity();
+	UpdateEdges();
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::SetComputeNormals(bool enable)
+{
+	if(enable == mComputeNormals)
+		return;
+	mComputeNormals = enable;
+
+	// The stored normals went stale while they were off.
+	if(StoresNormals())
+		DeriveNormals();
+
+	// Frames captured without normals have to be refilled.
+	for(std::uint64_t& version : mTileVersion)
+		++version;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::Advance(int steps)
+{
+	if(steps <= 0)
+		return;
+
+	mStats.Steps = steps;
+	mStats.TimeStep = mTimeStep;
+	mStats.Courant = mSpeed*mTimeStep/mSpatialStep;
+
+	// A periodic edge row copies the far side of the grid, which no band
+	// sees, and a single step has nothing to block.
+	if(Boundary::Wraps || steps == 1)
+	{
+		for(int k = 0; k < steps; ++k)
+			Step();
+		return;
+	}
+
+	mSpareSolution.resize(mCurrSolution.size());
+
+	// Each band privately recomputes the rows its neighbours' dependencies
+	// reach, so the bands run in parallel without synchronizing per step.
+	concurrency::combinable<std::vector<Scalar>> scratch;
+
+	while(steps > 0)
+	{
+		const int blockSteps = std::min(steps, mBlockSteps);
+		steps -= blockSteps;
+
+		// Bands of at least 8 rows per step keep the recomputed halo rows
+		// below ~1/8 of the work.
+		const int bandTiles = (8*blockSteps + TileRows - 1) / TileRows;
+		const int bandCount = (mTileCount + bandTiles - 1) / bandTiles;
+
+		concurrency::parallel_for(0, bandCount, [&](int band)
+		{
+			AdvanceBand(band, bandTiles, blockSteps, scratch.local());
+		});
+
+		// The bands left the last two steps in the spare and next buffers.
+		// The old solutions are free to be overwritten next, and keep the
+		// zero edges the clamped grids rely on.
+		std::swap(mPrevSolution, mSpareSolution);
+		std::swap(mCurrSolution, mNextSolution);
+	}
+
+	// Only the final solution's normals are ever seen.
+	if(StoresNormals())
+		DeriveNormals();
+
+	float energy = 0.0f;
+	float maxAmplitude = 0.0f;
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		energy += mTileEnergy[tile];
+		maxAmplitude = std::max(maxAmplitude, mTileActivity[tile]);
+	}
+	mStats.Energy = energy*mSpatialStep*mSpatialStep;
+	mStats.MaxAmplitude = maxAmplitude;
+
+	UpdateTileActivity();
+	UpdateEdges();
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::AdvanceBand(int band, int bandTiles, int steps, std::vector<Scalar>& scratch)
+{
+	const int m = mNumRows;
+	const int n = mNumCols;
+	const int firstTile = band*bandTiles;
+	const int lastTile = std::min(firstTile + bandTiles, mTileCount);
+	const int r0 = 1 + firstTile*TileRows;
+	const int r1 = std::min(1 + lastTile*TileRows, m - 1);
+
+	// Step t depends on rows up to t away, so the band loads that much more
+	// on each side, or down to the grid edge.  Away from the edges step t is
+	// valid on [lo + t, hi - t), which has shrunk to the band by the last one.
+	const int lo = std::max(r0 - steps, 0);
+	const int hi = std::min(r1 + steps, m);
+	const int rows = hi - lo;
+	auto rowBegin = [=](int t) { return lo == 0 ? 1 : lo + t; };
+	auto rowEnd = [=](int t) { return hi == m ? m - 1 : hi - t; };
+
+	// Three rotating copies of the band.  Step t overwrites step t-3, which
+	// the wavefront below has always finished reading by then.
+	scratch.resize(3*rows*n);
+	auto level = [&](int t, int i) { return scratch.data() + (((t + 1) % 3)*rows + i - lo)*n; };
+
+	// Steps -1 and 0 are the previous and current solutions.  The edge cells
+	// are only written under reflective boundaries, so the third copy starts
+	// out with the current edges too.
+	CopyRowsOut(mPrevSolution, lo, hi, level(-1, lo));
+	CopyRowsOut(mCurrSolution, lo, hi, level(0, lo));
+	CopyRowsOut(mCurrSolution, lo, hi, level(1, lo));
+
+	int top, bottom, left, right;
+	EdgeSources(top, bottom, left, right, Boundary());
+
+	// Skewed wavefront: at each position, step t updates the row t-1 above
+	// step 1's, so row i+1 of step t-1 is always ready for row i of step t.
+	for(int p = rowBegin(1); p < rowEnd(1) + steps - 1; ++p)
+	{
+		for(int t = 1; t <= steps; ++t)
+		{
+			const int i = p - (t - 1);
+			if(i < rowBegin(t) || i >= rowEnd(t))
+				continue;
+
+			Scalar* row = level(t, i);
+			mStencilRow(row, level(t - 2, i), level(t - 1, i), n, 1, n - 1, mK1, mK2, mK3);
+			FinishRow(i, row, Boundary());
+
+			if(i == top && lo == 0)
+				std::copy_n(row, n, level(t, 0));
+			if(i == bottom && hi == m)
+				std::copy_n(row, n, level(t, m - 1));
+		}
+	}
+
+	// Hand the last two steps back, with the edge rows for the outer bands,
+	// and note the activity the sleep logic and telemetry expect from Step().
+	const int out0 = r0 == 1 ? 0 : r0;
+	const int out1 = r1 == m - 1 ? m : r1;
+	CopyRowsIn(level(steps - 1, out0), out0, out1, mSpareSolution);
+	CopyRowsIn(level(steps, out0), out0, out1, mNextSolution);
+
+	for(int tile = firstTile; tile < lastTile; ++tile)
+	{
+		const int tr0 = 1 + tile*TileRows;
+		const int tr1 = std::min(tr0 + TileRows, m - 1);
+
+		float activity = 0.0f;
+		float prevActivity = 0.0f;
+		float energy = 0.0f;
+		float prevEnergy = 0.0f;
+		for(int i = tr0; i < tr1; ++i)
+		{
+			const float rowActivity = RowActivity(level(steps, i), n, energy);
+			activity = std::max(activity, rowActivity);
+			prevActivity = std::max(prevActivity, RowActivity(level(steps - 1, i), n, prevEnergy));
+
+			if(i == tr0)
+				mTileEdgeActivity[2*tile] = rowActivity;
+			if(i == tr1 - 1)
+				mTileEdgeActivity[2*tile + 1] = rowActivity;
+		}
+
+		mTileAwake[tile] = 1;
+		mTilePrevActivity[tile] = prevActivity;
+		mTileActivity[tile] = activity;
+		mTileEnergy[tile] = energy;
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::DeriveNormals()
+{
+	concurrency::parallel_for(0, mNumRows, [this](int i)
+	{
+		DeriveNormalsRow(i, &mNormals[i*mNumCols], mComputeTangentX ? &mTangentX[i*mNumCols] : nullptr);
+	});
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::UpdateTileActivity()
+{
+	// Decide from this step's activity which tiles sleep and which wake.  A
+	// tile may only sleep if its neighbours are not pushing energy into it,
+	// and a sleeping tile wakes as soon as an awake neighbour's adjacent edge
+	// row rises above the threshold.  Periodic grids wrap the first and last
+	// tiles around to each other.
+	std::vector<int> toggle;
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		int aboveTile = tile > 0 ? tile - 1 : (Boundary::Wraps ? mTileCount - 1 : -1);
+		int belowTile = tile + 1 < mTileCount ? tile + 1 : (Boundary::Wraps ? 0 : -1);
+		float aboveEdge = aboveTile >= 0 && mTileAwake[aboveTile] ? mTileEdgeActivity[2*aboveTile + 1] : 0.0f;
+		float belowEdge = belowTile >= 0 && mTileAwake[belowTile] ? mTileEdgeActivity[2*belowTile] : 0.0f;
+		bool neighboursQuiet = aboveEdge < mSleepThreshold && belowEdge < mSleepThreshold;
+
+		if(mTileAwake[tile])
+		{
+			++mTileVersion[tile];
+
+			if(neighboursQuiet &&
+				mTileActivity[tile] < mSleepThreshold &&
+				mTilePrevActivity[tile] < mSleepThreshold)
+			{
+				toggle.push_back(tile);
+			}
+		}
+		else if(!neighboursQuiet)
+		{
+			toggle.push_back(tile);
+		}
+	}
+
+	for(int tile : toggle)
+	{
+		if(mTileAwake[tile])
+			SleepTile(tile);
+		else
+			WakeTile(tile);
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::SleepTile(int tile)
+{
+	const int r0 = 1 + tile*TileRows;
+	const int r1 = std::min(r0 + TileRows, mNumRows - 1);
+	const int first = r0*mNumCols;
+	const int last = r1*mNumCols;
+
+	// Snap the nearly flat tile to exactly flat so skipping it is exact.
+	for(int i = r0; i < r1; ++i)
+	{
+		ForEachRowSpan(i, 0, mNumCols, [this](int cell, int j0, int j1)
+		{
+			std::fill_n(mPrevSolution.begin() + cell, j1 - j0, Scalar(0));
+			std::fill_n(mCurrSolution.begin() + cell, j1 - j0, Scalar(0));
+			std::fill_n(mNextSolution.begin() + cell, j1 - j0, Scalar(0));
+		});
+	}
+	if(Traits::StoresNormals)
+	{
+		std::fill(mNormals.begin() + first, mNormals.begin() + last, XMFLOAT3(0.0f, 1.0f, 0.0f));
+		std::fill(mTangentX.begin() + first, mTangentX.begin() + last, XMFLOAT3(1.0f, 0.0f, 0.0f));
+	}
+
+	mTileAwake[tile] = 0;
+	mTileEnergy[tile] = 0.0f;
+	mTileEdgeActivity[2*tile] = 0.0f;
+	mTileEdgeActivity[2*tile + 1] = 0.0f;
+	++mTileVersion[tile];
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::WakeTile(int tile)
+{
+	// Require two quiet steps before the tile may sleep again.
+	mTileAwake[tile] = 1;
+	mTileActivity[tile] = FLT_MAX;
+	mTilePrevActivity[tile] = FLT_MAX;
+}
+
+template<class Scalar, class Boundary, class Layout>
+int WaveSolver<Scalar, Boundary, Layout>::SleepingTileCount()const
+{
+	return (int)std::count(mTileAwake.begin(), mTileAwake.end(), 0);
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const
+{
+	AppendDirtyRows(mTileVersion, mNumRows, tileVersions, rowRanges);
+}
+
+void WavesFrame::GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const
+{
+	AppendDirtyRows(mTileVersions, mNumRows, tileVersions, rowRanges);
+}
+
+template<class Scalar, class Boundary, class Layout>
+std::uint64_t WaveSolver<Scalar, Boundary, Layout>::RowsVersion(int firstRow, int lastRow)const
+{
+	return SumTileVersions(mTileVersion, mNumRows, firstRow, lastRow);
+}
+
+std::uint64_t WavesFrame::RowsVersion(int firstRow, int lastRow)const
+{
+	return SumTileVersions(mTileVersions, mNumRows, firstRow, lastRow);
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::CaptureFrame(WavesFrame& frame)const
+{
+	frame.mNumRows = mNumRows;
+	frame.mNumCols = mNumCols;
+	frame.mSpatialStep = mSpatialStep;
+	frame.mHalfWidth = mHalfWidth;
+	frame.mHalfDepth = mHalfDepth;
+	if(frame.mCoords.X.empty())
+		frame.mCoords = mCoords;
+
+	frame.mEdges = GetEdgeSources();
+	frame.mStats = mStats;
+
+	// Turning normals on again dirties every tile, so the frame catches up.
+	frame.mHeights.resize(mVertexCount);
+	frame.mNormals.resize(mComputeNormals ? mVertexCount : 0);
+
+	std::vector<std::pair<int, int>> rowRanges;
+	GetDirtyRows(frame.mTileVersions, rowRanges);
+
+	std::vector<Scalar> buffer;
+	for(const auto& rows : rowRanges)
+	{
+		const int first = rows.first*mNumCols;
+		const int last = rows.second*mNumCols;
+		for(int i = rows.first; i < rows.second; ++i)
+		{
+			const Scalar* row = RowCells(mCurrSolution, i, 0, mNumCols, buffer);
+			std::transform(row, row + mNumCols, frame.mHeights.begin() + i*mNumCols, Traits::ToFloat);
+		}
+
+		if(StoresNormals())
+		{
+			std::copy(mNormals.begin() + first, mNormals.begin() + last, frame.mNormals.begin() + first);
+		}
+		else if(mComputeNormals)
+		{
+			for(int i = rows.first; i < rows.second; ++i)
+				DeriveNormalsRow(i, &frame.mNormals[i*mNumCols], nullptr);
+		}
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+typename WaveSolver<Scalar, Boundary, Layout>::StateLayout WaveSolver<Scalar, Boundary, Layout>::GetStateLayout()const
+{
+	// Every section starts on a 16-byte boundary, so the heights can be
+	// read in place with SIMD loads.
+	auto align = [](std::size_t bytes) { return (bytes + 15) & ~std::size_t(15); };
+
+	StateLayout layout;
+	layout.Curr = 0;
+	layout.Prev = layout.Curr + align(mVertexCount*sizeof(Scalar));
+	layout.Awake = layout.Prev + align(mVertexCount*sizeof(Scalar));
+	layout.Activity = layout.Awake + align(mTileCount);
+	layout.Accumulator = layout.Activity + align(4*mTileCount*sizeof(float));
+	layout.Size = layout.Accumulator + align(sizeof(float));
+	return layout;
+}
+
+template<class Scalar, class Boundary, class Layout>
+WaveStateHeader WaveSolver<Scalar, Boundary, Layout>::StateHeader()const
+{
+	static_assert(sizeof(Coefficient) == sizeof(std::uint32_t), "Coefficients are saved as 32-bit patterns.");
+
+	WaveStateHeader header;
+	header.ScalarId = Traits::SnapshotId;
+	header.BoundaryId = Boundary::SnapshotId;
+	header.NumRows = mNumRows;
+	header.NumCols = mNumCols;
+	header.SpatialStep = mSpatialStep;
+	header.TimeStep = mTimeStep;
+	std::memcpy(&header.Coefficients[0], &mK1, sizeof(mK1));
+	std::memcpy(&header.Coefficients[1], &mK2, sizeof(mK2));
+	std::memcpy(&header.Coefficients[2], &mK3, sizeof(mK3));
+	header.TileCount = mTileCount;
+	header.StateBytes = (std::uint32_t)GetStateLayout().Size;
+	return header;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::SaveState(void* state)const
+{
+	const StateLayout layout = GetStateLayout();
+	std::uint8_t* dst = static_cast<std::uint8_t*>(state);
+	std::memset(dst, 0, layout.Size);
+
+	// The heights are saved row-major whatever the layout.
+	CopyRowsOut(mCurrSolution, 0, mNumRows, reinterpret_cast<Scalar*>(dst + layout.Curr));
+	CopyRowsOut(mPrevSolution, 0, mNumRows, reinterpret_cast<Scalar*>(dst + layout.Prev));
+	std::memcpy(dst + layout.Awake, mTileAwake.data(), mTileCount);
+
+	float* activity = reinterpret_cast<float*>(dst + layout.Activity);
+	std::copy(mTileActivity.begin(), mTileActivity.end(), activity);
+	std::copy(mTilePrevActivity.begin(), mTilePrevActivity.end(), activity + mTileCount);
+	std::copy(mTileEdgeActivity.begin(), mTileEdgeActivity.end(), activity + 2*mTileCount);
+
+	std::memcpy(dst + layout.Accumulator, &mAccumulator, sizeof(float));
+}
+
+template<class Scalar, class Boundary, class Layout>
+bool WaveSolver<Scalar, Boundary, Layout>::LoadState(const WaveStateHeader& header, const void* state)
+{
+	// Every field between the version and the reserved words must match.
+	const WaveStateHeader expected = StateHeader();
+	if(header.Magic != expected.Magic ||
+		header.Version != expected.Version ||
+		std::memcmp(&header.ScalarId, &expected.ScalarId, offsetof(WaveStateHeader, Reserved) - offsetof(WaveStateHeader, ScalarId)) != 0)
+	{
+		return false;
+	}
+
+	const StateLayout layout = GetStateLayout();
+	const std::uint8_t* src = static_cast<const std::uint8_t*>(state);
+
+	CopyRowsIn(reinterpret_cast<const Scalar*>(src + layout.Curr), 0, mNumRows, mCurrSolution);
+	CopyRowsIn(reinterpret_cast<const Scalar*>(src + layout.Prev), 0, mNumRows, mPrevSolution);
+	std::memcpy(mTileAwake.data(), src + layout.Awake, mTileCount);
+
+	const float* activity = reinterpret_cast<const float*>(src + layout.Activity);
+	std::copy(activity, activity + mTileCount, mTileActivity.begin());
+	std::copy(activity + mTileCount, activity + 2*mTileCount, mTilePrevActivity.begin());
+	std::copy(activity + 2*mTileCount, activity + 4*mTileCount, mTileEdgeActivity.begin());
+
+	std::memcpy(&mAccumulator, src + layout.Accumulator, sizeof(float));
+
+	// The next solution is overwritten before it is read, except where it
+	// must be zero: the clamped edges and the sleeping tiles.
+	std::fill(mNextSolution.begin(), mNextSolution.end(), Scalar(0));
+
+	if(StoresNormals())
+	{
+		DeriveNormals();
+	}
+
+	// Everything changed.
+	for(std::uint64_t& version : mTileVersion)
+		++version;
+
+	return true;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const
+{
+	WriteVertices(firstRow, lastRow, 0, mNumCols, vertices + firstRow*mNumCols);
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const
+{
+	const int n = mNumCols;
+	const int cols = lastCol - firstCol;
+	std::vector<Scalar> buffer;
+
+	if(StoresNormals())
+	{
+		for(int i = firstRow; i < lastRow; ++i, vertices += cols)
+		{
+			const Scalar* heights = RowCells(mCurrSolution, i, firstCol, lastCol, buffer);
+			EmitVertexSpan(heights, &mNormals[i*n + firstCol], mCoords, i, firstCol, lastCol, vertices);
+		}
+	}
+	else
+	{
+		const WaveEdgeSources edges = GetEdgeSources();
+		auto height = [this](int r, int c) { return CurrHeight(r, c); };
+		std::vector<XMFLOAT3> normals(cols);
+		for(int i = firstRow; i < lastRow; ++i, vertices += cols)
+		{
+			DeriveNormalsSpan(height, mNumRows, n, mSpatialStep, edges, i, firstCol, lastCol, normals.data(), nullptr);
+			const Scalar* heights = RowCells(mCurrSolution, i, firstCol, lastCol, buffer);
+			EmitVertexSpan(heights, normals.data(), mCoords, i, firstCol, lastCol, vertices);
+		}
+	}
+
+	_mm_sfence();
+}
+
+void WavesFrame::WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const
+{
+	WriteVertices(firstRow, lastRow, 0, mNumCols, vertices + firstRow*mNumCols);
+}
+
+void WavesFrame::WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const
+{
+	const int n = mNumCols;
+	const int cols = lastCol - firstCol;
+
+	if(!mNormals.empty())
+	{
+		for(int i = firstRow; i < lastRow; ++i, vertices += cols)
+			EmitVertexSpan(&mHeights[i*n + firstCol], &mNormals[i*n + firstCol], mCoords, i, firstCol, lastCol, vertices);
+	}
+	else
+	{
+		auto height = [this, n](int r, int c) { return mHeights[r*n + c]; };
+		std::vector<XMFLOAT3> normals(cols);
+		for(int i = firstRow; i < lastRow; ++i, vertices += cols)
+		{
+			DeriveNormalsSpan(height, mNumRows, n, mSpatialStep, mEdges, i, firstCol, lastCol, normals.data(), nullptr);
+			EmitVertexSpan(&mHeights[i*n + firstCol], normals.data(), mCoords, i, firstCol, lastCol, vertices);
+		}
+	}
+
+	_mm_sfence();
+}
+
+XMFLOAT3 WavesFrame::Normal(int i)const
+{
+	if(!mNormals.empty())
+		return mNormals[i];
+
+	const int n = mNumCols;
+	XMFLOAT3 normal;
+	DeriveNormalsSpan([this, n](int r, int c) { return mHeights[r*n + c]; }, mNumRows, mNumCols, mSpatialStep, mEdges,
+		i / mNumCols, i % mNumCols, i % mNumCols + 1, &normal, nullptr);
+	return normal;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::UpdateTile(int tile, RowMajorLayout)
+{
+	const int n = mNumCols;
+	const int r0 = 1 + tile*TileRows;
+	const int r1 = std::min(r0 + TileRows, mNumRows - 1);
+
+	const Scalar* prev = mPrevSolution.data();
+	const Scalar* curr = mCurrSolution.data();
+	Scalar* next = mNextSolution.data();
+
+	// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+	// Moreover, our +z axis goes "down"; this is just to
+	// keep consistent with our row indices going down.
+
+	// The normals of the first and last rows of the tile need the new heights
+	// of the rows just outside it, which belong to the neighbouring tiles.
+	// Recompute those halo rows privately instead of waiting for the
+	// neighbours; the boundary rows come from the boundary policy.
+	// Without stored normals the tile only needs its own heights.
+	if(!StoresNormals())
+	{
+		float activity = 0.0f;
+		float energy = 0.0f;
+		for(int i = r0; i < r1; ++i)
+		{
+			mStencilRow(next + i*n, prev + i*n, curr + i*n, n, 1, n - 1, mK1, mK2, mK3);
+			FinishRow(i, next + i*n, Boundary());
+
+			const float rowActivity = RowActivity(next + i*n, n, energy);
+			activity = std::max(activity, rowActivity);
+
+			if(i == r0)
+				mTileEdgeActivity[2*tile] = rowActivity;
+			if(i == r1 - 1)
+				mTileEdgeActivity[2*tile + 1] = rowActivity;
+		}
+
+		mTilePrevActivity[tile] = mTileActivity[tile];
+		mTileActivity[tile] = activity;
+		mTileEnergy[tile] = energy;
+		return;
+	}
+
+	Scalar* haloTop = &mHaloRows[2*tile*n];
+	Scalar* haloBottom = haloTop + n;
+
+	const Scalar* above = nullptr;
+	if(r0 - 1 > 0)
+	{
+		mStencilRow(haloTop, prev + (r0 - 1)*n, curr + (r0 - 1)*n, n, 1, n - 1, mK1, mK2, mK3);
+		FinishRow(r0 - 1, haloTop, Boundary());
+		above = haloTop;
+	}
+	else
+	{
+		above = EdgeRow(0, haloTop, Boundary());
+	}
+
+	const Scalar* below = nullptr;
+	if(r1 < mNumRows - 1)
+	{
+		mStencilRow(haloBottom, prev + r1*n, curr + r1*n, n, 1, n - 1, mK1, mK2, mK3);
+		FinishRow(r1, haloBottom, Boundary());
+		below = haloBottom;
+	}
+	else
+	{
+		below = EdgeRow(mNumRows - 1, haloBottom, Boundary());
+	}
+
+	// Largest height magnitude of the new solution, over the tile and over
+	// its first and last rows, and the tile's energy.
+	float activity = 0.0f;
+	float energy = 0.0f;
+
+	for(int i = r0; i < r1; ++i)
+	{
+		mStencilRow(next + i*n, prev + i*n, curr + i*n, n, 1, n - 1, mK1, mK2, mK3);
+		FinishRow(i, next + i*n, Boundary());
+
+		const float rowActivity = RowActivity(next + i*n, n, energy);
+		activity = std::max(activity, rowActivity);
+
+		if(i == r0)
+			mTileEdgeActivity[2*tile] = rowActivity;
+		if(i == r1 - 1)
+			mTileEdgeActivity[2*tile + 1] = rowActivity;
+
+		// Row i-1 now has both neighbours, derive its normals while the
+		// three rows are still in cache.
+		if(i > r0)
+		{
+			ComputeNormalsRow(i - 1 == r0 ? above : next + (i - 2)*n, next + (i - 1)*n, next + i*n,
+				&mNormals[(i - 1)*n], mComputeTangentX ? &mTangentX[(i - 1)*n] : nullptr);
+		}
+	}
+
+	ComputeNormalsRow(r1 - 1 == r0 ? above : next + (r1 - 2)*n, next + (r1 - 1)*n, below,
+		&mNormals[(r1 - 1)*n], mComputeTangentX ? &mTangentX[(r1 - 1)*n] : nullptr);
+
+	mTilePrevActivity[tile] = mTileActivity[tile];
+	mTileActivity[tile] = activity;
+	mTileEnergy[tile] = energy;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::UpdateTile(int tile, MortonLayout)
+{
+	const int n = mNumCols;
+	const int r0 = 1 + tile*TileRows;
+	const int r1 = std::min(r0 + TileRows, mNumRows - 1);
+
+	const Scalar* prev = mPrevSolution.data();
+	const Scalar* curr = mCurrSolution.data();
+	Scalar* next = mNextSolution.data();
+
+	// Current heights of columns [-1, BrickSize] of brick column bj in row i,
+	// i.e. a brick row and the cells either side of it, which live in the
+	// neighbouring bricks.  Cells off the grid read as zero; the stencil
+	// never uses them.
+	auto gather = [&](int i, int bj, Scalar* dst)
+	{
+		const int* bricks = &mBrickOffset[(i >> BrickShift)*mBrickCols];
+		const Scalar* cells = curr + ((i & BrickMask) << BrickShift);
+		dst[0] = bj > 0 ? cells[bricks[bj - 1] + BrickMask] : Scalar(0);
+		std::copy_n(cells + bricks[bj], BrickSize, dst + 1);
+		dst[BrickSize + 1] = bj + 1 < mBrickCols ? cells[bricks[bj + 1]] : Scalar(0);
+	};
+
+	// The heights, brick by brick.  The stencil reads the current heights
+	// from a halo block gathered around the brick, and the previous and new
+	// heights in place, a brick row at a time.
+	Scalar halo[HaloPitch*HaloPitch];
+	for(int bi = r0 >> BrickShift; bi <= (r1 - 1) >> BrickShift; ++bi)
+	{
+		const int i0 = std::max(r0, bi << BrickShift);
+		const int i1 = std::min(r1, (bi + 1) << BrickShift);
+		const int* bricks = &mBrickOffset[bi*mBrickCols];
+
+		for(int bj = 0; bj < mBrickCols; ++bj)
+		{
+			// Interior columns of the brick, counted from its first column.
+			const int c0 = bj << BrickShift;
+			const int j0 = std::max(1 - c0, 0);
+			const int j1 = std::min(n - 1 - c0, BrickSize);
+
+			for(int i = i0 - 1; i <= i1; ++i)
+				gather(i, bj, halo + (i - i0 + 1)*HaloPitch);
+
+			for(int i = i0; i < i1; ++i)
+			{
+				const int cell = bricks[bj] + ((i & BrickMask) << BrickShift);
+				mStencilRow(next + cell, prev + cell, halo + (i - i0 + 1)*HaloPitch + 1, HaloPitch,
+					j0, j1, mK1, mK2, mK3);
+			}
+		}
+	}
+
+	// Largest height magnitude of the new solution, over the tile and over
+	// its first and last rows, and the tile's energy, summed in the same
+	// order as the row-major update.
+	float activity = 0.0f;
+	float energy = 0.0f;
+
+	for(int i = r0; i < r1; ++i)
+	{
+		const BrickRow<Scalar> row = { next + ((i & BrickMask) << BrickShift), &mBrickOffset[(i >> BrickShift)*mBrickCols] };
+		FinishRow(i, row, Boundary());
+
+		float rowActivity = 0.0f;
+		float sumSq = 0.0f;
+		ForEachRowSpan(i, 1, n - 1, [&](int cell, int j0, int j1)
+		{
+			AccumulateActivity(next + cell, j1 - j0, rowActivity, sumSq);
+		});
+		energy += sumSq;
+		activity = std::max(activity, rowActivity);
+
+		if(i == r0)
+			mTileEdgeActivity[2*tile] = rowActivity;
+		if(i == r1 - 1)
+			mTileEdgeActivity[2*tile + 1] = rowActivity;
+	}
+
+	mTilePrevActivity[tile] = mTileActivity[tile];
+	mTileActivity[tile] = activity;
+	mTileEnergy[tile] = energy;
+
+	if(!StoresNormals())
+		return;
+
+	// The normals are stored row-major, so they are derived from packed
+	// copies of the new rows, three at a time.  The rows just outside the
+	// tile are recomputed privately, as the row-major update does, using the
+	// packed rows' room to gather the rows the stencil reads.
+	Scalar* above = &mHaloRows[TileHaloRows()*tile*n];
+	Scalar* below = above + n;
+	Scalar* rows = below + n;
+	HaloRow(r0 - 1, rows, above);
+	HaloRow(r1, rows, below);
+
+	auto packed = [rows, n](int i) { return rows + (i % 3)*n; };
+	CopyRowsOut(mNextSolution, r0, r0 + 1, packed(r0));
+	for(int i = r0; i < r1; ++i)
+	{
+		if(i + 1 < r1)
+			CopyRowsOut(mNextSolution, i + 1, i + 2, packed(i + 1));
+
+		ComputeNormalsRow(i == r0 ? above : packed(i - 1), packed(i), i + 1 == r1 ? below : packed(i + 1),
+			&mNormals[i*n], mComputeTangentX ? &mTangentX[i*n] : nullptr);
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::HaloRow(int i, Scalar* gather, Scalar* row)
+{
+	// An edge row will be a copy of an interior row, or stay flat; either
+	// way its new heights are computed here exactly as the tile owning the
+	// row computes them.  gather has room for the four rows the stencil
+	// reads.
+	const WaveEdgeSources edges = GetEdgeSources();
+	const int source = i == 0 ? edges.Top : (i == mNumRows - 1 ? edges.Bottom : i);
+	if(source < 0)
+	{
+		std::fill_n(row, mNumCols, Scalar(0));
+		return;
+	}
+
+	const int n = mNumCols;
+	CopyRowsOut(mPrevSolution, source, source + 1, gather);
+	CopyRowsOut(mCurrSolution, source - 1, source + 2, gather + n);
+	mStencilRow(row, gather, gather + 2*n, n, 1, n - 1, mK1, mK2, mK3);
+	FinishRow(source, row, Boundary());
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::ComputeNormalsRow(const Scalar* up, const Scalar* row, const Scalar* down,
+	XMFLOAT3* normals, XMFLOAT3* tangents)const
+{
+	//
+	// Compute normals using finite difference scheme.  Tangents are skipped
+	// when tangents is null.
+	//
+	const float twoDx = 2.0f*mSpatialStep;
+
+	for(int j = 1; j < mNumCols-1; ++j)
+	{
+		NormalFromHeights(Traits::ToFloat(row[j-1]), Traits::ToFloat(row[j+1]),
+			Traits::ToFloat(up[j]), Traits::ToFloat(down[j]), twoDx,
+			&normals[j], tangents ? &tangents[j] : nullptr);
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+template<class Row>
+void WaveSolver<Scalar, Boundary, Layout>::FinishRow(int, Row row, ReflectiveBoundary)
+{
+	row[0] = row[1];
+	row[mNumCols - 1] = row[mNumCols - 2];
+}
+
+template<class Scalar, class Boundary, class Layout>
+template<class Row>
+void WaveSolver<Scalar, Boundary, Layout>::FinishRow(int i, Row row, AbsorbingBoundary)
+{
+	const Coefficient one = Traits::ToCoefficient(1.0f);
+	const int n = mNumCols;
+
+	// Rows inside the sponge are damped across; the others only in the
+	// column bands at either end.
+	if(mSpongeRow[i] != one)
+	{
+		for(int j = 1; j < n - 1; ++j)
+			row[j] = Traits::Scale(row[j], std::min(mSpongeRow[i], mSpongeCol[j]));
+		return;
+	}
+
+	const int leftEnd = std::min(1 + AbsorbingBoundary::SpongeCells, n - 1);
+	const int rightBegin = std::max(n - 1 - AbsorbingBoundary::SpongeCells, leftEnd);
+	for(int j = 1; j < leftEnd; ++j)
+		row[j] = Traits::Scale(row[j], mSpongeCol[j]);
+	for(int j = rightBegin; j < n - 1; ++j)
+		row[j] = Traits::Scale(row[j], mSpongeCol[j]);
+}
+
+template<class Scalar, class Boundary, class Layout>
+template<class Row>
+void WaveSolver<Scalar, Boundary, Layout>::FinishRow(int, Row row, PeriodicBoundary)
+{
+	row[0] = row[mNumCols - 2];
+	row[mNumCols - 1] = row[1];
+}
+
+template<class Scalar, class Boundary, class Layout>
+const Scalar* WaveSolver<Scalar, Boundary, Layout>::EdgeRow(int i, Scalar*, ReflectiveBoundary)
+{
+	// The edge row will be a copy of the row inside it, which the tile
+	// computes itself.
+	const int inner = i == 0 ? 1 : mNumRows - 2;
+	return mNextSolution.data() + inner*mNumCols;
+}
+
+template<class Scalar, class Boundary, class Layout>
+const Scalar* WaveSolver<Scalar, Boundary, Layout>::EdgeRow(int i, Scalar* halo, PeriodicBoundary)
+{
+	// The edge row will be a copy of the opposite interior row, which
+	// belongs to the tile at the other end of the grid.
+	const int n = mNumCols;
+	const int opposite = i == 0 ? mNumRows - 2 : 1;
+	mStencilRow(halo, mPrevSolution.data() + opposite*n, mCurrSolution.data() + opposite*n, n, 1, n - 1, mK1, mK2, mK3);
+	FinishRow(opposite, halo, PeriodicBoundary());
+	return halo;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::EdgeSources(int& top, int& bottom, int& left, int& right, ReflectiveBoundary)const
+{
+	top = 1;
+	bottom = mNumRows - 2;
+	left = 1;
+	right = mNumCols - 2;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::EdgeSources(int& top, int& bottom, int& left, int& right, PeriodicBoundary)const
+{
+	top = mNumRows - 2;
+	bottom = 1;
+	left = mNumCols - 2;
+	right = 1;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::UpdateEdges()
+{
+	int top, bottom, left, right;
+	EdgeSources(top, bottom, left, right, Boundary());
+	if(top < 0)
+		return;
+
+	const int m = mNumRows;
+	const int n = mNumCols;
+
+	for(int i = 1; i < m - 1; ++i)
+	{
+		mCurrSolution[Cell(i, 0)] = mCurrSolution[Cell(i, left)];
+		mCurrSolution[Cell(i, n - 1)] = mCurrSolution[Cell(i, right)];
+	}
+
+	// Whole rows, so the corners come along.
+	for(int j = 0; j < n; ++j)
+	{
+		mCurrSolution[Cell(0, j)] = mCurrSolution[Cell(top, j)];
+		mCurrSolution[Cell(m - 1, j)] = mCurrSolution[Cell(bottom, j)];
+	}
+
+	if(StoresNormals())
+	{
+		for(int i = 1; i < m - 1; ++i)
+		{
+			const int k = i*n;
+			mNormals[k] = mNormals[k + left];
+			mNormals[k + n - 1] = mNormals[k + right];
+			mTangentX[k] = mTangentX[k + left];
+			mTangentX[k + n - 1] = mTangentX[k + right];
+		}
+
+		std::copy_n(mNormals.begin() + top*n, n, mNormals.begin());
+		std::copy_n(mNormals.begin() + bottom*n, n, mNormals.begin() + (m - 1)*n);
+		std::copy_n(mTangentX.begin() + top*n, n, mTangentX.begin());
+		std::copy_n(mTangentX.begin() + bottom*n, n, mTangentX.begin() + (m - 1)*n);
+	}
+
+	// Periodic edge rows mirror the tile at the other end of the grid.
+	if(Boundary::Wraps)
+	{
+		if(mTileAwake[mTileCount - 1])
+			++mTileVersion[0];
+		if(mTileAwake[0])
+			++mTileVersion[mTileCount - 1];
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+XMFLOAT3 WaveSolver<Scalar, Boundary, Layout>::Normal(int i)const
+{
+	if(StoresNormals())
+		return mNormals[i];
+
+	XMFLOAT3 normal;
+	DeriveNormalsSpan([this](int r, int c) { return CurrHeight(r, c); }, mNumRows, mNumCols, mSpatialStep, GetEdgeSources(),
+		i / mNumCols, i % mNumCols, i % mNumCols + 1, &normal, nullptr);
+	return normal;
+}
+
+template<class Scalar, class Boundary, class Layout>
+XMFLOAT3 WaveSolver<Scalar, Boundary, Layout>::TangentX(int i)const
+{
+	if(StoresNormals())
+		return mTangentX[i];
+
+	XMFLOAT3 normal, tangent;
+	DeriveNormalsSpan([this](int r, int c) { return CurrHeight(r, c); }, mNumRows, mNumCols, mSpatialStep, GetEdgeSources(),
+		i / mNumCols, i % mNumCols, i % mNumCols + 1, &normal, &tangent);
+	return tangent;
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::DeriveNormalsRow(int i, XMFLOAT3* normals, XMFLOAT3* tangents)const
+{
+	// Recomputes what the fused update would have stored for row i.
+	DeriveNormalsSpan([this](int r, int c) { return CurrHeight(r, c); }, mNumRows, mNumCols, mSpatialStep, GetEdgeSources(),
+		i, 0, mNumCols, normals, tangents);
+}
+
+template<class Scalar, class Boundary, class Layout>
+WaveEdgeSources WaveSolver<Scalar, Boundary, Layout>::GetEdgeSources()const
+{
+	WaveEdgeSources edges;
+	EdgeSources(edges.Top, edges.Bottom, edges.Left, edges.Right, Boundary());
+	return edges;
+}
+
+template<class Scalar, class Boundary, class Layout>
+template<class F>
+void WaveSolver<Scalar, Boundary, Layout>::ForEachRowSpan(int i, int j0, int j1, F f)const
+{
+	if(std::is_same<Layout, RowMajorLayout>::value)
+	{
+		if(j0 < j1)
+			f(i*mNumCols + j0, j0, j1);
+		return;
+	}
+
+	// A brick row at a time.
+	for(int j = j0; j < j1; )
+	{
+		const int end = std::min((j | BrickMask) + 1, j1);
+		f(Cell(i, j), j, end);
+		j = end;
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::CopyRowsOut(const std::vector<Scalar>& solution, int r0, int r1, Scalar* rows)const
+{
+	const int n = mNumCols;
+	for(int i = r0; i < r1; ++i, rows += n)
+	{
+		ForEachRowSpan(i, 0, n, [&](int cell, int j0, int j1)
+		{
+			std::copy_n(solution.begin() + cell, j1 - j0, rows + j0);
+		});
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::CopyRowsIn(const Scalar* rows, int r0, int r1, std::vector<Scalar>& solution)const
+{
+	const int n = mNumCols;
+	for(int i = r0; i < r1; ++i, rows += n)
+	{
+		ForEachRowSpan(i, 0, n, [&](int cell, int j0, int j1)
+		{
+			std::copy_n(rows + j0, j1 - j0, solution.begin() + cell);
+		});
+	}
+}
+
+template<class Scalar, class Boundary, class Layout>
+const Scalar* WaveSolver<Scalar, Boundary, Layout>::RowCells(const std::vector<Scalar>& solution, int i, int j0, int j1,
+	std::vector<Scalar>& buffer)const
+{
+	if(std::is_same<Layout, RowMajorLayout>::value)
+		return solution.data() + Cell(i, j0);
+
+	buffer.resize(j1 - j0);
+	ForEachRowSpan(i, j0, j1, [&](int cell, int a, int b)
+	{
+		std::copy_n(solution.begin() + cell, b - a, buffer.begin() + (a - j0));
+	});
+	return buffer.data();
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::Disturb(int i, int j, float magnitude)
+{
+	// Don't disturb boundaries.
+	assert(i > 1 && i < mNumRows-2);
+	assert(j > 1 && j < mNumCols-2);
+
+	Scalar mag = Traits::FromFloat(magnitude);
+	Scalar halfMag = Traits::FromFloat(0.5f*magnitude);
+	auto add = [this](int k, Scalar h) { mCurrSolution[k] = Traits::Add(mCurrSolution[k], h); };
+
+	// Disturb the ijth vertex height and its neighbors.
+	add(Cell(i, j),     mag);
+	add(Cell(i, j+1),   halfMag);
+	add(Cell(i, j-1),   halfMag);
+	add(Cell(i+1, j),   halfMag);
+	add(Cell(i-1, j),   halfMag);
+
+	// Wake and dirty every tile holding one of the touched rows.
+	for(int tile = (i - 2)/TileRows; tile <= i/TileRows; ++tile)
+	{
+		if(!mTileAwake[tile])
+			WakeTile(tile);
+		++mTileVersion[tile];
+	}
+
+	UpdateEdges();
+}
+
+template<class Scalar, class Boundary, class Layout>
+void WaveSolver<Scalar, Boundary, Layout>::DisturbBatch(const WaveImpulse* impulses, int count)
+{
+	mSplats.clear();
+	mSplatWeights.clear();
+	mSplatBinStart.assign(mTileCount + 2, 0);
+
+	// Clip each footprint to the interior, precompute its row and column
+	// weights, and count it in every tile it overlaps.
+	for(int k = 0; k < count; ++k)
+	{
+		const WaveImpulse& impulse = impulses[k];
+
+		// Grid-space centre and radius.  A footprint never gets narrower than
+		// one grid step, so every impulse reaches its nearest point.
+		const float ci = (mHalfDepth - impulse.Z) / mSpatialStep;
+		const float cj = (impulse.X + mHalfWidth) / mSpatialStep;
+		const float r = std::max(impulse.Radius / mSpatialStep, 1.0f);
+		const float sigma = r / 3.0f;
+		const float invTwoSigmaSq = 1.0f / (2.0f*sigma*sigma);
+
+		Splat splat;
+		splat.I0 = std::max((int)std::ceil(ci - r), 1);
+		splat.I1 = std::min((int)std::floor(ci + r), mNumRows - 2);
+		splat.J0 = std::max((int)std::ceil(cj - r), 1);
+		splat.J1 = std::min((int)std::floor(cj + r), mNumCols - 2);
+		if(splat.I0 > splat.I1 || splat.J0 > splat.J1)
+			continue;
+
+		splat.RowWeights = (int)mSplatWeights.size();
+		for(int i = splat.I0; i <= splat.I1; ++i)
+		{
+			const float d = i - ci;
+			mSplatWeights.push_back(impulse.Magnitude * std::exp(-d*d*invTwoSigmaSq));
+		}
+
+		splat.ColWeights = (int)mSplatWeights.size();
+		for(int j = splat.J0; j <= splat.J1; ++j)
+		{
+			const float d = j - cj;
+			mSplatWeights.push_back(std::exp(-d*d*invTwoSigmaSq));
+		}
+
+		for(int tile = (splat.I0 - 1)/TileRows; tile <= (splat.I1 - 1)/TileRows; ++tile)
+			++mSplatBinStart[tile + 2];
+
+		mSplats.push_back(splat);
+	}
+
+	if(mSplats.empty())
+		return;
+
+	// Counting sort into per-tile bins.  The counts sit one slot to the
+	// right, so after the prefix sum mSplatBinStart[tile + 1] is the fill
+	// cursor of the tile and ends up as the start of the next one.  Filling
+	// in input order keeps every bin in input order too.
+	for(int tile = 1; tile <= mTileCount + 1; ++tile)
+		mSplatBinStart[tile] += mSplatBinStart[tile - 1];
+
+	mSplatBins.resize(mSplatBinStart[mTileCount + 1]);
+	for(int k = 0; k < (int)mSplats.size(); ++k)
+	{
+		for(int tile = (mSplats[k].I0 - 1)/TileRows; tile <= (mSplats[k].I1 - 1)/TileRows; ++tile)
+			mSplatBins[mSplatBinStart[tile + 1]++] = k;
+	}
+
+	// Each tile only writes its own rows, so the tiles can go in parallel.
+	concurrency::parallel_for(0, mTileCount, [this](int tile)
+	{
+		const int r0 = 1 + tile*TileRows;
+		const int r1 = std::min(r0 + TileRows, mNumRows - 1);
+
+		for(int b = mSplatBinStart[tile]; b < mSplatBinStart[tile + 1]; ++b)
+		{
+			const Splat& splat = mSplats[mSplatBins[b]];
+			const float* colWeights = &mSplatWeights[splat.ColWeights];
+
+			for(int i = std::max(splat.I0, r0); i <= std::min(splat.I1, r1 - 1); ++i)
+			{
+				const float rowWeight = mSplatWeights[splat.RowWeights + i - splat.I0];
+
+				ForEachRowSpan(i, splat.J0, splat.J1 + 1, [&](int cell, int j0, int j1)
+				{
+					Scalar* cells = &mCurrSolution[cell];
+					for(int j = j0; j < j1; ++j, ++cells)
+						*cells = Traits::Add(*cells, Traits::FromFloat(rowWeight*colWeights[j - splat.J0]));
+				});
+			}
+		}
+	});
+
+	for(int tile = 0; tile < mTileCount; ++tile)
+	{
+		if(mSplatBinStart[tile] == mSplatBinStart[tile + 1])
+			continue;
+
+		if(!mTileAwake[tile])
+			WakeTile(tile);
+		++mTileVersion[tile];
+	}
+
+	UpdateEdges();
+}
+
+template<class Index>
+void WriteGridIndices(int m, int n, WaveIndexOrder order, Index* indices)
+{
+	assert((std::uint64_t)m*n - 1 <= (std::numeric_limits<Index>::max)());
+
+	const int quadRows = m - 1;
+	const int quadCols = n - 1;
+
+	auto emitQuad = [n, &indices](int i, int j)
+	{
+		indices[0] = (Index)(i*n + j);
+		indices[1] = (Index)(i*n + j + 1);
+		indices[2] = (Index)((i + 1)*n + j);
+
+		indices[3] = (Index)((i + 1)*n + j);
+		indices[4] = (Index)(i*n + j + 1);
+		indices[5] = (Index)((i + 1)*n + j + 1);
+
+		indices += 6; // next quad
+	};
+
+	if(order == WaveIndexOrder::RowMajor)
+	{
+		for(int i = 0; i < quadRows; ++i)
+			for(int j = 0; j < quadCols; ++j)
+				emitQuad(i, j);
+		return;
+	}
+
+	// Power-of-two blocks as wide as the grid's short side, laid along the
+	// long one, each walked in Z-order.  Codes that fall off the grid are
+	// skipped, which wastes at most 3/4 of the walk.
+	int side = 1;
+	while(side < std::min(quadRows, quadCols))
+		side *= 2;
+
+	const std::uint32_t codeCount = (std::uint32_t)side*side;
+	for(int bi = 0; bi < quadRows; bi += side)
+	{
+		for(int bj = 0; bj < quadCols; bj += side)
+		{
+			for(std::uint32_t code = 0; code < codeCount; ++code)
+			{
+				const int i = bi + (int)CompactBits(code >> 1);
+				const int j = bj + (int)CompactBits(code);
+				if(i < quadRows && j < quadCols)
+					emitQuad(i, j);
+			}
+		}
+	}
+}
+
+template void WriteGridIndices<std::uint16_t>(int m, int n, WaveIndexOrder order, std::uint16_t* indices);
+template void WriteGridIndices<std::uint32_t>(int m, int n, WaveIndexOrder order, std::uint32_t* indices);
+
+// Every supported configuration.  Add new ones here.
+template class WaveSolver<float, ClampedBoundary, RowMajorLayout>;
+template class WaveSolver<float, ReflectiveBoundary, RowMajorLayout>;
+template class WaveSolver<float, AbsorbingBoundary, RowMajorLayout>;
+template class WaveSolver<float, PeriodicBoundary, RowMajorLayout>;
+template class WaveSolver<std::int32_t, ClampedBoundary, RowMajorLayout>;
+template class WaveSolver<std::int32_t, ReflectiveBoundary, RowMajorLayout>;
+template class WaveSolver<std::int32_t, AbsorbingBoundary, RowMajorLayout>;
+template class WaveSolver<std::int32_t, PeriodicBoundary, RowMajorLayout>;
+template class WaveSolver<HALF, ClampedBoundary, RowMajorLayout>;
+template class WaveSolver<HALF, ReflectiveBoundary, RowMajorLayout>;
+template class WaveSolver<HALF, AbsorbingBoundary, RowMajorLayout>;
+template class WaveSolver<HALF, PeriodicBoundary, RowMajorLayout>;
+template class WaveSolver<float, ClampedBoundary, MortonLayout>;
+template class WaveSolver<float, ReflectiveBoundary, MortonLayout>;
+template class WaveSolver<float, AbsorbingBoundary, MortonLayout>;
+template class WaveSolver<float, PeriodicBoundary, MortonLayout>;
+template class WaveSolver<std::int32_t, ClampedBoundary, MortonLayout>;
+template class WaveSolver<std::int32_t, ReflectiveBoundary, MortonLayout>;
+template class WaveSolver<std::int32_t, AbsorbingBoundary, MortonLayout>;
+template class WaveSolver<std::int32_t, PeriodicBoundary, MortonLayout>;
+template class WaveSolver<HALF, ClampedBoundary, MortonLayout>;
+template class WaveSolver<HALF, ReflectiveBoundary, MortonLayout>;
+template class WaveSolver<HALF, AbsorbingBoundary, MortonLayout>;
+template class WaveSolver<HALF, PeriodicBoundary, MortonLayout>;
@@ -0,0 +1,670 @@
+//***************************************************************************************
+// WaveSolver.h by Frank Luna (C) 2011 All Rights Reserved.
+//
+// Performs the calculations for the wave simulation.  After the simulation has been
+// updated, the client must copy the current solution into vertex buffers for rendering.
+// This class only does the calculations, it does not do any drawing.
+//
+// The solver is configured at compile time:
+//   Scalar   - float; std::int32_t for 16.16 fixed-point heights; or
+//              DirectX::PackedVector::HALF for the memory-lean mode.
+//   Boundary - ClampedBoundary, ReflectiveBoundary, AbsorbingBoundary or
+//              PeriodicBoundary.
+//   Layout   - RowMajorLayout, or MortonLayout for heights in Z-ordered bricks.
+// The definitions live in WaveSolver.cpp, which instantiates every combination.
+//***************************************************************************************
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <intrin.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+// Edges pinned at zero; waves bounce back inverted.  The original demos'
+// behaviour.
+struct ClampedBoundary
+{
+	static const bool Wraps = false;
+	static const std::uint32_t SnapshotId = 0;
+};
+
+// Edges copy their inner neighbour (zero slope); waves bounce back upright.
+struct ReflectiveBoundary
+{
+	static const bool Wraps = false;
+	static const std::uint32_t SnapshotId = 1;
+};
+
+// Edges pinned at zero behind a sponge layer that damps outgoing waves, so
+// the water looks like it continues past the grid.
+struct AbsorbingBoundary
+{
+	static const bool Wraps = false;
+	static const std::uint32_t SnapshotId = 2;
+
+	// Depth of the sponge in cells, and the damping applied per step to the
+	// cells right next to the edge.  It falls off quadratically inwards.
+	static const int SpongeCells = 12;
+	static float SpongeDamping() { return 0.15f; }
+};
+
+// Opposite edges are joined.  The edge rows and columns hold copies of the
+// opposite interior ones, so the period is (m-2)x(n-2) cells.
+struct PeriodicBoundary
+{
+	static const bool Wraps = true;
+	static const std::uint32_t SnapshotId = 3;
+};
+
+// Heights stored row by row.
+struct RowMajorLayout
+{
+};
+
+// Heights stored in 8x8 bricks, row by row inside a brick, with the bricks
+// in Z-order (Morton order) over the grid.  A cell's vertical neighbours are
+// mostly in its own brick rather than a whole row away, and bricks that are
+// close on the grid are close in memory in both directions.  Brick rows are
+// 8 cells, so the stencil kernels run on them unchanged.  Only the heights
+// are bricked: normals, tangents, saved states and everything handed out
+// stay row-major.
+struct MortonLayout
+{
+	static const int BrickShift = 3;
+	static const int BrickSize = 1 << BrickShift;
+	static const int BrickMask = BrickSize - 1;
+};
+
+// Conversions between the stored heights and float.  Coefficient is the type
+// of the stencil and sponge factors, and StoresNormals says whether normals
+// and tangents are kept per grid point or derived from the heights on output.
+// SnapshotId (here and on the boundaries) tags saved states.
+template<class Scalar>
+struct WaveScalarTraits;
+
+template<>
+struct WaveScalarTraits<float>
+{
+	using Coefficient = float;
+	static const bool StoresNormals = true;
+	static const std::uint32_t SnapshotId = 0;
+
+	static float ToFloat(float h) { return h; }
+	static float FromFloat(float h) { return h; }
+	static float ToCoefficient(float k) { return k; }
+	static float Add(float a, float b) { return a + b; }
+	static float Scale(float h, float s) { return h*s; }
+};
+
+// 16.16 fixed point.  Sums are exact and the stencil runs in integer
+// arithmetic, so a simulation replays identically on any compiler and CPU.
+template<>
+struct WaveScalarTraits<std::int32_t>
+{
+	using Coefficient = std::int32_t;
+	static const bool StoresNormals = true;
+	static const std::uint32_t SnapshotId = 1;
+	static const int FractionBits = 16;
+
+	static float ToFloat(std::int32_t h) { return h * (1.0f / (1 << FractionBits)); }
+	static std::int32_t FromFloat(float h) { return (std::int32_t)std::lround(h * (1 << FractionBits)); }
+	static std::int32_t ToCoefficient(float k) { return FromFloat(k); }
+	static std::int32_t Add(std::int32_t a, std::int32_t b) { return a + b; }
+	static std::int32_t Scale(std::int32_t h, std::int32_t s)
+	{
+		return (std::int32_t)(((std::int64_t)h*s + (1 << (FractionBits - 1))) >> FractionBits);
+	}
+};
+
+// Memory-lean mode: half-float heights and no stored normals or tangents,
+// 6 bytes per grid point instead of 36.  The half exponent acts as a scale
+// per value, so small ripples keep their relative precision.  The stencil
+// widens to float in registers and rounds once per stored value, to nearest
+// even, which bounds the error per stored value at 2^-11 of the height
+// (2^-25 absolute below 2^-14).  The damping keeps those errors from
+// piling up: driven like the demos (128x128, a ripple every 8 steps) the
+// heights stayed within 2.5% of the peak height of the float path over 2000
+// steps.  Reflective and periodic grids conserve the mean height, so there
+// the rounding drifts rather than decays (5% over the same run).
+template<>
+struct WaveScalarTraits<DirectX::PackedVector::HALF>
+{
+	using HALF = DirectX::PackedVector::HALF;
+	using Coefficient = float;
+	static const bool StoresNormals = false;
+	static const std::uint32_t SnapshotId = 2;
+
+	static float ToFloat(HALF h) { return DirectX::PackedVector::XMConvertHalfToFloat(h); }
+	static HALF FromFloat(float h) { return DirectX::PackedVector::XMConvertFloatToHalf(h); }
+	static float ToCoefficient(float k) { return k; }
+	static HALF Add(HALF a, HALF b) { return FromFloat(ToFloat(a) + ToFloat(b)); }
+	static HALF Scale(HALF h, float s) { return FromFloat(ToFloat(h)*s); }
+};
+
+// Vertex layout written by WriteVertices.  It matches the demos' Vertex, so the
+// solution can be emitted straight into their mapped upload buffers.
+struct WaveVertex
+{
+    DirectX::XMFLOAT3 Pos;
+    DirectX::XMFLOAT3 Normal;
+    DirectX::XMFLOAT2 TexC;
+};
+
+static_assert(sizeof(WaveVertex) == 8*sizeof(float), "WaveVertex must be two 16-byte halves.");
+
+// Stores one vertex as two 16-byte halves, (pos.x, pos.y, pos.z, n.x) and
+// (n.y, n.z, u, v).  aligned says dst sits on a 16-byte boundary, as every
+// vertex does when the first one does; the stores then bypass the cache,
+// since the CPU never reads these back.  Issue an _mm_sfence() after the last
+// vertex.
+inline void StoreWaveVertex(WaveVertex* dst, bool aligned, float x, float y, float z,
+    const DirectX::XMFLOAT3& normal, float u, float v)
+{
+    float* out = reinterpret_cast<float*>(dst);
+    const __m128 a = _mm_setr_ps(x, y, z, normal.x);
+    const __m128 b = _mm_setr_ps(normal.y, normal.z, u, v);
+
+    if(aligned)
+    {
+        _mm_stream_ps(out, a);
+        _mm_stream_ps(out + 4, b);
+    }
+    else
+    {
+        _mm_storeu_ps(out, a);
+        _mm_storeu_ps(out + 4, b);
+    }
+}
+
+// A Gaussian bump dropped on the water at world-space (X, Z).  The footprint
+// is cut off at Radius, which spans three standard deviations.
+struct WaveImpulse
+{
+    float X;
+    float Z;
+    float Radius;
+    float Magnitude;
+};
+
+// Describes the saved states of one solver configuration.  A snapshot
+// stream (WaveSnapshot.h) starts with one of these; every state after it is
+// StateBytes long and begins with the current heights, so a state can be
+// read in place as the height field.
+struct WaveStateHeader
+{
+    static const std::uint32_t MagicValue = 0x53564157; // "WAVS"
+    static const std::uint32_t CurrentVersion = 1;
+
+    std::uint32_t Magic = MagicValue;
+    std::uint32_t Version = CurrentVersion;
+    std::uint32_t ScalarId = 0;
+    std::uint32_t BoundaryId = 0;
+    std::int32_t NumRows = 0;
+    std::int32_t NumCols = 0;
+    float SpatialStep = 0.0f;
+    float TimeStep = 0.0f;
+    std::uint32_t Coefficients[3] = {};   // bit patterns of mK1..mK3
+    std::uint32_t TileCount = 0;
+    std::uint32_t StateBytes = 0;
+    std::uint32_t Reserved[3] = {};
+};
+
+static_assert(sizeof(WaveStateHeader) == 64, "WaveStateHeader is a file format.");
+
+// What the last WaveSolver::Update() did, for telemetry.
+struct WaveStats
+{
+    int Steps = 0;
+    float TimeStep = 0.0f;
+
+    // speed*dt/dx; the scheme is stable up to 1/sqrt(2).
+    float Courant = 0.0f;
+
+    // Sum of h^2 dx^2 over the interior (potential energy per rho*g/2) and
+    // the largest |h|, both after the last step taken.
+    float Energy = 0.0f;
+    float MaxAmplitude = 0.0f;
+};
+
+// Rows per tile of the solvers' sleep and dirty-row tracking.  Tile t holds
+// interior rows [1 + t*WaveTileRows, 1 + (t+1)*WaveTileRows); the first and
+// last tiles also own the boundary rows.  WavesFrame relies on the split.
+const int WaveTileRows = 16;
+
+// Per-column and per-row terms of the vertex positions and tex-coords, which
+// never change once the grid is built.
+struct WaveGridCoords
+{
+    std::vector<float> X;
+    std::vector<float> Z;
+    std::vector<float> U;
+    std::vector<float> V;
+};
+
+// Rows and columns the edge cells of a grid copy, or -1 where the edges
+// stay flat.
+struct WaveEdgeSources
+{
+    int Top = -1;
+    int Bottom = -1;
+    int Left = -1;
+    int Right = -1;
+};
+
+// Copy of the renderable part of a solution, always in float.
+// WaveSolver::CaptureFrame fills it so another thread can read it while the
+// simulation moves on.  If the solver does not compute normals, the frame
+// holds heights only and derives normals where they are read or written.
+class WavesFrame
+{
+public:
+    DirectX::XMFLOAT3 Position(int i)const
+    {
+        return DirectX::XMFLOAT3(
+            -mHalfWidth + (i % mNumCols)*mSpatialStep,
+            mHeights[i],
+            mHalfDepth - (i / mNumCols)*mSpatialStep);
+    }
+
+    DirectX::XMFLOAT3 Normal(int i)const;
+
+	// Same as WaveSolver::GetDirtyRows, for the captured solution.
+	void GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const;
+
+	// Same as WaveSolver::RowsVersion, for the captured solution.
+	std::uint64_t RowsVersion(int firstRow, int lastRow)const;
+
+	// Same as WaveSolver::WriteVertices, for the captured solution.
+	void WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const;
+	void WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const;
+
+	// WaveSolver::Stats() of the update the frame was captured after, so a
+	// render thread can show the telemetry of a simulation it does not own.
+	const WaveStats& Stats()const { return mStats; }
+
+private:
+    template<class Scalar, class Boundary, class Layout>
+    friend class WaveSolver;
+    friend class ShallowWaterSolver;
+    friend class OceanWaves;
+
+    WaveGridCoords mCoords;
+
+    int mNumRows = 0;
+    int mNumCols = 0;
+    float mSpatialStep = 0.0f;
+    float mHalfWidth = 0.0f;
+    float mHalfDepth = 0.0f;
+
+    std::vector<float> mHeights;
+    // Empty when the normals are derived on output.
+    std::vector<DirectX::XMFLOAT3> mNormals;
+    std::vector<std::uint64_t> mTileVersions;
+    WaveEdgeSources mEdges;
+    WaveStats mStats;
+};
+
+template<class Scalar = float, class Boundary = ClampedBoundary, class Layout = RowMajorLayout>
+class WaveSolver
+{
+	using Traits = WaveScalarTraits<Scalar>;
+	using Coefficient = typename Traits::Coefficient;
+
+public:
+    WaveSolver(int m, int n, float dx, float dt, float speed, float damping);
+    WaveSolver(const WaveSolver& rhs) = delete;
+    WaveSolver& operator=(const WaveSolver& rhs) = delete;
+    ~WaveSolver();
+
+	int RowCount()const;
+	int ColumnCount()const;
+	int VertexCount()const;
+	int TriangleCount()const;
+	float Width()const;
+	float Depth()const;
+	float SpatialStep()const;
+
+	// Returns the solution at the ith grid point.  Only the height is stored,
+	// x and z are rebuilt from the grid index.
+    DirectX::XMFLOAT3 Position(int i)const
+    {
+        return DirectX::XMFLOAT3(
+            -mHalfWidth + (i % mNumCols)*mSpatialStep,
+            Traits::ToFloat(mCurrSolution[VertexCell(i)]),
+            mHalfDepth - (i / mNumCols)*mSpatialStep);
+    }
+
+	// Returns the solution height at the ith grid point.
+    float Height(int i)const { return Traits::ToFloat(mCurrSolution[VertexCell(i)]); }
+
+	// Returns the height at the ith grid point blended between the last two
+	// solutions by InterpolationFraction(), for smooth rendering between steps.
+    float InterpolatedHeight(int i)const
+    {
+        const int k = VertexCell(i);
+        float prev = Traits::ToFloat(mPrevSolution[k]);
+        return prev + mAccumulator/mTimeStep*(Traits::ToFloat(mCurrSolution[k]) - prev);
+    }
+
+	// Fraction of a time step accumulated but not yet simulated, in [0, 1).
+    float InterpolationFraction()const { return mAccumulator / mTimeStep; }
+
+	// Returns the solution normal at the ith grid point.
+	DirectX::XMFLOAT3 Normal(int i)const;
+
+	// Returns the unit tangent vector at the ith grid point in the local x-axis direction.
+	DirectX::XMFLOAT3 TangentX(int i)const;
+
+	// The tangents are only needed by renderers doing normal mapping; turning
+	// them off skips their computation and TangentX() keeps its last values.
+	// Configurations that derive normals on output always compute TangentX().
+	void SetComputeTangentX(bool enable) { mComputeTangentX = enable; }
+
+	// Turning normals off takes them out of the update altogether: they are
+	// derived from the heights only where they are read or written, which
+	// for a culled renderer means only for the visible part of the grid.
+	// CaptureFrame then copies heights only.
+	void SetComputeNormals(bool enable);
+
+	// Upper bound on the fixed steps a single Update() may run.
+	void SetMaxSubsteps(int maxSubsteps) { mMaxSubsteps = maxSubsteps; }
+
+	// Largest fixed step the solver will take.  Von Neumann analysis of the
+	// stencil puts the limit at speed*dt/dx = 1/sqrt(2) whatever the damping;
+	// this keeps a small margin below it for rounding.
+	float MaxStableTimeStep()const;
+
+	// Changes the fixed step and recomputes the stencil coefficients, clamping
+	// to MaxStableTimeStep() as the constructor does.  dt must be positive.
+	// The previous solution is rescaled so the water keeps its current
+	// velocity, and the time accumulated towards the next step is cut to
+	// less than one new step.
+	void SetTimeStep(float dt);
+	float TimeStep()const { return mTimeStep; }
+
+	// Takes the largest stable step, so Update() runs as few steps as the
+	// grid spacing and wave speed allow.
+	void UseLargestStableStep() { SetTimeStep(MaxStableTimeStep()); }
+
+	// Telemetry of the last Update(); read it from the thread that updates,
+	// or from the WavesFrame captured after it.
+	const WaveStats& Stats()const { return mStats; }
+
+	// Advances the simulation by dt using fixed time steps; returns the number
+	// of steps taken.  Each instance keeps its own clock, so the same sequence
+	// of dt values always produces the same solution.
+	int Update(float dt);
+
+	// Runs exactly steps fixed steps, for fast-forwarding or baking, without
+	// touching the clock.  The steps are temporally blocked: each task takes a
+	// band of rows several steps forward in a skewed wavefront whose live rows
+	// stay in L2, instead of streaming the whole grid through memory for every
+	// step.  Every tile is advanced and normals are only derived after the
+	// last step, so the heights match stepping with no tile asleep, bit for
+	// bit.  Periodic grids join rows across the whole grid and just step.
+	void Advance(int steps);
+
+	void Disturb(int i, int j, float magnitude);
+
+	// Adds many impulses at once.  They are binned by row tile and the tiles
+	// are splatted in parallel, each by a single thread, so overlapping
+	// impulses need no atomics and always sum in the order given.  Footprints
+	// are clipped to the interior of the grid.
+	void DisturbBatch(const WaveImpulse* impulses, int count);
+
+	// Tiles whose heights stay below the threshold for two steps, with quiet
+	// neighbours, are snapped flat and skipped until something wakes them.
+	void SetSleepThreshold(float threshold) { mSleepThreshold = threshold; }
+	int SleepingTileCount()const;
+
+	// Appends the row ranges [first, last) whose vertices changed since
+	// tileVersions was last passed in, and brings tileVersions up to date.
+	// Keep one tileVersions per copy of the vertex data, e.g. per frame resource.
+	void GetDirtyRows(std::vector<std::uint64_t>& tileVersions, std::vector<std::pair<int, int>>& rowRanges)const;
+
+	// A number that changes whenever a vertex of rows [firstRow, lastRow)
+	// changes, for tracking parts of the grid such as render chunks.
+	std::uint64_t RowsVersion(int firstRow, int lastRow)const;
+
+	// Brings frame up to date with the current solution, copying only the
+	// tiles that changed since frame was last captured.
+	void CaptureFrame(WavesFrame& frame)const;
+
+	// Saves everything the simulation needs to carry on bit-identically: both
+	// solutions, the clock and the tile sleep state.  Normals are not saved;
+	// LoadState derives them from the heights.  SaveState writes
+	// StateHeader().StateBytes bytes.  LoadState returns false, leaving the
+	// solver untouched, if the state was saved by a different configuration.
+	WaveStateHeader StateHeader()const;
+	void SaveState(void* state)const;
+	bool LoadState(const WaveStateHeader& header, const void* state);
+
+	// Writes the finished vertices of rows [firstRow, lastRow) into vertices,
+	// which holds the whole grid (e.g. a mapped upload buffer).  Positions and
+	// tex-coords come from precomputed per-row/column terms, and 16-byte
+	// aligned destinations are filled with non-temporal stores, which suits
+	// write-combined upload heap memory.
+	void WriteVertices(int firstRow, int lastRow, WaveVertex* vertices)const;
+
+	// Writes the block of rows [firstRow, lastRow) and columns [firstCol,
+	// lastCol) row by row and tightly packed from vertices, e.g. into the
+	// vertex range of one render chunk.
+	void WriteVertices(int firstRow, int lastRow, int firstCol, int lastCol, WaveVertex* vertices)const;
+
+	// Writes the new heights of the interior cells [j0, j1) of one row.  The
+	// float SIMD variants evaluate the stencil in the same order as the scalar
+	// one, so every path produces bit-identical results.
+	using StencilRowFn = void(*)(Scalar* next, const Scalar* prev, const Scalar* curr, int rowPitch,
+		int j0, int j1, Coefficient k1, Coefficient k2, Coefficient k3);
+
+private:
+	// Footprint of one batched impulse, with its separable Gaussian weights
+	// stored at the given offsets in mSplatWeights.
+	struct Splat
+	{
+		int I0, I1;
+		int J0, J1;
+		int RowWeights;
+		int ColWeights;
+	};
+
+	void SetCoefficients();
+	void Step();
+	void AdvanceBand(int band, int bandTiles, int steps, std::vector<Scalar>& scratch);
+	void DeriveNormals();
+	void UpdateTile(int tile, RowMajorLayout);
+	void UpdateTile(int tile, MortonLayout);
+	// New heights of row i, just outside a bricked tile, packed into row.
+	void HaloRow(int i, Scalar* gather, Scalar* row);
+	void UpdateTileActivity();
+	void SleepTile(int tile);
+	void WakeTile(int tile);
+	void ComputeNormalsRow(const Scalar* up, const Scalar* row, const Scalar* down,
+		DirectX::XMFLOAT3* normals, DirectX::XMFLOAT3* tangents)const;
+	void DeriveNormalsRow(int i, DirectX::XMFLOAT3* normals, DirectX::XMFLOAT3* tangents)const;
+	WaveEdgeSources GetEdgeSources()const;
+
+	// Index in the solutions of grid point (i, j), and of the ith grid point
+	// in row-major order.
+	int Cell(int i, int j)const
+	{
+		if(std::is_same<Layout, RowMajorLayout>::value)
+			return i*mNumCols + j;
+
+		const int brick = (i >> MortonLayout::BrickShift)*mBrickCols + (j >> MortonLayout::BrickShift);
+		return mBrickOffset[brick] + ((i & MortonLayout::BrickMask) << MortonLayout::BrickShift) + (j & MortonLayout::BrickMask);
+	}
+	int VertexCell(int i)const
+	{
+		return std::is_same<Layout, RowMajorLayout>::value ? i : Cell(i / mNumCols, i % mNumCols);
+	}
+
+	// Calls f(cell, j0, j1) for every run of columns [j0, j1) of row i that
+	// is contiguous in the solutions, left to right.
+	template<class F>
+	void ForEachRowSpan(int i, int j0, int j1, F f)const;
+
+	// Copies rows [r0, r1) of a solution to or from tightly packed rows.
+	void CopyRowsOut(const std::vector<Scalar>& solution, int r0, int r1, Scalar* rows)const;
+	void CopyRowsIn(const Scalar* rows, int r0, int r1, std::vector<Scalar>& solution)const;
+
+	// Columns [j0, j1) of row i of a solution: in place when they are
+	// contiguous, otherwise gathered into buffer.
+	const Scalar* RowCells(const std::vector<Scalar>& solution, int i, int j0, int j1, std::vector<Scalar>& buffer)const;
+
+	// Current height of grid point (i, j).
+	float CurrHeight(int i, int j)const { return Traits::ToFloat(mCurrSolution[Cell(i, j)]); }
+
+	// Rows of mHaloRows per tile: the two halo rows, and for bricked tiles
+	// four packed rows.
+	static int TileHaloRows() { return std::is_same<Layout, RowMajorLayout>::value ? 2 : 6; }
+
+	// Whether the update keeps normals per grid point.
+	bool StoresNormals()const { return Traits::StoresNormals && mComputeNormals; }
+
+	// Boundary handling, picked by overload on the Boundary tag so only the
+	// configured one is compiled into the update.
+	//
+	// FinishRow runs on every freshly computed row, halo rows included.  Row
+	// is a pointer to the row's cells, or anything else indexed by column.
+	template<class Row, class B>
+	void FinishRow(int, Row, B) {}
+	template<class Row>
+	void FinishRow(int i, Row row, ReflectiveBoundary);
+	template<class Row>
+	void FinishRow(int i, Row row, AbsorbingBoundary);
+	template<class Row>
+	void FinishRow(int i, Row row, PeriodicBoundary);
+
+	// Returns the new heights of edge row i (0 or m-1) for the normals of
+	// the tile next to it, computing them into halo if needed.  Row-major
+	// tiles only; bricked tiles use HaloRow.
+	template<class B>
+	const Scalar* EdgeRow(int i, Scalar*, B) { return mNextSolution.data() + i*mNumCols; }
+	const Scalar* EdgeRow(int i, Scalar* halo, ReflectiveBoundary);
+	const Scalar* EdgeRow(int i, Scalar* halo, PeriodicBoundary);
+
+	// Rows and columns the edge cells copy, or -1 where the edges stay flat.
+	template<class B>
+	void EdgeSources(int& top, int& bottom, int& left, int& right, B)const { top = bottom = left = right = -1; }
+	void EdgeSources(int& top, int& bottom, int& left, int& right, ReflectiveBoundary)const;
+	void EdgeSources(int& top, int& bottom, int& left, int& right, PeriodicBoundary)const;
+
+	// Refreshes the edge cells of the current solution from the interior.
+	void UpdateEdges();
+
+	// Byte offsets of the sections of a saved state.
+	struct StateLayout
+	{
+		std::size_t Curr, Prev, Awake, Activity, Accumulator, Size;
+	};
+	StateLayout GetStateLayout()const;
+
+    int mNumRows = 0;
+    int mNumCols = 0;
+
+    int mVertexCount = 0;
+    int mTriangleCount = 0;
+
+    // Simulation constants we can precompute.
+    Coefficient mK1 = 0;
+    Coefficient mK2 = 0;
+    Coefficient mK3 = 0;
+
+    float mTimeStep = 0.0f;
+    float mSpatialStep = 0.0f;
+    float mSpeed = 0.0f;
+    float mDamping = 0.0f;
+
+    WaveStats mStats;
+
+    // Time accumulated towards the next fixed step.
+    float mAccumulator = 0.0f;
+    int mMaxSubsteps = 8;
+
+    // Most steps Advance() blocks together, sized so the wavefront of a band
+    // fits in L2.
+    int mBlockSteps = 1;
+
+    float mHalfWidth = 0.0f;
+    float mHalfDepth = 0.0f;
+    WaveGridCoords mCoords;
+
+    // Widest stencil kernel the CPU supports, picked once at construction.
+    StencilRowFn mStencilRow = nullptr;
+
+    bool mComputeTangentX = true;
+    bool mComputeNormals = true;
+
+    // Row tiles of the fused height/normal pass and their private halo rows,
+    // plus, for bricked tiles, room for the packed rows they read.
+    int mTileCount = 0;
+    std::vector<Scalar> mHaloRows;
+
+    // Per-tile sleep state.  The activity is the largest height magnitude of
+    // the last two solutions; the edge activity is per first/last row.  The
+    // version is bumped whenever the tile's vertices change.  The energy is
+    // the tile's share of WaveStats::Energy from its last update.
+    float mSleepThreshold = 1e-3f;
+    std::vector<std::uint8_t> mTileAwake;
+    std::vector<std::uint64_t> mTileVersion;
+    std::vector<float> mTileActivity;
+    std::vector<float> mTilePrevActivity;
+    std::vector<float> mTileEdgeActivity;
+    std::vector<float> mTileEnergy;
+
+    // AbsorbingBoundary only: damping factor by distance from the nearest
+    // edge, indexed by row and by column.  A cell uses the smaller of the two.
+    std::vector<Coefficient> mSpongeRow;
+    std::vector<Coefficient> mSpongeCol;
+
+    // DisturbBatch scratch, kept to avoid reallocating every frame.
+    std::vector<Splat> mSplats;
+    std::vector<float> mSplatWeights;
+    std::vector<int> mSplatBinStart;
+    std::vector<int> mSplatBins;
+
+    // MortonLayout only: bricks per brick row, and where each brick starts in
+    // the solutions, indexed row by row over the bricks.
+    int mBrickCols = 0;
+    std::vector<int> mBrickOffset;
+
+    // Heights only (structure of arrays); x/z are implied by the grid index.
+    // Laid out by Layout; index them through Cell().
+    std::vector<Scalar> mPrevSolution;
+    std::vector<Scalar> mCurrSolution;
+    std::vector<Scalar> mNextSolution;
+    // Advance() only: receives the next-to-last step of a block.
+    std::vector<Scalar> mSpareSolution;
+    // Empty unless Traits::StoresNormals; stale while normals are turned off.
+    std::vector<DirectX::XMFLOAT3> mNormals;
+    std::vector<DirectX::XMFLOAT3> mTangentX;
+};
+
+// Order in which WriteGridIndices emits the quads of an m x n grid.
+//   RowMajor - row by row, as the demos always did.  A quad's lower
+//              vertices are not reused until the next row, a whole row
+//              later, by which time they have left the post-transform
+//              cache.
+//   Morton   - Z-order within square blocks, so most vertices are shared
+//              by quads emitted close together.
+enum class WaveIndexOrder
+{
+	RowMajor,
+	Morton
+};
+
+// Writes 6*(m-1)*(n-1) indices triangulating the row-major grid vertices
+// that WaveSolver::WriteVertices emits, two triangles per quad.  Index is
+// std::uint16_t or std::uint32_t, and must be able to address m*n vertices.
+template<class Index>
+void WriteGridIndices(int m, int n, WaveIndexOrder order, Index* indices);
+
+// The configuration the demos use.
+using Waves = WaveSolver<>;
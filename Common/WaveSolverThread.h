@@ -0,0 +1,183 @@
+//***************************************************************************************
+// WaveSolverThread.h
+//
+// Runs a WaveSolver simulation on a worker thread one frame ahead of the renderer.
+// The render thread queues impulses and frame times, and picks up finished
+// solutions as WavesFrame copies.  Both directions go through lock-free
+// single-producer/single-consumer queues, so neither thread ever waits on a
+// lock held by the other while it has work to do.
+//***************************************************************************************
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SpscQueue.h"
+#include "WaveSolver.h"
+
+template<class Solver>
+class WaveSolverThread
+{
+public:
+	// Takes over waves: after this only its const size queries may be called
+	// from other threads until the WaveSolverThread is destroyed.
+    explicit WaveSolverThread(Solver& waves)
+        : mWaves(waves)
+    {
+        // The render thread starts out with the initial solution; every other
+        // frame is free for the worker.
+        mCurrentFrame = &mFrames[0];
+        mWaves.CaptureFrame(*mCurrentFrame);
+
+        for(int i = 1; i < FrameCount; ++i)
+            mFree.Push(&mFrames[i]);
+
+        mWorker = std::thread(&WaveSolverThread::Run, this);
+    }
+
+    WaveSolverThread(const WaveSolverThread& rhs) = delete;
+    WaveSolverThread& operator=(const WaveSolverThread& rhs) = delete;
+
+    ~WaveSolverThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mWakeMutex);
+            mQuit = true;
+        }
+        mWake.notify_one();
+
+        mWorker.join();
+    }
+
+	// Render thread.  Queues an impulse for the next Submit().
+	void Disturb(int i, int j, float magnitude)
+	{
+		mPendingImpulses.push_back({ i, j, magnitude });
+	}
+
+	// Render thread.  Queues world-space impulses for the next Submit().
+	void DisturbBatch(const WaveImpulse* impulses, int count)
+	{
+		mPendingBatch.insert(mPendingBatch.end(), impulses, impulses + count);
+	}
+
+	// Render thread.  Asks the worker to apply the queued impulses and
+	// advance the simulation by dt.
+	void Submit(float dt)
+	{
+		Command cmd;
+		cmd.Dt = dt;
+		cmd.Impulses.swap(mPendingImpulses);
+		cmd.Batch.swap(mPendingBatch);
+
+		// If the worker is a whole queue behind, let it catch up.  A failed push
+		// leaves cmd untouched.
+		while(!mCommands.Push(std::move(cmd)))
+			std::this_thread::yield();
+
+		// Taking the lock orders the push before the worker's wait predicate,
+		// so the notification cannot be missed.
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+		}
+		mWake.notify_one();
+	}
+
+	// Render thread.  Returns the newest solution the worker has finished.
+	// The reference stays valid until the next call.
+	const WavesFrame& Latest()
+	{
+		// Keep the newest finished frame and hand the superseded ones back.
+		WavesFrame* frame = nullptr;
+		while(mReady.Pop(frame))
+		{
+			mFree.Push(mCurrentFrame);
+			mCurrentFrame = frame;
+		}
+
+		return *mCurrentFrame;
+	}
+
+private:
+	struct Impulse
+	{
+		int I;
+		int J;
+		float Magnitude;
+	};
+
+	// The vectors are moved through the queue, so the worker takes over
+	// their storage without a copy.
+	struct Command
+	{
+		float Dt = 0.0f;
+		std::vector<Impulse> Impulses;
+		std::vector<WaveImpulse> Batch;
+	};
+
+	void Run()
+	{
+		for(;;)
+		{
+			Command cmd;
+			if(!mCommands.Pop(cmd))
+			{
+				std::unique_lock<std::mutex> lock(mWakeMutex);
+				mWake.wait(lock, [this]() { return mQuit || !mCommands.Empty(); });
+
+				// Finish the queued work before honouring a quit request.
+				if(mQuit && mCommands.Empty())
+					return;
+				continue;
+			}
+
+			for(const Impulse& impulse : cmd.Impulses)
+				mWaves.Disturb(impulse.I, impulse.J, impulse.Magnitude);
+
+			if(!cmd.Batch.empty())
+				mWaves.DisturbBatch(cmd.Batch.data(), (int)cmd.Batch.size());
+
+			mWaves.Update(cmd.Dt);
+
+			// If the render thread still holds every spare frame, skip the
+			// capture; the next one copies all tiles that changed meanwhile.
+			WavesFrame* frame = nullptr;
+			if(mFree.Pop(frame))
+			{
+				mWaves.CaptureFrame(*frame);
+				mReady.Push(frame);
+			}
+		}
+	}
+
+private:
+	Solver& mWaves;
+
+	// Enough frames for one being read by the render thread, one waiting in
+	// the ready queue and one being written by the worker, plus a spare.
+	static const int FrameCount = 4;
+	std::array<WavesFrame, FrameCount> mFrames;
+	WavesFrame* mCurrentFrame = nullptr;
+
+	SpscQueue<Command, 8> mCommands;			// render -> worker
+	SpscQueue<WavesFrame*, FrameCount> mReady;	// worker -> render
+	SpscQueue<WavesFrame*, FrameCount> mFree;	// render -> worker
+
+	// Impulses collected since the last Submit().
+	std::vector<Impulse> mPendingImpulses;
+	std::vector<WaveImpulse> mPendingBatch;
+
+	// Only used to park the worker while there are no commands.
+	std::mutex mWakeMutex;
+	std::condition_variable mWake;
+	std::atomic<bool> mQuit{ false };
+
+	std::thread mWorker;
+};
+
+// The configuration the demos use.
+using WavesThread = WaveSolverThread<Waves>;
@@ -0,0 +1,439 @@
+//***************************************************************************************
+// GeometryGeneratorTest.cpp
+//
+// Checks the generators against the serial versions they replaced: grids,
+// spheres and cylinders built in parallel row bands, and the grid streamed in
+// chunks, must match them byte for byte, and subdivision with shared midpoints
+// must give every triangle the same corners as six vertices per triangle did,
+// whichever geosphere levels were cached before.  The *Streams generators must
+// hold exactly the attributes they were asked for, equal to the MeshData ones.
+//***************************************************************************************
+
+#include "Test.h"
+#include "GeometryGenerator.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using Vertex = GeometryGenerator::Vertex;
+	using uint32 = GeometryGenerator::uint32;
+
+	bool SameMesh(const MeshData& a, const MeshData& b)
+	{
+		return a.Vertices.size() == b.Vertices.size() &&
+			a.Indices32 == b.Indices32 &&
+			std::memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size()*sizeof(Vertex)) == 0;
+	}
+
+	// Same triangles in the same order, each corner byte for byte, however
+	// the vertices are shared.
+	bool SameCorners(const MeshData& a, const MeshData& b)
+	{
+		if(a.Indices32.size() != b.Indices32.size())
+			return false;
+
+		for(std::size_t k = 0; k < a.Indices32.size(); ++k)
+		{
+			if(std::memcmp(&a.Vertices[a.Indices32[k]], &b.Vertices[b.Indices32[k]], sizeof(Vertex)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	//
+	// The serial generators, one vertex at a time.
+	//
+
+	MeshData SerialGrid(float width, float depth, uint32 m, uint32 n)
+	{
+		MeshData meshData;
+
+		float halfWidth = 0.5f*width;
+		float halfDepth = 0.5f*depth;
+		float dx = width / (n-1);
+		float dz = depth / (m-1);
+		float du = 1.0f / (n-1);
+		float dv = 1.0f / (m-1);
+
+		meshData.Vertices.resize(m*n);
+		for(uint32 i = 0; i < m; ++i)
+		{
+			float z = halfDepth - i*dz;
+			for(uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j*dx;
+				meshData.Vertices[i*n+j] = Vertex(x, 0.0f, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, j*du, i*dv);
+			}
+		}
+
+		for(uint32 i = 0; i < m-1; ++i)
+		{
+			for(uint32 j = 0; j < n-1; ++j)
+			{
+				uint32 quad[6] = { i*n+j, i*n+j+1, (i+1)*n+j, (i+1)*n+j, i*n+j+1, (i+1)*n+j+1 };
+				meshData.Indices32.insert(meshData.Indices32.end(), quad, quad + 6);
+			}
+		}
+
+		return meshData;
+	}
+
+	MeshData SerialSphere(float radius, uint32 sliceCount, uint32 stackCount)
+	{
+		MeshData meshData;
+
+		meshData.Vertices.push_back(Vertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+
+		float phiStep   = XM_PI/stackCount;
+		float thetaStep = 2.0f*XM_PI/sliceCount;
+		for(uint32 i = 1; i <= stackCount-1; ++i)
+		{
+			float phi = i*phiStep;
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float theta = j*thetaStep;
+
+				Vertex v;
+				v.Position = XMFLOAT3(radius*sinf(phi)*cosf(theta), radius*cosf(phi), radius*sinf(phi)*sinf(theta));
+
+				XMFLOAT3 tangent(-radius*sinf(phi)*sinf(theta), 0.0f, +radius*sinf(phi)*cosf(theta));
+				XMStoreFloat3(&v.TangentU, XMVector3Normalize(XMLoadFloat3(&tangent)));
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMLoadFloat3(&v.Position)));
+
+				v.TexC = XMFLOAT2(theta / XM_2PI, phi / XM_PI);
+				meshData.Vertices.push_back(v);
+			}
+		}
+
+		meshData.Vertices.push_back(Vertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+
+		std::vector<uint32>& k = meshData.Indices32;
+		for(uint32 i = 1; i <= sliceCount; ++i)
+		{
+			uint32 tri[3] = { 0, i+1, i };
+			k.insert(k.end(), tri, tri + 3);
+		}
+
+		uint32 ringVertexCount = sliceCount + 1;
+		for(uint32 i = 0; i < stackCount-2; ++i)
+		{
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				uint32 a = 1 + i*ringVertexCount + j;
+				uint32 b = 1 + (i+1)*ringVertexCount + j;
+				uint32 quad[6] = { a, a+1, b, b, a+1, b+1 };
+				k.insert(k.end(), quad, quad + 6);
+			}
+		}
+
+		uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
+		uint32 baseIndex = southPoleIndex - ringVertexCount;
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			uint32 tri[3] = { southPoleIndex, baseIndex+i, baseIndex+i+1 };
+			k.insert(k.end(), tri, tri + 3);
+		}
+
+		return meshData;
+	}
+
+	void SerialCylinderCap(float radius, float y, float normalY, float height, uint32 sliceCount, MeshData& meshData)
+	{
+		uint32 baseIndex = (uint32)meshData.Vertices.size();
+		float dTheta = 2.0f*XM_PI/sliceCount;
+		for(uint32 i = 0; i <= sliceCount; ++i)
+		{
+			float x = radius*cosf(i*dTheta);
+			float z = radius*sinf(i*dTheta);
+			meshData.Vertices.push_back(Vertex(x, y, z, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, x/height + 0.5f, z/height + 0.5f));
+		}
+		meshData.Vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+		uint32 centerIndex = (uint32)meshData.Vertices.size()-1;
+		for(uint32 i = 0; i < sliceCount; ++i)
+		{
+			uint32 top[3] = { centerIndex, baseIndex + i+1, baseIndex + i };
+			uint32 bottom[3] = { centerIndex, baseIndex + i, baseIndex + i+1 };
+			const uint32* tri = normalY > 0.0f ? top : bottom;
+			meshData.Indices32.insert(meshData.Indices32.end(), tri, tri + 3);
+		}
+	}
+
+	MeshData SerialCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+		bool hasTop, bool hasBottom)
+	{
+		MeshData meshData;
+
+		float stackHeight = height / stackCount;
+		float radiusStep = (topRadius - bottomRadius) / stackCount;
+		float dTheta = 2.0f*XM_PI/sliceCount;
+		for(uint32 i = 0; i <= stackCount; ++i)
+		{
+			float y = -0.5f*height + i*stackHeight;
+			float r = bottomRadius + i*radiusStep;
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float c = cosf(j*dTheta);
+				float s = sinf(j*dTheta);
+
+				Vertex vertex;
+				vertex.Position = XMFLOAT3(r*c, y, r*s);
+				vertex.TexC = XMFLOAT2((float)j/sliceCount, 1.0f - (float)i/stackCount);
+				vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
+
+				float dr = bottomRadius-topRadius;
+				XMFLOAT3 bitangent(dr*c, -height, dr*s);
+				XMVECTOR N = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&vertex.TangentU), XMLoadFloat3(&bitangent)));
+				XMStoreFloat3(&vertex.Normal, N);
+
+				meshData.Vertices.push_back(vertex);
+			}
+		}
+
+		uint32 ringVertexCount = sliceCount+1;
+		for(uint32 i = 0; i < stackCount; ++i)
+		{
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				uint32 a = i*ringVertexCount + j;
+				uint32 b = (i+1)*ringVertexCount + j;
+				uint32 quad[6] = { a, b, b+1, a, b+1, a+1 };
+				meshData.Indices32.insert(meshData.Indices32.end(), quad, quad + 6);
+			}
+		}
+
+		if(hasTop)
+			SerialCylinderCap(topRadius, 0.5f*height, 1.0f, height, sliceCount, meshData);
+		if(hasBottom)
+			SerialCylinderCap(bottomRadius, -0.5f*height, -1.0f, height, sliceCount, meshData);
+
+		return meshData;
+	}
+
+	Vertex SerialMidPoint(const Vertex& v0, const Vertex& v1)
+	{
+		Vertex v;
+		XMStoreFloat3(&v.Position, 0.5f*(XMLoadFloat3(&v0.Position) + XMLoadFloat3(&v1.Position)));
+		XMStoreFloat3(&v.Normal, XMVector3Normalize(0.5f*(XMLoadFloat3(&v0.Normal) + XMLoadFloat3(&v1.Normal))));
+		XMStoreFloat3(&v.TangentU, XMVector3Normalize(0.5f*(XMLoadFloat3(&v0.TangentU) + XMLoadFloat3(&v1.TangentU))));
+		XMStoreFloat2(&v.TexC, 0.5f*(XMLoadFloat2(&v0.TexC) + XMLoadFloat2(&v1.TexC)));
+		return v;
+	}
+
+	// Six new vertices per triangle, none shared.
+	void SerialSubdivide(MeshData& meshData)
+	{
+		MeshData input = meshData;
+		meshData.Vertices.clear();
+		meshData.Indices32.clear();
+
+		uint32 numTris = (uint32)input.Indices32.size()/3;
+		for(uint32 i = 0; i < numTris; ++i)
+		{
+			Vertex v0 = input.Vertices[input.Indices32[i*3+0]];
+			Vertex v1 = input.Vertices[input.Indices32[i*3+1]];
+			Vertex v2 = input.Vertices[input.Indices32[i*3+2]];
+
+			Vertex corners[6] = { v0, v1, v2, SerialMidPoint(v0, v1), SerialMidPoint(v1, v2), SerialMidPoint(v0, v2) };
+			meshData.Vertices.insert(meshData.Vertices.end(), corners, corners + 6);
+
+			uint32 tris[12] = { 0, 3, 5,  3, 4, 5,  5, 4, 2,  3, 1, 4 };
+			for(uint32 k : tris)
+				meshData.Indices32.push_back(i*6 + k);
+		}
+	}
+
+	MeshData SerialGeosphere(float radius, uint32 numSubdivisions)
+	{
+		const float X = 0.525731f;
+		const float Z = 0.850651f;
+
+		XMFLOAT3 pos[12] =
+		{
+			XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+			XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+			XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+			XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+			XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+			XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+		};
+
+		uint32 k[60] =
+		{
+			1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+			1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+			3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+			10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+		};
+
+		MeshData meshData;
+		meshData.Vertices.resize(12);
+		meshData.Indices32.assign(&k[0], &k[60]);
+		for(uint32 i = 0; i < 12; ++i)
+			meshData.Vertices[i].Position = pos[i];
+
+		for(uint32 i = 0; i < numSubdivisions; ++i)
+			SerialSubdivide(meshData);
+
+		for(Vertex& v : meshData.Vertices)
+		{
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.Position));
+			XMStoreFloat3(&v.Position, radius*n);
+			XMStoreFloat3(&v.Normal, n);
+
+			float theta = atan2f(v.Position.z, v.Position.x);
+			if(theta < 0.0f)
+				theta += XM_2PI;
+			float phi = acosf(v.Position.y / radius);
+			v.TexC = XMFLOAT2(theta/XM_2PI, phi/XM_PI);
+
+			XMFLOAT3 tangent(-radius*sinf(phi)*sinf(theta), 0.0f, +radius*sinf(phi)*cosf(theta));
+			XMStoreFloat3(&v.TangentU, XMVector3Normalize(XMLoadFloat3(&tangent)));
+		}
+
+		return meshData;
+	}
+
+	void TestSubdivide(GeometryGenerator& generator)
+	{
+		// The box's faces do not share vertices, so only the midpoints inside
+		// each face are shared.
+		MeshData box = generator.CreateBox(1.5f, 0.5f, 2.5f, 0);
+		for(uint32 level = 1; level <= 4; ++level)
+		{
+			SerialSubdivide(box);
+			MeshData shared = generator.CreateBox(1.5f, 0.5f, 2.5f, level);
+			CHECK(SameCorners(shared, box));
+		}
+		CHECK(generator.CreateBox(1.5f, 0.5f, 2.5f, 4).Vertices.size() == 1734);
+
+		// Levels come from the cache in any order, and match a generator that
+		// has built nothing before.
+		const uint32 order[] = { 3, 1, 6, 0, 2, 6, 5, 4 };
+		for(uint32 level : order)
+		{
+			MeshData cached = generator.CreateGeosphere(2.0f, level);
+			GeometryGenerator fresh;
+			CHECK(SameMesh(cached, fresh.CreateGeosphere(2.0f, level)));
+			CHECK(cached.Vertices.size() == 10*(1u << 2*level) + 2);
+			if(level <= 4)
+				CHECK(SameCorners(cached, SerialGeosphere(2.0f, level)));
+		}
+
+		// A different radius from the same cached level.
+		CHECK(SameCorners(generator.CreateGeosphere(0.5f, 3), SerialGeosphere(0.5f, 3)));
+	}
+
+	// The selected attributes of streams equal those of meshData and the
+	// others are empty.
+	template<class T, class Member>
+	bool SameStream(const std::vector<T>& stream, bool selected, const MeshData& meshData, Member member)
+	{
+		if(!selected)
+			return stream.empty();
+		if(stream.size() != meshData.Vertices.size())
+			return false;
+
+		for(std::size_t i = 0; i < stream.size(); ++i)
+		{
+			if(std::memcmp(&stream[i], &(meshData.Vertices[i].*member), sizeof(T)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool SameAttributes(const GeometryGenerator::MeshStreams& streams, uint32 attributes, const MeshData& meshData)
+	{
+		return streams.Attributes == attributes &&
+			streams.VertexCount == meshData.Vertices.size() &&
+			streams.Indices32 == meshData.Indices32 &&
+			SameStream(streams.Positions, (attributes & GeometryGenerator::AttributePosition) != 0, meshData, &Vertex::Position) &&
+			SameStream(streams.Normals, (attributes & GeometryGenerator::AttributeNormal) != 0, meshData, &Vertex::Normal) &&
+			SameStream(streams.TangentUs, (attributes & GeometryGenerator::AttributeTangentU) != 0, meshData, &Vertex::TangentU) &&
+			SameStream(streams.TexCs, (attributes & GeometryGenerator::AttributeTexC) != 0, meshData, &Vertex::TexC);
+	}
+
+	void TestStreams(GeometryGenerator& generator)
+	{
+		const MeshData box = generator.CreateBox(1.5f, 0.5f, 1.5f, 3);
+		const MeshData sphere = generator.CreateSphere(0.5f, 20, 20);
+		const MeshData bigSphere = generator.CreateSphere(1.0f, 256, 200);
+		const MeshData geosphere = generator.CreateGeosphere(0.5f, 3);
+		const MeshData cylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+		const MeshData openCylinder = generator.CreateCylinder(0.5f, 0.3f, 3.0f, 300, 150, false, true);
+		const MeshData grid = generator.CreateGrid(20.0f, 30.0f, 60, 40);
+		const MeshData bigGrid = generator.CreateGrid(160.0f, 160.0f, 300, 257);
+
+		// Every combination, including none.
+		for(uint32 attributes = 0; attributes <= GeometryGenerator::AttributeAll; ++attributes)
+		{
+			CHECK(SameAttributes(generator.CreateBoxStreams(1.5f, 0.5f, 1.5f, 3, attributes), attributes, box));
+			CHECK(SameAttributes(generator.CreateSphereStreams(0.5f, 20, 20, attributes), attributes, sphere));
+			CHECK(SameAttributes(generator.CreateSphereStreams(1.0f, 256, 200, attributes), attributes, bigSphere));
+			CHECK(SameAttributes(generator.CreateGeosphereStreams(0.5f, 3, attributes), attributes, geosphere));
+			CHECK(SameAttributes(generator.CreateCylinderStreams(0.5f, 0.3f, 3.0f, 20, 20, attributes), attributes, cylinder));
+			CHECK(SameAttributes(generator.CreateCylinderStreams(0.5f, 0.3f, 3.0f, 300, 150, attributes, false, true), attributes, openCylinder));
+			CHECK(SameAttributes(generator.CreateGridStreams(20.0f, 30.0f, 60, 40, attributes), attributes, grid));
+			CHECK(SameAttributes(generator.CreateGridStreams(160.0f, 160.0f, 300, 257, attributes), attributes, bigGrid));
+		}
+	}
+
+	void TestRowBands(GeometryGenerator& generator)
+	{
+		// Small shapes build in one band, large ones in several.
+		const uint32 gridSizes[][2] = { { 2, 2 }, { 20, 30 }, { 301, 257 }, { 1000, 17 } };
+		for(const auto& size : gridSizes)
+			CHECK(SameMesh(generator.CreateGrid(160.0f, 90.0f, size[0], size[1]), SerialGrid(160.0f, 90.0f, size[0], size[1])));
+
+		const uint32 sphereSizes[][2] = { { 3, 2 }, { 20, 20 }, { 255, 200 }, { 7, 4000 } };
+		for(const auto& size : sphereSizes)
+			CHECK(SameMesh(generator.CreateSphere(1.5f, size[0], size[1]), SerialSphere(1.5f, size[0], size[1])));
+
+		const uint32 cylinderSizes[][2] = { { 3, 1 }, { 20, 20 }, { 300, 150 }, { 5, 5000 } };
+		for(const auto& size : cylinderSizes)
+		{
+			for(int caps = 0; caps < 4; ++caps)
+			{
+				const bool hasTop = (caps & 1) != 0;
+				const bool hasBottom = (caps & 2) != 0;
+				CHECK(SameMesh(generator.CreateCylinder(0.5f, 0.3f, 3.0f, size[0], size[1], hasTop, hasBottom),
+					SerialCylinder(0.5f, 0.3f, 3.0f, size[0], size[1], hasTop, hasBottom)));
+			}
+		}
+
+		// The streamed bands stitch back into the whole grid.
+		const uint32 m = 203;
+		const uint32 n = 150;
+		const MeshData whole = SerialGrid(60.0f, 80.0f, m, n);
+		for(uint32 rowsPerChunk : { 1u, 64u, 202u, 500u })
+		{
+			MeshData stitched;
+			bool contiguous = true;
+			generator.CreateGrid(60.0f, 80.0f, m, n, rowsPerChunk, [&](uint32 firstRow, const MeshData& chunk)
+			{
+				// Each band repeats the edge row of the band above.
+				const uint32 baseVertex = firstRow*n;
+				contiguous = contiguous && (stitched.Vertices.empty() ? firstRow == 0 : stitched.Vertices.size() == baseVertex + n);
+				stitched.Vertices.resize(baseVertex);
+				stitched.Vertices.insert(stitched.Vertices.end(), chunk.Vertices.begin(), chunk.Vertices.end());
+				for(uint32 index : chunk.Indices32)
+					stitched.Indices32.push_back(baseVertex + index);
+			});
+			CHECK(contiguous);
+			CHECK(SameMesh(stitched, whole));
+		}
+	}
+}
+
+void TestGeometryGenerator()
+{
+	GeometryGenerator generator;
+	TestRowBands(generator);
+	TestSubdivide(generator);
+	TestStreams(generator);
+}
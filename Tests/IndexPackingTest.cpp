@@ -0,0 +1,162 @@
+//***************************************************************************************
+// IndexPackingTest.cpp
+//
+// Packs a grid too large for 16-bit indices, which must split into rebased
+// runs that reproduce every index; scattered indices, which must stay 32-bit;
+// and ranges that are not whole triangles or are empty, which stay one draw.
+//***************************************************************************************
+
+#include "Test.h"
+#include "IndexPacking.h"
+#include "GeometryGenerator.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// The index the GPU fetches for packed index i of part.
+	std::uint32_t Fetched(const PackedIndices& packed, const IndexRange& part, std::uint32_t i)
+	{
+		const std::uint32_t index = packed.IndexSize == 2 ? packed.Indices16[i] : packed.Indices32[i];
+		return (std::uint32_t)((std::int32_t)index + part.BaseVertex);
+	}
+
+	// Every submesh's parts follow each other, cover its indices in order, and
+	// fetch exactly the vertices the submesh's own indices and base vertex do.
+	bool Reproduces(const std::vector<std::uint32_t>& indices, const std::vector<IndexRange>& submeshes,
+		const PackedIndices& packed)
+	{
+		if(packed.FirstPart.size() != submeshes.size() + 1 || packed.FirstPart.back() != packed.Parts.size())
+			return false;
+
+		std::uint32_t next = 0;
+		for(std::size_t s = 0; s < submeshes.size(); ++s)
+		{
+			const IndexRange& submesh = submeshes[s];
+			std::uint32_t source = submesh.StartIndex;
+			for(std::uint32_t p = packed.FirstPart[s]; p < packed.FirstPart[s + 1]; ++p)
+			{
+				const IndexRange& part = packed.Parts[p];
+				if(part.StartIndex != next)
+					return false;
+
+				for(std::uint32_t i = part.StartIndex; i < part.StartIndex + part.IndexCount; ++i, ++source)
+				{
+					if(Fetched(packed, part, i) != indices[source] + (std::uint32_t)submesh.BaseVertex)
+						return false;
+				}
+				next += part.IndexCount;
+			}
+			if(source != submesh.StartIndex + submesh.IndexCount)
+				return false;
+		}
+		return next*(std::size_t)packed.IndexSize == packed.ByteSize();
+	}
+
+	void TestSplitGrid()
+	{
+		// 300 x 300 vertices, as the grid lays them out: in first-use order.
+		GeometryGenerator generator;
+		const GeometryGenerator::MeshData grid = generator.CreateGrid(100.0f, 100.0f, 300, 300);
+		CHECK(grid.Vertices.size() > MaxIndex16 + 1);
+
+		// After a small shape, so the grid has a base vertex of its own.
+		const GeometryGenerator::MeshData box = generator.CreateBox(1.0f, 1.0f, 1.0f, 0);
+		std::vector<std::uint32_t> indices = box.Indices32;
+		indices.insert(indices.end(), grid.Indices32.begin(), grid.Indices32.end());
+
+		std::vector<IndexRange> submeshes(2);
+		submeshes[0].IndexCount = (std::uint32_t)box.Indices32.size();
+		submeshes[1].StartIndex = submeshes[0].IndexCount;
+		submeshes[1].IndexCount = (std::uint32_t)grid.Indices32.size();
+		submeshes[1].BaseVertex = (std::int32_t)box.Vertices.size();
+
+		PackedIndices packed;
+		const IndexPackingReport report = PackIndices(indices.data(), submeshes, packed);
+		CHECK(packed.IndexSize == 2);
+		CHECK(packed.Indices32.empty());
+		CHECK(report.SplitSubmeshes == 1 && report.UnsplittableSubmeshes == 0);
+		CHECK(report.BytesBefore == indices.size()*4 && report.BytesAfter == indices.size()*2);
+
+		// The box is small enough to keep its indices as they are.
+		CHECK(packed.FirstPart[1] - packed.FirstPart[0] == 1);
+		CHECK(packed.Parts[0].BaseVertex == 0);
+
+		// The grid needs two runs at least, and whole triangles in each.
+		const std::uint32_t gridParts = packed.FirstPart[2] - packed.FirstPart[1];
+		CHECK(gridParts >= 2 && gridParts <= 3);
+
+		bool spansFit = true;
+		std::uint32_t source = submeshes[1].StartIndex;
+		for(std::uint32_t p = packed.FirstPart[1]; p < packed.FirstPart[2]; ++p)
+		{
+			const IndexRange& part = packed.Parts[p];
+			const auto range = std::minmax_element(indices.begin() + source, indices.begin() + source + part.IndexCount);
+			spansFit = spansFit && part.IndexCount % 3 == 0 && *range.second - *range.first <= MaxIndex16;
+			source += part.IndexCount;
+		}
+		CHECK(spansFit);
+		CHECK(Reproduces(indices, submeshes, packed));
+	}
+
+	void TestScattered()
+	{
+		// Triangles alternate between the two ends of 200000 vertices, so
+		// every one would start a new run.
+		std::vector<std::uint32_t> indices;
+		for(std::uint32_t t = 0; t < 1000; ++t)
+		{
+			const std::uint32_t first = t % 2 == 0 ? 3*t : 200000 - 3*t;
+			indices.insert(indices.end(), { first, first + 1, first + 2 });
+		}
+
+		PackedIndices packed;
+		IndexPackingReport report = PackIndices(indices, packed);
+		CHECK(packed.IndexSize == 4);
+		CHECK(packed.Indices16.empty() && packed.Indices32 == indices);
+		CHECK(packed.Parts.size() == 1 && packed.Parts[0].IndexCount == indices.size());
+		CHECK(report.UnsplittableSubmeshes == 1 && report.SplitSubmeshes == 0);
+		CHECK(report.BytesAfter == report.BytesBefore);
+
+		// So does one triangle spanning more than 16 bits reach.
+		const std::vector<std::uint32_t> wide = { 0, 1, 70000 };
+		report = PackIndices(wide, packed);
+		CHECK(packed.IndexSize == 4 && packed.Indices32 == wide);
+		CHECK(report.UnsplittableSubmeshes == 1);
+	}
+
+	void TestSingleParts()
+	{
+		// A list of 4 indices, an empty range, and whole triangles after them.
+		const std::vector<std::uint32_t> indices = { 0, 1, 2, 3, 4, 5, 6 };
+		std::vector<IndexRange> submeshes(3);
+		submeshes[0].IndexCount = 4;
+		submeshes[1].StartIndex = 4;
+		submeshes[2].StartIndex = 4;
+		submeshes[2].IndexCount = 3;
+		submeshes[2].BaseVertex = 10;
+
+		PackedIndices packed;
+		const IndexPackingReport report = PackIndices(indices.data(), submeshes, packed);
+		CHECK(packed.IndexSize == 2);
+		CHECK(packed.FirstPart == std::vector<std::uint32_t>({ 0, 1, 2, 3 }));
+		CHECK(packed.Parts[0].IndexCount == 4);
+		CHECK(packed.Parts[1].IndexCount == 0);
+		CHECK(packed.Parts[2].BaseVertex == 10);
+		CHECK(report.SplitSubmeshes == 0 && report.UnsplittableSubmeshes == 0);
+		CHECK(Reproduces(indices, submeshes, packed));
+
+		// An empty list still gives its one, empty, part.
+		packed = PackedIndices();
+		PackIndices(std::vector<std::uint32_t>(), packed);
+		CHECK(packed.Parts.size() == 1 && packed.Parts[0].IndexCount == 0);
+		CHECK(packed.FirstPart == std::vector<std::uint32_t>({ 0, 1 }));
+	}
+}
+
+void TestIndexPacking()
+{
+	TestSplitGrid();
+	TestScattered();
+	TestSingleParts();
+}
@@ -0,0 +1,56 @@
+//***************************************************************************************
+// Main.cpp
+//
+// Runs every test, or only those named on the command line.  Exits with 1
+// if a check failed.
+//***************************************************************************************
+
+#include "Test.h"
+#include <cstring>
+
+int gFailedChecks = 0;
+
+namespace
+{
+	struct Test
+	{
+		const char* Name;
+		void (*Run)();
+	};
+
+	const Test Tests[] =
+	{
+		{ "GeometryGenerator", TestGeometryGenerator },
+		{ "IndexPacking", TestIndexPacking },
+		{ "MeshletBuilder", TestMeshletBuilder },
+		{ "MeshOptimizer", TestMeshOptimizer },
+		{ "MeshSimplifier", TestMeshSimplifier },
+		{ "OceanWaves", TestOceanWaves },
+		{ "ShallowWaterSolver", TestShallowWaterSolver },
+		{ "SpscQueue", TestSpscQueue },
+		{ "VertexPacking", TestVertexPacking },
+		{ "WaveLayout", TestWaveLayout },
+		{ "WaveSnapshot", TestWaveSnapshot },
+		{ "WaveSolver", TestWaveSolver },
+		{ "WaveSolverThread", TestWaveSolverThread },
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	for(const Test& t : Tests)
+	{
+		bool selected = argc == 1;
+		for(int a = 1; a < argc; ++a)
+			selected = selected || std::strcmp(argv[a], t.Name) == 0;
+
+		if(selected)
+		{
+			int failedBefore = gFailedChecks;
+			t.Run();
+			std::printf("%-20s %s\n", t.Name, gFailedChecks == failedBefore ? "passed" : "FAILED");
+		}
+	}
+
+	return gFailedChecks == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+//***************************************************************************************
+// MeshOptimizerTest.cpp
+//
+// Runs OptimizeMesh over the skull and a generated grid and checks it only
+// reorders: the same vertices, the same triangles with the same winding, and a
+// vertex cache that does no worse than before.
+//***************************************************************************************
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+	using Vertex = GeometryGenerator::Vertex;
+
+	std::string VertexBytes(const Vertex& v)
+	{
+		return std::string(reinterpret_cast<const char*>(&v), sizeof(Vertex));
+	}
+
+	// Each triangle as its corners' bytes, rotated to start at the smallest
+	// corner so the winding is kept, then sorted.
+	std::vector<std::string> Triangles(const MeshData& mesh)
+	{
+		std::vector<std::string> triangles;
+		for(std::size_t t = 0; t + 2 < mesh.Indices32.size(); t += 3)
+		{
+			std::string corners[3];
+			for(int c = 0; c < 3; ++c)
+				corners[c] = VertexBytes(mesh.Vertices[mesh.Indices32[t + c]]);
+
+			const int first = (int)(std::min_element(corners, corners + 3) - corners);
+			triangles.push_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	std::vector<std::string> Vertices(const MeshData& mesh)
+	{
+		std::vector<std::string> vertices;
+		for(const Vertex& v : mesh.Vertices)
+			vertices.push_back(VertexBytes(v));
+		std::sort(vertices.begin(), vertices.end());
+		return vertices;
+	}
+
+	bool SameStats(const VertexCacheStats& a, const VertexCacheStats& b)
+	{
+		return a.ACMR == b.ACMR && a.ATVR == b.ATVR;
+	}
+
+	void CheckOptimize(const MeshData& input)
+	{
+		MeshData mesh = input;
+		const MeshOptimizeReport report = OptimizeMesh(mesh);
+
+		CHECK(Vertices(mesh) == Vertices(input));
+		CHECK(Triangles(mesh) == Triangles(input));
+
+		const std::uint32_t vertexCount = (std::uint32_t)input.Vertices.size();
+		CHECK(SameStats(report.Before, AnalyzeVertexCache(input.Indices32.data(), input.Indices32.size(), vertexCount)));
+		CHECK(SameStats(report.After, AnalyzeVertexCache(mesh.Indices32.data(), mesh.Indices32.size(), vertexCount)));
+		CHECK(report.After.ACMR <= report.Before.ACMR);
+
+		// The vertices come in the order the triangles first use them.
+		std::uint32_t next = 0;
+		bool inFetchOrder = true;
+		for(std::uint32_t index : mesh.Indices32)
+		{
+			inFetchOrder = inFetchOrder && index <= next;
+			if(index == next)
+				++next;
+		}
+		CHECK(inFetchOrder);
+	}
+}
+
+void TestMeshOptimizer()
+{
+	MeshData skull;
+	if(CHECK(LoadSkull(skull)))
+		CheckOptimize(skull);
+
+	GeometryGenerator generator;
+	CheckOptimize(generator.CreateGrid(20.0f, 30.0f, 60, 40));
+	CheckOptimize(generator.CreateGeosphere(1.0f, 3));
+}
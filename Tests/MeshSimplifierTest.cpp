@@ -0,0 +1,173 @@
+//***************************************************************************************
+// MeshSimplifierTest.cpp
+//
+// Simplifies an open grid, which must keep its border and stay flat, and the
+// skull's level of detail chain, which must get coarser level by level over
+// the original vertices; then picks levels from it with SelectLod.
+//***************************************************************************************
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshSimplifier.h"
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	// Every triangle has three different corners, each a vertex the original
+	// mesh uses.
+	bool IndexesLiveVertices(const MeshData& mesh, const std::uint32_t* indices, std::size_t indexCount)
+	{
+		std::vector<bool> used(mesh.Vertices.size(), false);
+		for(std::uint32_t index : mesh.Indices32)
+			used[index] = true;
+
+		for(std::size_t t = 0; t + 2 < indexCount; t += 3)
+		{
+			const std::uint32_t* tri = &indices[t];
+			for(int k = 0; k < 3; ++k)
+			{
+				if(tri[k] >= mesh.Vertices.size() || !used[tri[k]])
+					return false;
+			}
+			if(tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+				return false;
+		}
+		return indexCount % 3 == 0;
+	}
+
+	std::vector<MeshLod> LodChain(const MeshData& mesh, std::vector<std::uint32_t>& lodIndices)
+	{
+		std::vector<MeshLod> lods;
+		BuildLodChain(mesh, { 1.0f, 0.5f, 0.25f, 0.125f, 0.0625f }, lodIndices, lods);
+		return lods;
+	}
+
+	// The levels follow each other in the index buffer, each with fewer
+	// indices and no less error than the one before.
+	bool Coarsens(const std::vector<MeshLod>& lods, std::size_t lodIndexCount)
+	{
+		bool coarsens = !lods.empty() && lods[0].StartIndex == 0 && lods[0].Error == 0.0f;
+		for(std::size_t i = 1; i < lods.size(); ++i)
+		{
+			coarsens = coarsens && lods[i].StartIndex == lods[i - 1].StartIndex + lods[i - 1].IndexCount;
+			coarsens = coarsens && lods[i].IndexCount < lods[i - 1].IndexCount;
+			coarsens = coarsens && lods[i].Error >= lods[i - 1].Error;
+		}
+		return coarsens && lods.back().StartIndex + lods.back().IndexCount == lodIndexCount;
+	}
+
+	void TestOpenGrid()
+	{
+		GeometryGenerator generator;
+		const MeshData grid = generator.CreateGrid(20.0f, 30.0f, 30, 20);
+		const float halfWidth = 10.0f;
+		const float halfDepth = 15.0f;
+
+		// Flat means no error beyond rounding: the grid's diagonals are not
+		// exactly straight in float, so a vertex removed from one can lie a
+		// rounding step off the triangles left around it.
+		const float flatError = 30.0f*FLT_EPSILON;
+
+		std::vector<std::uint32_t> simplified;
+		const float error = SimplifyMesh(grid.Indices32.data(), grid.Indices32.size(), &grid.Vertices[0].Position,
+			sizeof(GeometryGenerator::Vertex), (std::uint32_t)grid.Vertices.size(), 0, FLT_MAX, simplified);
+		CHECK(error <= flatError);
+		CHECK(simplified.size() < grid.Indices32.size());
+		CHECK(IndexesLiveVertices(grid, simplified.data(), simplified.size()));
+
+		// The border stays where it was, so it is still in the result.
+		std::vector<bool> kept(grid.Vertices.size(), false);
+		for(std::uint32_t index : simplified)
+			kept[index] = true;
+
+		int borderMoved = 0;
+		int borderCount = 0;
+		for(std::size_t v = 0; v < grid.Vertices.size(); ++v)
+		{
+			const XMFLOAT3& p = grid.Vertices[v].Position;
+			if(std::fabs(std::fabs(p.x) - halfWidth) < 1e-4f || std::fabs(std::fabs(p.z) - halfDepth) < 1e-4f)
+			{
+				++borderCount;
+				if(!kept[v])
+					++borderMoved;
+			}
+		}
+		CHECK(borderCount == 2*(30 + 20) - 4);
+		CHECK(borderMoved == 0);
+
+		// Nothing folded over: every triangle still faces up, and together
+		// they still cover the grid.
+		bool facesUp = true;
+		double area = 0.0;
+		for(std::size_t t = 0; t < simplified.size(); t += 3)
+		{
+			const XMFLOAT3& a = grid.Vertices[simplified[t]].Position;
+			const XMFLOAT3& b = grid.Vertices[simplified[t + 1]].Position;
+			const XMFLOAT3& c = grid.Vertices[simplified[t + 2]].Position;
+			const double up = ((double)b.z - a.z)*((double)c.x - a.x) - ((double)b.x - a.x)*((double)c.z - a.z);
+			facesUp = facesUp && up > 0.0;
+			area += 0.5*up;
+		}
+		CHECK(facesUp);
+		CHECK(std::fabs(area - 20.0*30.0) < 1e-3);
+
+		// Flat at every level.
+		std::vector<std::uint32_t> lodIndices;
+		const std::vector<MeshLod> lods = LodChain(grid, lodIndices);
+		CHECK(lods.size() > 1);
+		CHECK(Coarsens(lods, lodIndices.size()));
+		bool flat = true;
+		for(const MeshLod& lod : lods)
+			flat = flat && lod.Error <= flatError;
+		CHECK(flat);
+	}
+
+	void TestSkullChain()
+	{
+		MeshData skull;
+		if(!CHECK(LoadSkull(skull)))
+			return;
+
+		std::vector<std::uint32_t> lodIndices;
+		const std::vector<MeshLod> lods = LodChain(skull, lodIndices);
+		CHECK(lods.size() == 5);
+		CHECK(Coarsens(lods, lodIndices.size()));
+		CHECK(lods[0].IndexCount == skull.Indices32.size());
+		CHECK(lods.back().Error > 0.0f);
+
+		bool live = true;
+		for(const MeshLod& lod : lods)
+			live = live && IndexesLiveVertices(skull, &lodIndices[lod.StartIndex], lod.IndexCount);
+		CHECK(live);
+
+		// As StencilApp picks them: the skull at its size on a 600 pixel high
+		// viewport with a quarter pi field of view.
+		const float pixelsPerUnit = 600.0f / (2.0f * std::tan(0.125f * 3.14159265f));
+		CHECK(SelectLod(lods, 0.0f, pixelsPerUnit) == 0);
+		CHECK(SelectLod(lods, 1e-3f, pixelsPerUnit) == 0);
+		CHECK(SelectLod(lods, 1e6f, pixelsPerUnit) == (int)lods.size() - 1);
+
+		// Moving away never picks a finer level.
+		bool monotonic = true;
+		int previous = 0;
+		for(float distance = 1.0f; distance < 1e5f; distance *= 1.25f)
+		{
+			const int selected = SelectLod(lods, distance, pixelsPerUnit);
+			monotonic = monotonic && selected >= previous;
+			previous = selected;
+		}
+		CHECK(monotonic);
+	}
+}
+
+void TestMeshSimplifier()
+{
+	TestOpenGrid();
+	TestSkullChain();
+}
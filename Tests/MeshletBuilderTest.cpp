@@ -0,0 +1,133 @@
+//***************************************************************************************
+// MeshletBuilderTest.cpp
+//
+// Builds meshlets for the skull and the generated shapes, validates them, and
+// checks the normal cone never culls a meshlet with a triangle facing the eye.
+//***************************************************************************************
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	using MeshData = GeometryGenerator::MeshData;
+
+	bool BuildValid(const MeshData& mesh, MeshletData& meshlets)
+	{
+		BuildMeshlets(mesh, meshlets);
+
+		std::string error;
+		const bool valid = ValidateMeshlets(meshlets, mesh.Indices32.data(), mesh.Indices32.size(),
+			&mesh.Vertices[0].Position, sizeof(GeometryGenerator::Vertex), (std::uint32_t)mesh.Vertices.size(), error);
+		if(!valid)
+			std::printf("  %s\n", error.c_str());
+		return valid;
+	}
+
+	// True if some triangle of the meshlet faces eye: eye is on the side its
+	// winding's normal points to.
+	bool SeesFrontFace(const MeshData& mesh, const MeshletData& meshlets, const Meshlet& meshlet, FXMVECTOR eye)
+	{
+		const std::uint32_t* vertices = &meshlets.VertexIndices[meshlet.VertexOffset];
+		const std::uint8_t* triangles = &meshlets.TriangleIndices[3*(std::size_t)meshlet.TriangleOffset];
+		for(std::uint32_t t = 0; t < meshlet.TriangleCount; ++t)
+		{
+			const XMVECTOR p0 = XMLoadFloat3(&mesh.Vertices[vertices[triangles[3*t + 0]]].Position);
+			const XMVECTOR p1 = XMLoadFloat3(&mesh.Vertices[vertices[triangles[3*t + 1]]].Position);
+			const XMVECTOR p2 = XMLoadFloat3(&mesh.Vertices[vertices[triangles[3*t + 2]]].Position);
+			const XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			if(XMVectorGetX(XMVector3LengthSq(n)) <= 0.0f)
+				continue;
+
+			if(XMVectorGetX(XMVector3Dot(n, eye - p0)) > 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	// Eyes all around the mesh, from inside its bounds to far away; returns
+	// how many (meshlet, eye) pairs were culled, or -1 if one was culled with a
+	// front face in view.
+	int CheckConservativeCulling(const MeshData& mesh, const MeshletData& meshlets)
+	{
+		BoundingSphere bounds;
+		BoundingSphere::CreateFromPoints(bounds, mesh.Vertices.size(), &mesh.Vertices[0].Position,
+			sizeof(GeometryGenerator::Vertex));
+
+		std::mt19937 rng(23);
+		std::normal_distribution<float> gaussian;
+		int culled = 0;
+		int wrong = 0;
+		for(float scale : { 0.25f, 0.75f, 1.1f, 2.0f, 8.0f })
+		{
+			for(int e = 0; e < 40; ++e)
+			{
+				const XMVECTOR direction = XMVector3Normalize(XMVectorSet(gaussian(rng), gaussian(rng), gaussian(rng), 0.0f));
+				const XMVECTOR eye = XMLoadFloat3(&bounds.Center) + direction*(scale*bounds.Radius);
+				for(const Meshlet& meshlet : meshlets.Meshlets)
+				{
+					if(!IsMeshletBackfacing(meshlet, eye))
+						continue;
+					++culled;
+					if(SeesFrontFace(mesh, meshlets, meshlet, eye))
+						++wrong;
+				}
+			}
+		}
+		return wrong == 0 ? culled : -1;
+	}
+
+	void CheckMesh(const MeshData& mesh)
+	{
+		MeshletData meshlets;
+		if(!CHECK(BuildValid(mesh, meshlets)))
+			return;
+
+		// Cones that cull nothing would pass trivially.
+		const int culled = CheckConservativeCulling(mesh, meshlets);
+		CHECK(culled > 0);
+	}
+}
+
+void TestMeshletBuilder()
+{
+	GeometryGenerator::MeshData skull;
+	if(CHECK(LoadSkull(skull)))
+	{
+		CheckMesh(skull);
+
+		// As the demo builds them, after reordering for the vertex cache.
+		OptimizeMesh(skull);
+		CheckMesh(skull);
+	}
+
+	GeometryGenerator generator;
+	CheckMesh(generator.CreateBox(1.5f, 0.5f, 1.5f, 3));
+	CheckMesh(generator.CreateSphere(0.5f, 20, 20));
+	CheckMesh(generator.CreateGeosphere(0.5f, 3));
+	CheckMesh(generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20));
+
+	// One sided: from above, nothing of it is culled, and from below all of it.
+	const MeshData grid = generator.CreateGrid(20.0f, 30.0f, 60, 40);
+	MeshletData meshlets;
+	if(CHECK(BuildValid(grid, meshlets)))
+	{
+		int culledAbove = 0;
+		int culledBelow = 0;
+		for(const Meshlet& meshlet : meshlets.Meshlets)
+		{
+			culledAbove += IsMeshletBackfacing(meshlet, XMVectorSet(0.0f, 5.0f, 0.0f, 1.0f));
+			culledBelow += IsMeshletBackfacing(meshlet, XMVectorSet(0.0f, -100.0f, 0.0f, 1.0f));
+		}
+		CHECK(culledAbove == 0);
+		CHECK(culledBelow == (int)meshlets.Meshlets.size());
+	}
+}
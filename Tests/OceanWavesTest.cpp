@@ -0,0 +1,229 @@
+//***************************************************************************************
+// OceanWavesTest.cpp
+//
+// Checks OceanFFT against a direct DFT, that the patch's last row and column
+// repeat its first, and that OceanWaves drops into WaveChunkGrid and WavesFrame
+// like WaveSolver.
+//***************************************************************************************
+
+#include "Test.h"
+#include "OceanWaves.h"
+#include "WaveChunks.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	bool SameFloat3(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	void TestOceanFFT()
+	{
+		const int n = 16;
+		const int fieldCount = 2;
+		const double pi = 3.14159265358979323846;
+
+		std::mt19937 rng(7);
+		std::normal_distribution<float> gaussian;
+		std::vector<float> spectrumRe[fieldCount];
+		std::vector<float> spectrumIm[fieldCount];
+		std::vector<float> surfaceRe[fieldCount];
+		std::vector<float> surfaceIm[fieldCount];
+		std::vector<float> inputRe[fieldCount];
+		std::vector<float> inputIm[fieldCount];
+		for(int f = 0; f < fieldCount; ++f)
+		{
+			spectrumRe[f].resize(n*n);
+			spectrumIm[f].resize(n*n);
+			for(int k = 0; k < n*n; ++k)
+			{
+				spectrumRe[f][k] = gaussian(rng);
+				spectrumIm[f][k] = gaussian(rng);
+			}
+			inputRe[f] = spectrumRe[f];
+			inputIm[f] = spectrumIm[f];
+			surfaceRe[f].resize(n*n);
+			surfaceIm[f].resize(n*n);
+		}
+
+		OceanFFT fft(n);
+		fft.Inverse(fieldCount, spectrumRe, spectrumIm, surfaceRe, surfaceIm);
+
+		double maxError = 0.0;
+		for(int f = 0; f < fieldCount; ++f)
+		{
+			for(int z = 0; z < n; ++z)
+			{
+				for(int x = 0; x < n; ++x)
+				{
+					double re = 0.0;
+					double im = 0.0;
+					for(int kx = 0; kx < n; ++kx)
+					{
+						for(int kz = 0; kz < n; ++kz)
+						{
+							const double angle = 2.0*pi*((kx*x + kz*z) % n) / n;
+							const double c = std::cos(angle);
+							const double s = std::sin(angle);
+							const double a = inputRe[f][kx*n + kz];
+							const double b = inputIm[f][kx*n + kz];
+							re += a*c - b*s;
+							im += a*s + b*c;
+						}
+					}
+					maxError = std::fmax(maxError, std::fabs(surfaceRe[f][z*n + x] - re));
+					maxError = std::fmax(maxError, std::fabs(surfaceIm[f][z*n + x] - im));
+				}
+			}
+		}
+
+		// The sums are of 256 unit Gaussians, so around 16 in size.
+		CHECK(maxError < 1e-4);
+	}
+
+	void TestOceanEdges()
+	{
+		OceanWaves ocean(32, 64.0f, 12.0f, XMFLOAT2(1.0f, 0.5f), 5e-4f, 0.8f, 1);
+		ocean.Update(1.7f);
+
+		const int n = ocean.ColumnCount();
+		const int last = ocean.RowCount() - 1;
+		int mismatches = 0;
+		for(int k = 0; k < n; ++k)
+		{
+			// Row last repeats row 0 and column last column 0, one patch over.
+			const int pairs[2][2] = { { k, last*n + k }, { k*n, k*n + n - 1 } };
+			for(const auto& pair : pairs)
+			{
+				const XMFLOAT3 p0 = ocean.Position(pair[0]);
+				const XMFLOAT3 p1 = ocean.Position(pair[1]);
+				if(ocean.Height(pair[0]) != ocean.Height(pair[1]) ||
+				   !SameFloat3(ocean.Normal(pair[0]), ocean.Normal(pair[1])) ||
+				   !SameFloat3(ocean.TangentX(pair[0]), ocean.TangentX(pair[1])) ||
+				   std::fabs(std::fabs(p1.x - p0.x) + std::fabs(p1.z - p0.z) - ocean.Width()) > 1e-3f)
+				{
+					++mismatches;
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+
+	void TestOceanChunks()
+	{
+		OceanWaves ocean(64, 80.0f, 10.0f, XMFLOAT2(0.3f, -1.0f), 5e-4f, 0.6f, 5);
+		ocean.Update(0.5f);
+
+		const int m = ocean.RowCount();
+		const int n = ocean.ColumnCount();
+		std::vector<WaveVertex> grid(ocean.VertexCount());
+		ocean.WriteVertices(0, m, grid.data());
+
+		WaveChunkGrid chunks(m, n, ocean.Width() / (n - 1), 10.0f, 16);
+		std::vector<int> visible;
+		for(int c = 0; c < chunks.ChunkCount(); ++c)
+			visible.push_back(c);
+
+		std::vector<std::uint64_t> chunkVersions;
+		std::vector<WaveVertex> chunked(chunks.VertexCount());
+		chunks.WriteVisibleVertices(ocean, visible, chunkVersions, chunked.data());
+
+		int mismatches = 0;
+		for(int c = 0; c < chunks.ChunkCount(); ++c)
+		{
+			const WaveChunk& chunk = chunks.Chunk(c);
+			const WaveVertex* v = &chunked[chunk.BaseVertex];
+			for(int i = chunk.FirstRow; i < chunk.LastRow; ++i)
+			{
+				for(int j = chunk.FirstCol; j < chunk.LastCol; ++j, ++v)
+				{
+					if(std::memcmp(v, &grid[i*n + j], sizeof(WaveVertex)) != 0)
+						++mismatches;
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+
+		// Nothing changed, so nothing is written again.
+		std::vector<WaveVertex> untouched(chunks.VertexCount());
+		std::memset(untouched.data(), 0xCD, untouched.size()*sizeof(WaveVertex));
+		std::vector<WaveVertex> second = untouched;
+		chunks.WriteVisibleVertices(ocean, visible, chunkVersions, second.data());
+		CHECK(std::memcmp(second.data(), untouched.data(), second.size()*sizeof(WaveVertex)) == 0);
+
+		std::vector<std::uint64_t> tileVersions;
+		std::vector<std::pair<int, int>> rowRanges;
+		ocean.GetDirtyRows(tileVersions, rowRanges);
+		CHECK(rowRanges.size() == 1 && rowRanges[0].first == 0 && rowRanges[0].second == m);
+
+		// An update moves every row.
+		const std::uint64_t before = ocean.RowsVersion(0, 1);
+		ocean.Update(0.02f);
+		CHECK(ocean.RowsVersion(0, 1) != before);
+		CHECK(ocean.RowsVersion(m - 1, m) == ocean.RowsVersion(0, 1));
+
+		rowRanges.clear();
+		ocean.GetDirtyRows(tileVersions, rowRanges);
+		CHECK(rowRanges.size() == 1);
+		rowRanges.clear();
+		ocean.GetDirtyRows(tileVersions, rowRanges);
+		CHECK(rowRanges.empty());
+	}
+
+	void TestOceanFrame()
+	{
+		// Without choppiness the frame holds all there is to draw.
+		OceanWaves ocean(32, 50.0f, 8.0f, XMFLOAT2(1.0f, 1.0f), 5e-4f, 0.0f, 3);
+		ocean.Update(0.25f);
+
+		WavesFrame frame;
+		ocean.CaptureFrame(frame);
+
+		const int m = ocean.RowCount();
+		std::vector<WaveVertex> direct(ocean.VertexCount());
+		std::vector<WaveVertex> captured(ocean.VertexCount());
+		ocean.WriteVertices(0, m, direct.data());
+		frame.WriteVertices(0, m, captured.data());
+		CHECK(std::memcmp(direct.data(), captured.data(), direct.size()*sizeof(WaveVertex)) == 0);
+		CHECK(frame.RowsVersion(0, m) == ocean.RowsVersion(0, m));
+
+		// The frame catches up after an update.
+		ocean.Update(0.02f);
+		ocean.CaptureFrame(frame);
+		ocean.WriteVertices(0, m, direct.data());
+		frame.WriteVertices(0, m, captured.data());
+		CHECK(std::memcmp(direct.data(), captured.data(), direct.size()*sizeof(WaveVertex)) == 0);
+	}
+
+	void TestOceanCalmDirection()
+	{
+		// No wind direction blows along +x rather than filling the sea with NaNs.
+		OceanWaves calm(16, 40.0f, 9.0f, XMFLOAT2(0.0f, 0.0f), 5e-4f, 0.5f, 11);
+		OceanWaves alongX(16, 40.0f, 9.0f, XMFLOAT2(2.0f, 0.0f), 5e-4f, 0.5f, 11);
+		calm.Update(0.3f);
+		alongX.Update(0.3f);
+
+		int mismatches = 0;
+		for(int i = 0; i < calm.VertexCount(); ++i)
+		{
+			if(!SameFloat3(calm.Position(i), alongX.Position(i)) || !SameFloat3(calm.Normal(i), alongX.Normal(i)))
+				++mismatches;
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+void TestOceanWaves()
+{
+	TestOceanFFT();
+	TestOceanEdges();
+	TestOceanChunks();
+	TestOceanFrame();
+	TestOceanCalmDirection();
+}
@@ -0,0 +1,69 @@
+//***************************************************************************************
+// ShallowWaterSolverTest.cpp
+//
+// Checks that ShallowWaterSolver drops into WaveChunkGrid like WaveSolver:
+// chunked writes match the whole-grid write, and row versions only change
+// when the water under them moves.
+//***************************************************************************************
+
+#include "Test.h"
+#include "ShallowWaterSolver.h"
+#include "WaveChunks.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+void TestShallowWaterSolver()
+{
+	const int m = 150;
+	const int n = 100;
+	ShallowWaterSolver water(m, n, 1.0f, 0.02f, 0.1f);
+
+	// A bowl, half full, with a mound of water dropped off centre.
+	water.SetBathymetry([](float x, float z) { return 0.002f*(x*x + z*z) - 4.0f; });
+	water.Flood(-1.0f);
+	WaveImpulse impulse = { 10.0f, -20.0f, 6.0f, 1.0f };
+	water.DisturbBatch(&impulse, 1);
+	for(int s = 0; s < 10; ++s)
+		water.Update(0.02f);
+
+	std::vector<WaveVertex> grid(water.VertexCount());
+	water.WriteVertices(0, m, grid.data());
+
+	WaveChunkGrid chunks(m, n, 1.0f, 10.0f, 32);
+	std::vector<int> visible;
+	for(int c = 0; c < chunks.ChunkCount(); ++c)
+		visible.push_back(c);
+
+	std::vector<std::uint64_t> chunkVersions;
+	std::vector<WaveVertex> chunked(chunks.VertexCount());
+	chunks.WriteVisibleVertices(water, visible, chunkVersions, chunked.data());
+
+	int mismatches = 0;
+	for(int c = 0; c < chunks.ChunkCount(); ++c)
+	{
+		const WaveChunk& chunk = chunks.Chunk(c);
+		const WaveVertex* v = &chunked[chunk.BaseVertex];
+		for(int i = chunk.FirstRow; i < chunk.LastRow; ++i)
+		{
+			for(int j = chunk.FirstCol; j < chunk.LastCol; ++j, ++v)
+			{
+				if(std::memcmp(v, &grid[i*n + j], sizeof(WaveVertex)) != 0)
+					++mismatches;
+			}
+		}
+	}
+	CHECK(mismatches == 0);
+
+	// Nothing changed, so nothing is written again.
+	std::vector<WaveVertex> untouched(chunks.VertexCount());
+	std::memset(untouched.data(), 0xCD, untouched.size()*sizeof(WaveVertex));
+	std::vector<WaveVertex> second = untouched;
+	chunks.WriteVisibleVertices(water, visible, chunkVersions, second.data());
+	CHECK(std::memcmp(second.data(), untouched.data(), second.size()*sizeof(WaveVertex)) == 0);
+
+	// Moving water changes the versions of the rows it is in.
+	const std::uint64_t before = water.RowsVersion(0, m);
+	water.Update(0.02f);
+	CHECK(water.RowsVersion(0, m) != before);
+}
@@ -0,0 +1,88 @@
+//***************************************************************************************
+// SpscQueueTest.cpp
+//***************************************************************************************
+
+#include "Test.h"
+#include "SpscQueue.h"
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Item
+	{
+		int Sequence = 0;
+		std::vector<int> Payload;
+	};
+
+	// Payload that identifies the item it was pushed with.
+	std::vector<int> PayloadOf(int sequence)
+	{
+		return std::vector<int>(sequence % 5, sequence);
+	}
+}
+
+void TestSpscQueue()
+{
+	// One thread: full and empty are reported, and items come out in order.
+	{
+		SpscQueue<int, 4> queue;
+		int item = -1;
+		CHECK(queue.Empty());
+		CHECK(!queue.Pop(item));
+
+		for(int i = 0; i < 4; ++i)
+			CHECK(queue.Push(i));
+		CHECK(!queue.Push(4));
+
+		for(int i = 0; i < 4; ++i)
+			CHECK(queue.Pop(item) && item == i);
+		CHECK(!queue.Pop(item));
+		CHECK(queue.Empty());
+	}
+
+	// Two threads through a small queue, so both keep running into the full
+	// and empty cases.  Every item must arrive once, in order, with the
+	// payload it was moved in with.
+	{
+		const int itemCount = 200000;
+		SpscQueue<Item, 8> queue;
+
+		std::thread producer([&queue]()
+		{
+			for(int i = 0; i < itemCount; ++i)
+			{
+				Item item;
+				item.Sequence = i;
+				item.Payload = PayloadOf(i);
+				while(!queue.Push(std::move(item)))
+					std::this_thread::yield();
+			}
+		});
+
+		int expected = 0;
+		int outOfOrder = 0;
+		int badPayloads = 0;
+		while(expected < itemCount)
+		{
+			Item item;
+			if(!queue.Pop(item))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			if(item.Sequence != expected)
+				++outOfOrder;
+			if(item.Payload != PayloadOf(item.Sequence))
+				++badPayloads;
+			++expected;
+		}
+
+		producer.join();
+
+		CHECK(outOfOrder == 0);
+		CHECK(badPayloads == 0);
+		CHECK(queue.Empty());
+	}
+}
@@ -0,0 +1,30 @@
+//***************************************************************************************
+// Test.h
+//
+// Headless tests of the Common library's CPU code; no device is created.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+
+// Failed checks so far.  The tests carry on after a failure, so one run
+// reports all of them.
+extern int gFailedChecks;
+
+#define CHECK(condition) \
+	((condition) ? true : (std::printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition), ++gFailedChecks, false))
+
+void TestGeometryGenerator();
+void TestIndexPacking();
+void TestMeshletBuilder();
+void TestMeshOptimizer();
+void TestMeshSimplifier();
+void TestOceanWaves();
+void TestShallowWaterSolver();
+void TestSpscQueue();
+void TestVertexPacking();
+void TestWaveLayout();
+void TestWaveSnapshot();
+void TestWaveSolver();
+void TestWaveSolverThread();
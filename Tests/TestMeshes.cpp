@@ -0,0 +1,37 @@
+//***************************************************************************************
+// TestMeshes.cpp
+//***************************************************************************************
+
+#include "TestMeshes.h"
+#include <fstream>
+#include <string>
+
+bool LoadSkull(GeometryGenerator::MeshData& skull)
+{
+	std::ifstream fin("../Models/skull.txt");
+	if(!fin)
+		return false;
+
+	GeometryGenerator::uint32 vcount = 0;
+	GeometryGenerator::uint32 tcount = 0;
+	std::string ignore;
+
+	fin >> ignore >> vcount;
+	fin >> ignore >> tcount;
+	fin >> ignore >> ignore >> ignore >> ignore;
+
+	skull.Vertices.assign(vcount, GeometryGenerator::Vertex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+	for(GeometryGenerator::Vertex& v : skull.Vertices)
+	{
+		fin >> v.Position.x >> v.Position.y >> v.Position.z;
+		fin >> v.Normal.x >> v.Normal.y >> v.Normal.z;
+	}
+
+	fin >> ignore >> ignore >> ignore;
+
+	skull.Indices32.resize(3*tcount);
+	for(GeometryGenerator::uint32& index : skull.Indices32)
+		fin >> index;
+
+	return !fin.fail();
+}
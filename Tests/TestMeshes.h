@@ -0,0 +1,14 @@
+//***************************************************************************************
+// TestMeshes.h
+//
+// Meshes shared by the tests and the benchmarks.
+//***************************************************************************************
+
+#pragma once
+
+#include "GeometryGenerator.h"
+
+// Reads Models/skull.txt, as the Stencil demo does, relative to the Tests or
+// Benchmarks directory.  The model has positions and normals only; the other
+// attributes are zero.  Returns false if the file cannot be read.
+bool LoadSkull(GeometryGenerator::MeshData& skull);
@@ -0,0 +1,197 @@
+//***************************************************************************************
+// VertexPackingTest.cpp
+//
+// Round-trips directions through the octahedral encoding, axes and fold
+// diagonals included, then packs the skull and the generated shapes and checks
+// every unpacked vertex stays within what 16 bit quantization and half floats
+// allow.
+//***************************************************************************************
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Worst angle a direction moves through after snorm16 quantization of its
+	// encoding; the largest seen over many random directions is about 0.004.
+	const double MaxQuantizedDegrees = 0.01;
+
+	double Length(const XMFLOAT3& v)
+	{
+		return std::sqrt((double)v.x*v.x + (double)v.y*v.y + (double)v.z*v.z);
+	}
+
+	// Angle between two directions in degrees; 0 if either is zero, as in
+	// PackingReport.
+	double AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		if(Length(a) <= 0.0 || Length(b) <= 0.0)
+			return 0.0;
+
+		const XMFLOAT3 cross(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+		const double c = (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z;
+		return std::atan2(Length(cross), c)*180.0/3.14159265358979323846;
+	}
+
+	XMFLOAT3 Normalized(const XMFLOAT3& v)
+	{
+		const float length = (float)Length(v);
+		return XMFLOAT3(v.x/length, v.y/length, v.z/length);
+	}
+
+	bool InSquare(const XMFLOAT2& e)
+	{
+		return e.x >= -1.0f && e.x <= 1.0f && e.y >= -1.0f && e.y <= 1.0f;
+	}
+
+	// What PackMesh stores: each encoded component rounded to snorm16.
+	XMFLOAT2 QuantizeSnorm16(const XMFLOAT2& e)
+	{
+		return XMFLOAT2(std::round(e.x*32767.0f)/32767.0f, std::round(e.y*32767.0f)/32767.0f);
+	}
+
+	void TestOctahedral()
+	{
+		// The axes land on the square's centre, edge midpoints and corners.
+		const XMFLOAT3 axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		const XMFLOAT2 axisCodes[6] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 0, 0 }, { 1, 1 } };
+		int axisMismatches = 0;
+		for(int a = 0; a < 6; ++a)
+		{
+			const XMFLOAT2 e = EncodeOctahedral(axes[a]);
+			const XMFLOAT3 d = DecodeOctahedral(e);
+			if(e.x != axisCodes[a].x || e.y != axisCodes[a].y ||
+			   d.x != axes[a].x || d.y != axes[a].y || d.z != axes[a].z)
+			{
+				++axisMismatches;
+			}
+		}
+		CHECK(axisMismatches == 0);
+
+		// The equator is the fold line, and the lower half's diagonals fold onto
+		// the square's edges; both sides of each must come back.
+		std::vector<XMFLOAT3> folds;
+		for(int sx = -1; sx <= 1; sx += 2)
+		{
+			for(int sy = -1; sy <= 1; sy += 2)
+			{
+				folds.push_back(XMFLOAT3((float)sx, (float)sy, 0.0f));
+				folds.push_back(XMFLOAT3((float)sx, (float)sy, -1.0f));
+				folds.push_back(XMFLOAT3((float)sx, (float)sy, 1.0f));
+				folds.push_back(XMFLOAT3((float)sx, 0.0f, -1.0f));
+				folds.push_back(XMFLOAT3(0.0f, (float)sy, -1.0f));
+				folds.push_back(XMFLOAT3((float)sx, (float)sy, -1e-3f));
+			}
+		}
+
+		double foldError = 0.0;
+		bool foldsInSquare = true;
+		for(const XMFLOAT3& f : folds)
+		{
+			const XMFLOAT3 direction = Normalized(f);
+			const XMFLOAT2 e = EncodeOctahedral(direction);
+			foldsInSquare = foldsInSquare && InSquare(e);
+			foldError = std::max(foldError, AngleDegrees(DecodeOctahedral(e), direction));
+		}
+		CHECK(foldsInSquare);
+		CHECK(foldError < 1e-3);
+
+		// A zero vector encodes to the centre, which decodes as +z.
+		const XMFLOAT2 zero = EncodeOctahedral(XMFLOAT3(0.0f, 0.0f, 0.0f));
+		CHECK(zero.x == 0.0f && zero.y == 0.0f);
+
+		std::mt19937 rng(21);
+		std::normal_distribution<float> gaussian;
+		double exactError = 0.0;
+		double quantizedError = 0.0;
+		bool sweepInSquare = true;
+		for(int k = 0; k < 100000; ++k)
+		{
+			const XMFLOAT3 direction = Normalized(XMFLOAT3(gaussian(rng), gaussian(rng), gaussian(rng)));
+			const XMFLOAT2 e = EncodeOctahedral(direction);
+			sweepInSquare = sweepInSquare && InSquare(e);
+			exactError = std::max(exactError, AngleDegrees(DecodeOctahedral(e), direction));
+			quantizedError = std::max(quantizedError, AngleDegrees(DecodeOctahedral(QuantizeSnorm16(e)), direction));
+		}
+		CHECK(sweepInSquare);
+		CHECK(exactError < 1e-3);
+		CHECK(quantizedError < MaxQuantizedDegrees);
+	}
+
+	void CheckPacking(const GeometryGenerator::MeshData& mesh)
+	{
+		PackedMesh packed;
+		const PackingReport report = PackMesh(mesh, packed);
+
+		CHECK(packed.Vertices.size() == mesh.Vertices.size());
+		CHECK(packed.Indices32 == mesh.Indices32);
+		CHECK(report.VertexBytesBefore == mesh.Vertices.size()*44);
+		CHECK(report.VertexBytesAfter == mesh.Vertices.size()*20);
+
+		// A unorm16 step of the bounds, halved by rounding, plus float slack.
+		const XMFLOAT3 scale = packed.PositionScale;
+		const float bound[3] =
+		{
+			scale.x*(0.5f/65535.0f + 1e-6f),
+			scale.y*(0.5f/65535.0f + 1e-6f),
+			scale.z*(0.5f/65535.0f + 1e-6f),
+		};
+
+		int outOfBounds = 0;
+		double positionError = 0.0;
+		double normalError = 0.0;
+		double tangentError = 0.0;
+		double texCError = 0.0;
+		for(std::size_t i = 0; i < mesh.Vertices.size(); ++i)
+		{
+			const GeometryGenerator::Vertex& v = mesh.Vertices[i];
+			const GeometryGenerator::Vertex u = UnpackVertex(packed, packed.Vertices[i]);
+
+			const XMFLOAT3 d(u.Position.x - v.Position.x, u.Position.y - v.Position.y, u.Position.z - v.Position.z);
+			if(std::fabs(d.x) > bound[0] || std::fabs(d.y) > bound[1] || std::fabs(d.z) > bound[2])
+				++outOfBounds;
+
+			// Half floats keep 11 significant bits, so round to within 2^-11 of the value.
+			const float texCBound[2] = { std::fabs(v.TexC.x)/2048.0f + 1e-7f, std::fabs(v.TexC.y)/2048.0f + 1e-7f };
+			if(std::fabs(u.TexC.x - v.TexC.x) > texCBound[0] || std::fabs(u.TexC.y - v.TexC.y) > texCBound[1])
+				++outOfBounds;
+
+			positionError = std::max(positionError, Length(d));
+			normalError = std::max(normalError, AngleDegrees(u.Normal, v.Normal));
+			tangentError = std::max(tangentError, AngleDegrees(u.TangentU, v.TangentU));
+			texCError = std::max(texCError, (double)std::max(std::fabs(u.TexC.x - v.TexC.x), std::fabs(u.TexC.y - v.TexC.y)));
+		}
+		CHECK(outOfBounds == 0);
+		CHECK(normalError < MaxQuantizedDegrees);
+		CHECK(tangentError < MaxQuantizedDegrees);
+
+		// The report measures the same thing.
+		CHECK(std::fabs(report.MaxPositionError - positionError) <= 1e-6*(1.0 + positionError));
+		CHECK(std::fabs(report.MaxNormalErrorDegrees - normalError) < 1e-3);
+		CHECK(std::fabs(report.MaxTangentErrorDegrees - tangentError) < 1e-3);
+		CHECK(report.MaxTexCError == (float)texCError);
+	}
+}
+
+void TestVertexPacking()
+{
+	TestOctahedral();
+
+	GeometryGenerator::MeshData skull;
+	if(CHECK(LoadSkull(skull)))
+		CheckPacking(skull);
+
+	GeometryGenerator generator;
+	CheckPacking(generator.CreateBox(1.5f, 0.5f, 1.5f, 3));
+	CheckPacking(generator.CreateGrid(20.0f, 30.0f, 60, 40));
+	CheckPacking(generator.CreateSphere(0.5f, 20, 20));
+	CheckPacking(generator.CreateGeosphere(0.5f, 3));
+	CheckPacking(generator.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20));
+}
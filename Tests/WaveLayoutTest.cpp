@@ -0,0 +1,125 @@
+//***************************************************************************************
+// WaveLayoutTest.cpp
+//
+// Runs every solver configuration with row-major and with bricked (Morton)
+// storage side by side and checks they agree bit for bit.
+//***************************************************************************************
+
+#include "Test.h"
+#include "WaveSolver.h"
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Not multiples of the brick size, so partial bricks are exercised too.
+	const int NumRows = 45;
+	const int NumCols = 70;
+
+	template<class A, class B>
+	bool SameSolution(const A& a, const B& b)
+	{
+		if(a.SleepingTileCount() != b.SleepingTileCount())
+			return false;
+
+		for(int i = 0; i < a.VertexCount(); ++i)
+		{
+			float ha = a.Height(i), hb = b.Height(i);
+			XMFLOAT3 na = a.Normal(i), nb = b.Normal(i);
+			XMFLOAT3 ta = a.TangentX(i), tb = b.TangentX(i);
+			if(std::memcmp(&ha, &hb, sizeof(ha)) != 0 ||
+			   std::memcmp(&na, &nb, sizeof(na)) != 0 ||
+			   std::memcmp(&ta, &tb, sizeof(ta)) != 0)
+				return false;
+		}
+
+		std::vector<WaveVertex> va(a.VertexCount()), vb(b.VertexCount());
+		a.WriteVertices(0, a.RowCount(), va.data());
+		b.WriteVertices(0, b.RowCount(), vb.data());
+		if(std::memcmp(va.data(), vb.data(), va.size()*sizeof(WaveVertex)) != 0)
+			return false;
+
+		// A block that starts and ends inside bricks.
+		a.WriteVertices(3, 20, 5, 61, va.data());
+		b.WriteVertices(3, 20, 5, 61, vb.data());
+		if(std::memcmp(va.data(), vb.data(), 17*56*sizeof(WaveVertex)) != 0)
+			return false;
+
+		WavesFrame fa, fb;
+		a.CaptureFrame(fa);
+		b.CaptureFrame(fb);
+		fa.WriteVertices(0, a.RowCount(), va.data());
+		fb.WriteVertices(0, b.RowCount(), vb.data());
+		if(std::memcmp(va.data(), vb.data(), va.size()*sizeof(WaveVertex)) != 0)
+			return false;
+
+		// Saved states are row-major whatever the layout.
+		std::vector<unsigned char> sa(a.StateHeader().StateBytes), sb(b.StateHeader().StateBytes);
+		a.SaveState(sa.data());
+		b.SaveState(sb.data());
+		return sa == sb;
+	}
+
+	template<class Scalar, class Boundary>
+	void TestLayouts()
+	{
+		WaveSolver<Scalar, Boundary, RowMajorLayout> rowMajor(NumRows, NumCols, 1.0f, 0.03f, 4.0f, 0.2f);
+		WaveSolver<Scalar, Boundary, MortonLayout> morton(NumRows, NumCols, 1.0f, 0.03f, 4.0f, 0.2f);
+		const float dt = rowMajor.TimeStep();
+
+		// Every operation is applied to both.
+		auto both = [&](auto op) { op(rowMajor); op(morton); };
+
+		both([](auto& w) { w.Disturb(10, 20, 1.0f); w.Disturb(30, 62, -0.5f); });
+		both([](auto& w)
+		{
+			const WaveImpulse impulses[2] = { { -20.0f, 10.0f, 6.0f, 0.4f }, { 15.0f, -8.0f, 3.0f, 0.2f } };
+			w.DisturbBatch(impulses, 2);
+		});
+		both([dt](auto& w) { for(int s = 0; s < 20; ++s) w.Update(dt); });
+		CHECK(SameSolution(rowMajor, morton));
+
+		// Temporally blocked steps.
+		both([](auto& w) { w.Advance(9); });
+		CHECK(SameSolution(rowMajor, morton));
+
+		// Heights only, then normals derived again.
+		both([dt](auto& w) { w.SetComputeNormals(false); for(int s = 0; s < 5; ++s) w.Update(dt); });
+		CHECK(SameSolution(rowMajor, morton));
+		both([dt](auto& w) { w.SetComputeNormals(true); w.SetTimeStep(0.02f); for(int s = 0; s < 5; ++s) w.Update(0.02f); });
+		CHECK(SameSolution(rowMajor, morton));
+
+		// Let tiles fall asleep and wake them again.
+		both([](auto& w) { w.SetSleepThreshold(0.05f); for(int s = 0; s < 60; ++s) w.Update(0.02f); });
+		CHECK(SameSolution(rowMajor, morton));
+		both([](auto& w) { w.Disturb(40, 35, 0.8f); for(int s = 0; s < 10; ++s) w.Update(0.02f); });
+		CHECK(SameSolution(rowMajor, morton));
+
+		// A state saved by one layout loads into the other.
+		std::vector<unsigned char> state(rowMajor.StateHeader().StateBytes);
+		rowMajor.Disturb(22, 33, 0.3f);
+		rowMajor.SaveState(state.data());
+		CHECK(morton.LoadState(rowMajor.StateHeader(), state.data()));
+		both([](auto& w) { for(int s = 0; s < 10; ++s) w.Update(0.02f); });
+		CHECK(SameSolution(rowMajor, morton));
+	}
+
+	template<class Scalar>
+	void TestLayouts()
+	{
+		TestLayouts<Scalar, ClampedBoundary>();
+		TestLayouts<Scalar, ReflectiveBoundary>();
+		TestLayouts<Scalar, AbsorbingBoundary>();
+		TestLayouts<Scalar, PeriodicBoundary>();
+	}
+}
+
+void TestWaveLayout()
+{
+	TestLayouts<float>();
+	TestLayouts<std::int32_t>();
+	TestLayouts<HALF>();
+}
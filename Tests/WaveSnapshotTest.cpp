@@ -0,0 +1,133 @@
+//***************************************************************************************
+// WaveSnapshotTest.cpp
+//
+// Writes a stream of WaveSolver states, maps it back with WaveStreamReader and
+// checks the heights and a replay from it bit for bit, then feeds the reader a
+// truncated file and bad headers.
+//***************************************************************************************
+
+#include "Test.h"
+#include "WaveSnapshot.h"
+#include "DxException.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const int NumRows = 40;
+	const int NumCols = 50;
+	const int StateCount = 5;
+	const int StepsPerState = 7;
+
+	std::wstring TempFile(const wchar_t* name)
+	{
+		wchar_t directory[MAX_PATH + 1];
+		DWORD length = GetTempPathW(MAX_PATH + 1, directory);
+		return std::wstring(directory, length) + name;
+	}
+
+	// Writes bytes to filename, replacing it.
+	void WriteFileBytes(const std::wstring& filename, const void* bytes, std::size_t size)
+	{
+		HANDLE file = CreateFileW(filename.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		DWORD written = 0;
+		WriteFile(file, bytes, (DWORD)size, &written, nullptr);
+		CloseHandle(file);
+	}
+
+	// True if opening filename is rejected.
+	bool ReaderThrows(const std::wstring& filename)
+	{
+		try
+		{
+			WaveStreamReader reader(filename);
+		}
+		catch(const DxException&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	std::vector<float> Heights(const Waves& waves)
+	{
+		std::vector<float> heights(waves.VertexCount());
+		for(int i = 0; i < waves.VertexCount(); ++i)
+			heights[i] = waves.Height(i);
+		return heights;
+	}
+}
+
+void TestWaveSnapshot()
+{
+	const std::wstring filename = TempFile(L"WaveSnapshotTest.waves");
+
+	Waves waves(NumRows, NumCols, 1.0f, 0.03f, 4.0f, 0.2f);
+	waves.Disturb(12, 20, 1.0f);
+	waves.Disturb(30, 35, -0.5f);
+
+	std::vector<std::vector<float>> heights;
+	{
+		WaveStreamWriter writer(filename, waves.StateHeader());
+		for(int s = 0; s < StateCount; ++s)
+		{
+			for(int k = 0; k < StepsPerState; ++k)
+				waves.Update(waves.TimeStep());
+			writer.Append(waves);
+			heights.push_back(Heights(waves));
+		}
+		CHECK(writer.StateCount() == StateCount);
+	}
+
+	std::vector<std::uint8_t> file;
+	{
+		WaveStreamReader reader(filename);
+		const WaveStateHeader header = waves.StateHeader();
+		CHECK(reader.StateCount() == StateCount);
+		CHECK(std::memcmp(&reader.Header(), &header, sizeof(header)) == 0);
+
+		// The heights are read in place.
+		for(int s = 0; s < StateCount; ++s)
+			CHECK(std::memcmp(reader.Heights<float>(s), heights[s].data(), heights[s].size()*sizeof(float)) == 0);
+
+		// Resuming from a state runs on exactly as the original did.
+		Waves replay(NumRows, NumCols, 1.0f, 0.03f, 4.0f, 0.2f);
+		CHECK(replay.LoadState(reader.Header(), reader.State(1)));
+		CHECK(Heights(replay) == heights[1]);
+		for(int k = 0; k < StepsPerState; ++k)
+			replay.Update(replay.TimeStep());
+		std::vector<float> replayed = Heights(replay);
+		CHECK(std::memcmp(replayed.data(), heights[2].data(), replayed.size()*sizeof(float)) == 0);
+
+		const std::uint8_t* first = static_cast<const std::uint8_t*>(reader.State(0)) - sizeof(WaveStateHeader);
+		file.assign(first, first + sizeof(WaveStateHeader) + StateCount*(std::size_t)header.StateBytes);
+	}
+
+	// A partly written last state is left out.
+	const std::size_t stateBytes = waves.StateHeader().StateBytes;
+	WriteFileBytes(filename, file.data(), sizeof(WaveStateHeader) + 2*stateBytes + stateBytes/2);
+	{
+		WaveStreamReader reader(filename);
+		CHECK(reader.StateCount() == 2);
+	}
+
+	// Too short for a header, a wrong magic and a newer version are refused.
+	WriteFileBytes(filename, file.data(), sizeof(WaveStateHeader) - 1);
+	CHECK(ReaderThrows(filename));
+
+	WaveStateHeader bad = waves.StateHeader();
+	bad.Magic ^= 1;
+	std::memcpy(file.data(), &bad, sizeof(bad));
+	WriteFileBytes(filename, file.data(), file.size());
+	CHECK(ReaderThrows(filename));
+
+	bad = waves.StateHeader();
+	bad.Version = WaveStateHeader::CurrentVersion + 1;
+	std::memcpy(file.data(), &bad, sizeof(bad));
+	WriteFileBytes(filename, file.data(), file.size());
+	CHECK(ReaderThrows(filename));
+
+	DeleteFileW(filename.c_str());
+}
@@ -0,0 +1,39 @@
+//***************************************************************************************
+// WaveSolverTest.cpp
+//***************************************************************************************
+
+#include "Test.h"
+#include "WaveSolver.h"
+
+void TestWaveSolver()
+{
+	// Shrinking the step with most of an old step accumulated must leave less
+	// than one new step owed, or the interpolated heights extrapolate.
+	{
+		Waves waves(32, 32, 1.0f, 0.1f, 4.0f, 0.2f);
+		waves.Disturb(16, 16, 1.0f);
+		waves.Update(0.25f);
+		waves.SetTimeStep(0.02f);
+
+		CHECK(waves.TimeStep() == 0.02f);
+		CHECK(waves.InterpolationFraction() >= 0.0f && waves.InterpolationFraction() < 1.0f);
+	}
+
+	// The largest stable step stays below the Courant limit of 1/sqrt(2),
+	// and the frame captured after an update carries its telemetry.
+	{
+		Waves waves(32, 32, 1.0f, 0.03f, 4.0f, 0.2f);
+		waves.UseLargestStableStep();
+		waves.Disturb(16, 16, 1.0f);
+
+		const int steps = waves.Update(2.5f*waves.TimeStep());
+		WavesFrame frame;
+		waves.CaptureFrame(frame);
+
+		CHECK(steps == 2);
+		CHECK(frame.Stats().Steps == 2);
+		CHECK(frame.Stats().TimeStep == waves.TimeStep());
+		CHECK(frame.Stats().Courant > 0.6f && frame.Stats().Courant < 0.7072f);
+		CHECK(frame.Stats().MaxAmplitude > 0.0f);
+	}
+}
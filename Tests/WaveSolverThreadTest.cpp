@@ -0,0 +1,178 @@
+//***************************************************************************************
+// WaveSolverThreadTest.cpp
+//
+// Drives a WavesThread the way the demos do and compares every frame
+// Latest() returns with a solver stepped the same way on this thread.
+//***************************************************************************************
+
+#include "Test.h"
+#include "WaveSolverThread.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const int GridSize = 64;
+
+	// Heights and normals of a solution, for exact comparison.
+	struct Snapshot
+	{
+		std::vector<float> Heights;
+		std::vector<XMFLOAT3> Normals;
+	};
+
+	Snapshot TakeSnapshot(const Waves& waves)
+	{
+		Snapshot s;
+		for(int i = 0; i < waves.VertexCount(); ++i)
+		{
+			s.Heights.push_back(waves.Height(i));
+			s.Normals.push_back(waves.Normal(i));
+		}
+		return s;
+	}
+
+	bool Matches(const WavesFrame& frame, const Snapshot& s)
+	{
+		for(size_t i = 0; i < s.Heights.size(); ++i)
+		{
+			float h = frame.Position((int)i).y;
+			XMFLOAT3 n = frame.Normal((int)i);
+			if(std::memcmp(&h, &s.Heights[i], sizeof(h)) != 0 ||
+			   std::memcmp(&n, &s.Normals[i], sizeof(n)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	// Index of the snapshot the frame shows, or -1 if none.
+	int FindSnapshot(const WavesFrame& frame, const std::vector<Snapshot>& snapshots)
+	{
+		for(size_t k = 0; k < snapshots.size(); ++k)
+		{
+			if(Matches(frame, snapshots[k]))
+				return (int)k;
+		}
+		return -1;
+	}
+
+	// The kth command: a drop somewhere different each time, and every third
+	// command a batched impulse as well, then one fixed step.
+	void Disturb(int k, Waves& waves)
+	{
+		waves.Disturb(2 + (k*7) % (GridSize - 4), 2 + (k*13) % (GridSize - 4), 0.25f + 0.01f*k);
+		if(k % 3 == 0)
+		{
+			WaveImpulse impulse = { -4.0f + k % 8, 3.0f, 2.5f, 0.1f };
+			waves.DisturbBatch(&impulse, 1);
+		}
+	}
+
+	void Disturb(int k, WavesThread& thread)
+	{
+		thread.Disturb(2 + (k*7) % (GridSize - 4), 2 + (k*13) % (GridSize - 4), 0.25f + 0.01f*k);
+		if(k % 3 == 0)
+		{
+			WaveImpulse impulse = { -4.0f + k % 8, 3.0f, 2.5f, 0.1f };
+			thread.DisturbBatch(&impulse, 1);
+		}
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	// Generous: the worker only has to run one small step per command.
+	const std::chrono::seconds Timeout(10);
+}
+
+void TestWaveSolverThread()
+{
+	Waves reference(GridSize, GridSize, 1.0f, 0.03f, 4.0f, 0.2f);
+	Waves waves(GridSize, GridSize, 1.0f, 0.03f, 4.0f, 0.2f);
+	const float dt = reference.TimeStep();
+
+	std::vector<Snapshot> snapshots;
+	snapshots.push_back(TakeSnapshot(reference));
+
+	WavesThread thread(waves);
+	CHECK(FindSnapshot(thread.Latest(), snapshots) == 0);
+
+	// Lockstep: after each command, Latest() must catch up with exactly the
+	// solution the reference reaches, and never show anything else.
+	const int lockstepCommands = 12;
+	for(int k = 1; k <= lockstepCommands; ++k)
+	{
+		Disturb(k, reference);
+		reference.Update(dt);
+		snapshots.push_back(TakeSnapshot(reference));
+
+		Disturb(k, thread);
+		thread.Submit(dt);
+
+		int shown = -1;
+		for(Clock::time_point deadline = Clock::now() + Timeout; Clock::now() < deadline; )
+		{
+			shown = FindSnapshot(thread.Latest(), snapshots);
+			if(shown != k - 1)
+				break;
+			std::this_thread::yield();
+		}
+
+		if(!CHECK(shown == k))
+			return;
+	}
+
+	// Burst: more commands than the queue holds, without waiting in between.
+	// Latest() may skip solutions but must only ever move forward, and must
+	// reach the last one.  Submit(0) runs no step, just asks for a capture,
+	// in case the worker had no free frame when it finished the last command.
+	const int burstCommands = 40;
+	int lastShown = lockstepCommands;
+	int backwards = 0;
+	int unknown = 0;
+	for(int k = lockstepCommands + 1; k <= lockstepCommands + burstCommands; ++k)
+	{
+		Disturb(k, reference);
+		reference.Update(dt);
+		snapshots.push_back(TakeSnapshot(reference));
+
+		Disturb(k, thread);
+		thread.Submit(dt);
+
+		if(k % 4 == 0)
+		{
+			int shown = FindSnapshot(thread.Latest(), snapshots);
+			if(shown < 0)
+				++unknown;
+			else if(shown < lastShown)
+				++backwards;
+			else
+				lastShown = shown;
+		}
+	}
+
+	const int last = (int)snapshots.size() - 1;
+	for(Clock::time_point deadline = Clock::now() + Timeout; lastShown != last && Clock::now() < deadline; )
+	{
+		int shown = FindSnapshot(thread.Latest(), snapshots);
+		if(shown < 0)
+			++unknown;
+		else if(shown < lastShown)
+			++backwards;
+		else
+			lastShown = shown;
+
+		if(lastShown != last)
+		{
+			thread.Submit(0.0f);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	CHECK(unknown == 0);
+	CHECK(backwards == 0);
+	CHECK(lastShown == last);
+}